@@ -0,0 +1,174 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Measures the AnimationStage without a window or GL context. A crowd of
+ * instances plays a synthetic clip on a long bone chain, staggered in time
+ * so they don't share poses, and is evaluated with an increasing number of
+ * threads. The palettes must come out identical for every thread count.
+ *
+ * Usage: Bubba3DBenchAnimation [instances] [frames]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <assimp/scene.h>
+#include "AnimationStage.h"
+#include "AnimationState.h"
+#include "JobSystem.h"
+#include "objects/BoneTransformer.h"
+
+#define BENCH_NUMBER_OF_BONES 64
+#define BENCH_NUMBER_OF_KEYS 30
+#define BENCH_FRAME_TIME (1.0f / 60.0f)
+
+static std::string boneName(unsigned int bone) {
+    std::stringstream name;
+    name << "bone" << bone;
+    return name.str();
+}
+
+/**
+ * A chain of bones, each swaying around its own axis with a slightly
+ * different phase.
+ */
+static aiScene* createScene() {
+    aiScene *scene = new aiScene();
+
+    aiNode *parent = nullptr;
+    for (unsigned int bone = 0; bone < BENCH_NUMBER_OF_BONES; bone++) {
+        aiNode *node = new aiNode(boneName(bone));
+        aiMatrix4x4::Translation(aiVector3D(0.0f, 1.0f, 0.0f), node->mTransformation);
+        if (parent == nullptr) {
+            scene->mRootNode = node;
+        } else {
+            node->mParent = parent;
+            parent->mNumChildren = 1;
+            parent->mChildren = new aiNode*[1];
+            parent->mChildren[0] = node;
+        }
+        parent = node;
+    }
+
+    aiAnimation *animation = new aiAnimation();
+    animation->mName = aiString("sway");
+    animation->mDuration = BENCH_NUMBER_OF_KEYS - 1;
+    animation->mTicksPerSecond = 30.0;
+    animation->mNumChannels = BENCH_NUMBER_OF_BONES;
+    animation->mChannels = new aiNodeAnim*[BENCH_NUMBER_OF_BONES];
+    for (unsigned int bone = 0; bone < BENCH_NUMBER_OF_BONES; bone++) {
+        aiNodeAnim *channel = new aiNodeAnim();
+        channel->mNodeName = aiString(boneName(bone));
+
+        channel->mNumPositionKeys = 1;
+        channel->mPositionKeys = new aiVectorKey[1];
+        channel->mPositionKeys[0] = aiVectorKey(0.0, aiVector3D(0.0f, 1.0f, 0.0f));
+
+        channel->mNumRotationKeys = BENCH_NUMBER_OF_KEYS;
+        channel->mRotationKeys = new aiQuatKey[BENCH_NUMBER_OF_KEYS];
+        for (unsigned int key = 0; key < BENCH_NUMBER_OF_KEYS; key++) {
+            float angle = 0.3f * std::sin(key * 0.4f + bone * 0.1f);
+            channel->mRotationKeys[key] = aiQuatKey(key, aiQuaternion(aiVector3D(0.0f, 0.0f, 1.0f), angle));
+        }
+
+        channel->mNumScalingKeys = 1;
+        channel->mScalingKeys = new aiVectorKey[1];
+        channel->mScalingKeys[0] = aiVectorKey(0.0, aiVector3D(1.0f, 1.0f, 1.0f));
+
+        animation->mChannels[bone] = channel;
+    }
+    scene->mNumAnimations = 1;
+    scene->mAnimations = new aiAnimation*[1];
+    scene->mAnimations[0] = animation;
+
+    return scene;
+}
+
+static std::shared_ptr<BoneTransformer> createSkeleton() {
+    std::unique_ptr<aiScene> scene(createScene());
+    std::shared_ptr<BoneTransformer> skeleton = std::make_shared<BoneTransformer>(scene.get());
+    for (unsigned int bone = 0; bone < BENCH_NUMBER_OF_BONES; bone++) {
+        aiBone assimpBone;
+        assimpBone.mName = aiString(boneName(bone));
+        skeleton->createBoneIndexIfAbsent(&assimpBone);
+    }
+    return skeleton;
+}
+
+/**
+ * Plays the crowd for a number of frames and returns the average time per frame in milliseconds.
+ */
+static double runFrames(unsigned int numberOfThreads, std::shared_ptr<BoneTransformer> skeleton,
+                        size_t numberOfInstances, int numberOfFrames,
+                        std::vector<std::vector<chag::float4x4>> &palettes) {
+    JobSystem::setNumberOfThreads(numberOfThreads);
+
+    std::vector<std::unique_ptr<AnimationState>> states;
+    palettes.assign(numberOfInstances, std::vector<chag::float4x4>());
+    AnimationStage animationStage;
+    for (size_t i = 0; i < numberOfInstances; i++) {
+        states.push_back(std::unique_ptr<AnimationState>(new AnimationState(skeleton)));
+        states.back()->update(i * 0.37f);
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < numberOfFrames; frame++) {
+        animationStage.clear();
+        for (size_t i = 0; i < numberOfInstances; i++) {
+            states[i]->update(BENCH_FRAME_TIME);
+            animationStage.addInstance(states[i].get(), &palettes[i]);
+        }
+        animationStage.evaluate();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / numberOfFrames;
+}
+
+int main(int argc, char *argv[]) {
+    size_t numberOfInstances = argc > 1 ? (size_t)std::atoi(argv[1]) : 1000;
+    int numberOfFrames = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    std::shared_ptr<BoneTransformer> skeleton = createSkeleton();
+    // Every instance is at its own time, so this measures evaluation rather than sharing
+    skeleton->getPoseCache().setTimeQuantisation(0.0f);
+
+    unsigned int hardwareThreads = JobSystem::getNumberOfThreads();
+    std::vector<std::vector<chag::float4x4>> serialPalettes, palettes;
+
+    double serialTime = runFrames(1, skeleton, numberOfInstances, numberOfFrames, serialPalettes);
+    printf("%zu instances, %d bones, %d frames\n", numberOfInstances, BENCH_NUMBER_OF_BONES, numberOfFrames);
+    printf("threads %2u: %8.3f ms/frame\n", 1u, serialTime);
+
+    bool deterministic = true;
+    for (unsigned int threads = 2; threads <= hardwareThreads; threads *= 2) {
+        skeleton->getPoseCache().clear();
+        double time = runFrames(threads, skeleton, numberOfInstances, numberOfFrames, palettes);
+        printf("threads %2u: %8.3f ms/frame (%.2fx)\n", threads, time, serialTime / time);
+
+        if (palettes != serialPalettes) {
+            printf("threads %2u: palettes differ from the serial run\n", threads);
+            deterministic = false;
+        }
+    }
+
+    return deterministic ? 0 : 1;
+}
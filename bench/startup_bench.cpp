@@ -0,0 +1,185 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * Measures the decode step of a PreloadManifest without a window or GL
+ * context, which is the part of startup spent reading, decoding and
+ * importing assets. Without a manifest a synthetic set of meshes, textures
+ * and shaders is generated and removed afterwards, along with the binary
+ * meshes and compressed textures written for it.
+ *
+ * The asset cache is enabled. The manifest is decoded once to warm the
+ * file system cache and write the binary meshes and compressed textures,
+ * then on one thread and on all threads. The time of every asset is
+ * reported for the run on all threads.
+ *
+ * Usage: Bubba3DBenchStartup [manifest] [budget in ms]
+ *
+ * Exits with 1 if decoding on all threads takes longer than the budget.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "PreloadManifest.h"
+#include "ResourceManager.h"
+#include "Texture.h"
+#include "objects/MeshFile.h"
+#include "objects/TextureFile.h"
+
+#define BENCH_NUMBER_OF_MESHES 16
+#define BENCH_MESH_GRID_SIZE 96
+#define BENCH_NUMBER_OF_TEXTURES 24
+#define BENCH_TEXTURE_SIZE 512
+#define BENCH_MANIFEST_FILE "startup_bench.manifest"
+
+static std::vector<std::string> syntheticFiles;
+
+static std::string syntheticFileName(const std::string &kind, int index, const std::string &extension) {
+    std::stringstream name;
+    name << "startup_bench_" << kind << index << extension;
+    syntheticFiles.push_back(name.str());
+    return name.str();
+}
+
+/**
+ * A wavy grid with texture coordinates, so that importing it generates normals and tangents.
+ */
+static void writeMesh(const std::string &fileName, int seed) {
+    std::ofstream file(fileName);
+    for (int y = 0; y <= BENCH_MESH_GRID_SIZE; y++) {
+        for (int x = 0; x <= BENCH_MESH_GRID_SIZE; x++) {
+            float height = 0.1f * ((x * 7 + y * 13 + seed) % 11);
+            file << "v " << x << " " << height << " " << y << "\n";
+            file << "vt " << (float)x / BENCH_MESH_GRID_SIZE << " " << (float)y / BENCH_MESH_GRID_SIZE << "\n";
+        }
+    }
+    int row = BENCH_MESH_GRID_SIZE + 1;
+    for (int y = 0; y < BENCH_MESH_GRID_SIZE; y++) {
+        for (int x = 0; x < BENCH_MESH_GRID_SIZE; x++) {
+            int corner = y * row + x + 1;
+            file << "f " << corner << "/" << corner << " " << corner + row << "/" << corner + row << " "
+                 << corner + row + 1 << "/" << corner + row + 1 << " " << corner + 1 << "/" << corner + 1 << "\n";
+        }
+    }
+}
+
+/**
+ * An uncompressed 24 bit TGA with a pattern.
+ */
+static void writeTexture(const std::string &fileName, int seed) {
+    std::ofstream file(fileName, std::ios::binary);
+    unsigned char header[18] = { 0, 0, 2 };
+    header[12] = BENCH_TEXTURE_SIZE & 0xff;
+    header[13] = BENCH_TEXTURE_SIZE >> 8;
+    header[14] = BENCH_TEXTURE_SIZE & 0xff;
+    header[15] = BENCH_TEXTURE_SIZE >> 8;
+    header[16] = 24;
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    std::vector<unsigned char> texels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE * 3);
+    for (size_t i = 0; i < texels.size(); i++) {
+        texels[i] = (unsigned char)((i * 31 + seed * 17) ^ (i >> 9));
+    }
+    file.write(reinterpret_cast<const char *>(texels.data()), texels.size());
+}
+
+static void writeSyntheticManifest() {
+    std::ofstream manifest(BENCH_MANIFEST_FILE);
+    syntheticFiles.push_back(BENCH_MANIFEST_FILE);
+
+    std::string vertexShader = syntheticFileName("shader", 0, ".vert");
+    std::string fragmentShader = syntheticFileName("shader", 0, ".frag");
+    std::ofstream(vertexShader) << "#version 130\nvoid main() { gl_Position = vec4(0.0); }\n";
+    std::ofstream(fragmentShader) << "#version 130\nvoid main() { }\n";
+    manifest << "shader startupBenchShader " << vertexShader << " " << fragmentShader << "\n";
+
+    for (int i = 0; i < BENCH_NUMBER_OF_MESHES; i++) {
+        std::string fileName = syntheticFileName("mesh", i, ".obj");
+        writeMesh(fileName, i);
+        syntheticFiles.push_back(fileName + MESH_FILE_EXTENSION);
+        manifest << "mesh " << fileName << "\n";
+    }
+    for (int i = 0; i < BENCH_NUMBER_OF_TEXTURES; i++) {
+        std::string fileName = syntheticFileName("texture", i, ".tga");
+        writeTexture(fileName, i);
+        syntheticFiles.push_back(fileName + TEXTURE_FILE_EXTENSION);
+        manifest << "texture " << fileName << "\n";
+    }
+}
+
+static const char *typeName(PreloadManifest::AssetType type) {
+    switch (type) {
+        case PreloadManifest::AssetType::SHADER_PROGRAM: return "shader";
+        case PreloadManifest::AssetType::TEXTURE: return "texture";
+        case PreloadManifest::AssetType::MESH: return "mesh";
+        case PreloadManifest::AssetType::FILE: return "file";
+    }
+    return "";
+}
+
+/**
+ * Decodes the manifest on the given number of threads, zero for all of them.
+ */
+static PreloadManifest decodeManifest(const std::string &manifestFileName, unsigned int numberOfThreads) {
+    JobSystem::setNumberOfThreads(numberOfThreads);
+    PreloadManifest manifest;
+    manifest.addFromFile(manifestFileName);
+    manifest.decode();
+    return manifest;
+}
+
+int main(int argc, char *argv[]) {
+    std::string manifestFileName = argc > 1 ? argv[1] : BENCH_MANIFEST_FILE;
+    double budget = argc > 2 ? std::atof(argv[2]) : 0.0;
+    ResourceManager::setAssetCacheEnabled(true);
+    if (argc <= 1) {
+        writeSyntheticManifest();
+    }
+
+    PreloadManifest firstRun = decodeManifest(manifestFileName, 0);
+    PreloadManifest serialRun = decodeManifest(manifestFileName, 1);
+    PreloadManifest parallelRun = decodeManifest(manifestFileName, 0);
+
+    double totalAssetTime = 0.0;
+    printf("%-8s %-48s %10s\n", "type", "asset", "decode ms");
+    for (const PreloadManifest::AssetTiming &timing : parallelRun.getTimings()) {
+        printf("%-8s %-48s %10.3f\n", typeName(timing.type), timing.name.c_str(), timing.decodeMilliseconds);
+        totalAssetTime += timing.decodeMilliseconds;
+    }
+
+    printf("%zu assets\n", parallelRun.getNumberOfAssets());
+    printf("first decode:       %10.3f ms\n", firstRun.getDecodeMilliseconds());
+    printf("threads %2u:         %10.3f ms\n", 1u, serialRun.getDecodeMilliseconds());
+    printf("threads %2u:         %10.3f ms (%.2fx, %.3f ms of asset time)\n", JobSystem::getNumberOfThreads(),
+           parallelRun.getDecodeMilliseconds(),
+           serialRun.getDecodeMilliseconds() / parallelRun.getDecodeMilliseconds(), totalAssetTime);
+
+    for (const std::string &fileName : syntheticFiles) {
+        std::remove(fileName.c_str());
+    }
+
+    if (budget > 0.0 && parallelRun.getDecodeMilliseconds() > budget) {
+        printf("decoding took longer than the budget of %.3f ms\n", budget);
+        return 1;
+    }
+    return 0;
+}
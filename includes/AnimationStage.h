@@ -0,0 +1,69 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+#include "linmath/float4x4.h"
+
+class AnimationState;
+class SkinnedCollisionMesh;
+
+/**
+ * \brief Evaluates the poses of all animated objects in parallel.
+ *
+ * Every frame, before anything is drawn, the Renderer collects the
+ * AnimationState of each animated object and evaluates all of them on the
+ * JobSystem. The render passes then only read the palettes.
+ *
+ * The PoseCache of every skeleton involved is cleared first, so poses are
+ * only shared within the frame. Each instance only writes its own palette,
+ * and shared poses come out the same no matter which thread evaluates them
+ * first, so the result does not depend on the number of threads.
+ *
+ * Animated collision meshes are skinned in the same job as their palette,
+ * so collisions are tested against the pose that was last drawn.
+ */
+class AnimationStage {
+public:
+    void clear();
+
+    /**
+     * Adds an animated instance to be evaluated.
+     *
+     * @param evaluatePose False if the palette is already up to date and
+     *                     only the collision mesh needs to follow it
+     * @param collisionMesh Skinned with the palette once evaluated, nullptr if none
+     */
+    void addInstance(AnimationState *animationState, bool evaluatePose = true,
+                     SkinnedCollisionMesh *collisionMesh = nullptr);
+
+    size_t getNumberOfInstances() const;
+
+    /**
+     * Evaluates the poses of all instances added since the last clear.
+     */
+    void evaluate();
+
+private:
+    struct Instance {
+        AnimationState *animationState;
+        bool evaluatePose;
+        SkinnedCollisionMesh *collisionMesh;
+    };
+
+    std::vector<Instance> instances;
+};
@@ -0,0 +1,133 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "linmath/float4x4.h"
+#include "KeyframeCache.h"
+#include "Pose.h"
+
+class BoneTransformer;
+class PoseCache;
+
+/**
+ * \brief The animation playback of a single animated object.
+ *
+ * Plays the named clips of a Mesh. Switching clips can crossfade from the
+ * old one, and any number of additive layers (e.g. a breathing or aiming
+ * clip) can be applied on top with their own weights. The state is per
+ * instance, the clips themselves are shared by everything using the Mesh.
+ *
+ * \code
+ * AnimationState *animation = renderer->getAnimationState();
+ * animation->play("run", 0.3f);
+ * animation->setLayer("wave", 0.5f);
+ * \endcode
+ */
+class AnimationState {
+public:
+    /**
+     * Creates the state and starts playing the first clip of the skeleton, if any.
+     */
+    AnimationState(std::shared_ptr<BoneTransformer> skeleton);
+
+    std::vector<std::string> getClipNames() const;
+
+    /**
+     * Starts playing a clip from its beginning.
+     *
+     * @param fadeInSeconds How long to crossfade from the clip currently playing
+     * @param loop If the clip should wrap around instead of stopping on its last frame
+     * @throws std::invalid_argument if the mesh has no clip with that name
+     */
+    void play(const std::string &clipName, float fadeInSeconds = 0.0f, bool loop = true);
+
+    /**
+     * Adds an additive layer, or changes its weight if the clip is already layered.
+     *
+     * @throws std::invalid_argument if the mesh has no clip with that name
+     */
+    void setLayer(const std::string &clipName, float weight);
+    void removeLayer(const std::string &clipName);
+
+    /**
+     * Advances all clips and crossfades.
+     */
+    void update(float dt);
+
+    /**
+     * Blends the current pose and calculates the transform of each bone from
+     * it, see getBoneTransforms. States of different objects can be evaluated
+     * in parallel, see AnimationStage.
+     *
+     * While a single clip plays without crossfade or layers, and the skeleton
+     * has a time quantisation set, the pose is looked up in the PoseCache of
+     * the skeleton, so instances close enough in time share one palette.
+     */
+    void evaluate();
+
+    /**
+     * The bone transforms calculated by the last evaluate(). Valid until the
+     * next evaluate(), even if the palette is shared and the PoseCache is cleared.
+     */
+    const std::vector<chag::float4x4> &getBoneTransforms() const;
+
+    /**
+     * The cache of the skeleton, which the AnimationStage clears every frame.
+     */
+    PoseCache &getPoseCache();
+
+private:
+    struct ClipPlayback {
+        int clipIndex = -1;
+        float timeInSeconds = 0.0f;
+        bool loop = true;
+        KeyframeCache keyframeCache;
+    };
+
+    struct Layer {
+        ClipPlayback playback;
+        float weight;
+    };
+
+    std::shared_ptr<BoneTransformer> skeleton;
+
+    ClipPlayback current;
+    ClipPlayback previous;
+    float fadeDuration = 0.0f;
+    float fadeTime = 0.0f;
+
+    std::vector<Layer> layers;
+
+    // Scratch poses, kept around so evaluating does not allocate
+    Pose pose;
+    Pose fadingPose;
+    Pose layerPose;
+    std::vector<chag::float4x4> globalTransformations;
+
+    // Written when the pose is not shared
+    std::vector<chag::float4x4> boneTransforms;
+    // The palette of the PoseCache when the pose is shared, null otherwise
+    std::shared_ptr<const std::vector<chag::float4x4>> sharedBoneTransforms;
+
+    int findClip(const std::string &clipName) const;
+    void sample(ClipPlayback &playback, Pose &result);
+    bool isPlayingSingleClip() const;
+    void evaluateShared();
+};
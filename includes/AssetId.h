@@ -0,0 +1,53 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Identifies a resource by a 64 bit hash (FNV-1a) of its file name or name.
+ *
+ * Hash the name once and keep the id, to look resources up without
+ * comparing strings. Ids of string literals are hashed at compile time.
+ *
+ * \code
+ * static const AssetId SHIP("meshes/ship.obj");
+ * std::shared_ptr<Mesh> ship = ResourceManager::fetchMesh(SHIP);
+ * \endcode
+ */
+class AssetId {
+public:
+    constexpr AssetId() : hash(0) {}
+    constexpr AssetId(const char *name) : hash(hashName(name, FNV_OFFSET_BASIS)) {}
+    AssetId(const std::string &name) : hash(hashName(name.c_str(), FNV_OFFSET_BASIS)) {}
+
+    constexpr uint64_t getHash() const { return hash; }
+
+    constexpr bool operator==(const AssetId &other) const { return hash == other.hash; }
+    constexpr bool operator!=(const AssetId &other) const { return hash != other.hash; }
+
+private:
+    static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+    static constexpr uint64_t hashName(const char *name, uint64_t hash) {
+        return *name == '\0' ? hash : hashName(name + 1, (hash ^ (unsigned char)*name) * FNV_PRIME);
+    }
+
+    uint64_t hash;
+};
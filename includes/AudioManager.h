@@ -24,23 +24,30 @@
 #include <map>
 #include <sstream>
 #include <SFML/Audio.hpp>
+#include "VirtualFileSystem.h"
 
 class AudioManager {
 public:
     template<typename Type>
     static Type* getItemFromMap(std::map<std::string, Type> *map, std::string id) ;
 
+    /**
+     * Loads the sound or music the first time it is fetched.
+     *
+     * @return nullptr if the file can not be opened or read
+     */
     static sf::Sound* loadAndFetchSound(const std::string &fileName);
     static sf::Music* loadAndFetchMusic(const std::string &fileName);
 
 private:
     static std::map<std::string, sf::Music*> musics;
     static std::map<std::string, sf::SoundBuffer> soundBuffers;
+    static std::map<std::string, VirtualFile> musicFiles;
 
-    static void loadSoundBuffer(const std::string &fileName);
+    static bool loadSoundBuffer(const std::string &fileName);
     static sf::Sound* getSoundBuffer(std::string fileName);
 
-    static void loadMusic(const std::string &fileName);
+    static bool loadMusic(const std::string &fileName);
     static sf::Music* getMusic(std::string fileName);
 };
 
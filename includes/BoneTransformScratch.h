@@ -0,0 +1,37 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+#include "KeyframeCache.h"
+#include "Pose.h"
+#include "linmath/float4x4.h"
+
+/**
+ * \brief Working memory for calculating the bone transforms of one instance.
+ *
+ * A skeleton is shared by every object drawn with its Mesh and may be
+ * evaluated from several threads at once, so it keeps no state of its own
+ * between evaluations. Each animated instance owns a scratch instead, which
+ * also keeps the allocations from being repeated every frame.
+ */
+struct BoneTransformScratch {
+    KeyframeCache keyframeCache;
+    Pose pose;
+    // The global transformation of each node
+    std::vector<chag::float4x4> globalTransformations;
+};
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 
 class CubeMapTexture
@@ -34,5 +35,20 @@ public:
 private:
     GLuint m_texture;
 
-    void loadCubeMapFace(std::string filename, GLenum face);
+    // The six decoded faces back to back, only kept between decodeFaces and uploadFaces
+    std::vector<unsigned char> m_faceData;
+    int m_faceSize = 0;
+    int m_components = 0;
+
+    /**
+     * Checks that all six faces are square images of the same size and
+     * format, then decodes them in parallel into m_faceData. Does not
+     * touch OpenGL. Returns false, after logging why, on any failure.
+     */
+    bool decodeFaces(const std::string filenames[]);
+
+    /**
+     * Uploads the decoded faces to the bound cube map and frees them.
+     */
+    void uploadFaces();
 };
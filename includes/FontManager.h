@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <GL/glew.h>
 #include <functional>
+#include <VirtualFileSystem.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -103,12 +104,29 @@ private:
      */
     typedef std::unordered_map<FontDefinition,Font*,FontDefHash> fontMap;
 
+    /**
+     * A face opened from memory. FreeType reads the file for as long as
+     * the face lives, so the file is kept open with it.
+     */
+    struct LoadedFace {
+        VirtualFile file;
+        FT_Face face;
+    };
+
+    /**
+     * Returns the face of the font file, opening it the first time.
+     * Null if it can't be opened.
+     */
+    FT_Face openFace(const std::string &path);
+
     void iterateGlyphs(FontDefinition def, unsigned int* width, unsigned int* height);
     void drawGlyphs();
     void initTexture();
     GLuint* getTex(bool force) ;
 
     fontMap loadedFonts;
+    // Keyed by the path of the font file
+    std::unordered_map<std::string,LoadedFace> loadedFaces;
     FT_Library* ft_library;
     unsigned int atlasWidth = 0, atlasHeight = 0;
     bool initiated = false;
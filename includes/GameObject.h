@@ -34,6 +34,9 @@ class IRenderComponent;
 class IComponent;
 class Octree;
 class ShaderProgram;
+class AnimationStage;
+class ParticleStage;
+class SkinnedCollisionMesh;
 
 /**
  * \brief A class for containing all information about a object in the game world.
@@ -100,6 +103,35 @@ public:
 
     void renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram);
 
+    /**
+     * Returns the mesh if the GameObject can be drawn instanced with the given shader,
+     * that is if it has no children and its RenderComponent allows it. nullptr otherwise.
+     */
+    Mesh* getInstanceableMesh(const std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    /**
+     * Same as above, for the shadow pass drawn with the given shader.
+     */
+    Mesh* getInstanceableShadowMesh(const std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    /**
+     * Adds the animations of the GameObject and its children to the stage
+     * that evaluates them before rendering.
+     */
+    void addToAnimationStage(AnimationStage &animationStage);
+
+    /**
+     * Adds the particle generators of the GameObject and its children to
+     * the stage that simulates them before rendering.
+     */
+    void addToParticleStage(ParticleStage &particleStage);
+
+    /**
+     * Requests the textures of the GameObject and its children at the size
+     * they cover on screen, see IRenderComponent::requestTextureSizes.
+     */
+    void requestTextureSizes(const chag::float3 &cameraPosition, float pixelsPerUnit);
+
     void addRenderComponent(IRenderComponent* renderer);
     void addComponent(IComponent* newComponent);
     /**
@@ -159,6 +191,15 @@ public:
      * @return The octree containing the GameObject
      */
     Octree* getOctree();
+
+    /**
+     * Makes the octree follow the animation of the object instead of staying
+     * in the bind pose. The collision mesh is then skinned on the CPU with the
+     * bone palette of the RenderComponent, on the AnimationStage of the frame
+     * that draws it, so it must share the skeleton of the rendered mesh. Does
+     * nothing if the collision mesh isn't animated.
+     */
+    void setAnimatedCollision(bool animated);
     /**
      * NOTE: The triangles have not been transformed.
      *
@@ -223,6 +264,7 @@ private:
     AABB aabb;
     Sphere sphere;
     Octree *octree;
+    std::unique_ptr<SkinnedCollisionMesh> skinnedCollisionMesh;
     TypeIdentifier typeIdentifier = -1;
     std::vector<TypeIdentifier> canCollideWith;
     bool dynamicObject = false;
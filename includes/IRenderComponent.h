@@ -18,7 +18,13 @@
 
 #include "IComponent.h"
 #include <memory>
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4x4.h"
 
+class AnimationStage;
+class ParticleStage;
+class SkinnedCollisionMesh;
 
 class IRenderComponent : public IComponent {
 public:
@@ -33,6 +39,51 @@ public:
      */
     virtual void renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram) = 0;
 
+    /**
+     * Returns the mesh if the component renders nothing but that mesh with the given
+     * shader. Renderer then batches it with all other instances of the mesh and draws
+     * them instanced instead of calling render(). Returns nullptr otherwise.
+     *
+     * @param shaderProgram The shader the instanced path replaces
+     */
+    virtual Mesh* getInstanceableMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) { return nullptr; }
+
+    /**
+     * Same as above, but for the shadow pass, in which the mesh would be drawn
+     * by renderShadow with the given shader.
+     */
+    virtual Mesh* getInstanceableShadowMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) { return nullptr; }
+
+    /**
+     * Adds the animation of the component, if any, to the stage that
+     * evaluates all poses in parallel before the frame is rendered.
+     *
+     * @param collisionMesh The animated collision mesh of the object, to be
+     *                      skinned with the palette. nullptr if there is none.
+     */
+    virtual void addToAnimationStage(AnimationStage &animationStage, SkinnedCollisionMesh *collisionMesh) { }
+
+    /**
+     * Adds the particles of the component, if any, to the stage that
+     * simulates them in parallel before the frame is rendered.
+     */
+    virtual void addToParticleStage(ParticleStage &particleStage) { }
+
+    /**
+     * Requests the textures the component draws at the size they cover on
+     * screen, see ResourceManager::requestTextureSize.
+     *
+     * @param cameraPosition Where the scene is seen from
+     * @param pixelsPerUnit How many pixels one unit covers at a distance of one unit
+     */
+    virtual void requestTextureSizes(const chag::float3 &cameraPosition, float pixelsPerUnit) { }
+
+    /**
+     * The current bone palette of the component, evaluated first if the
+     * animation has advanced since. nullptr if the component isn't animated.
+     */
+    virtual const std::vector<chag::float4x4>* getBoneTransforms() { return nullptr; }
+
 protected:
     std::shared_ptr<ShaderProgram> shaderProgram;
 
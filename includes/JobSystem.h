@@ -0,0 +1,63 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * \brief Runs independent work on a pool of worker threads.
+ *
+ * The workers are started the first time they are needed. The calling
+ * thread takes part in the work and only returns once all of it is done,
+ * so a parallelFor can replace a plain loop as long as every iteration
+ * only touches its own data.
+ *
+ * \code
+ * JobSystem::parallelFor(objects.size(), [&](size_t i) {
+ *     objects[i].update(dt);
+ * });
+ * \endcode
+ */
+class JobSystem {
+public:
+    /**
+     * Sets the number of threads used, including the calling thread. One
+     * runs everything on the calling thread. Zero, the default, uses one
+     * thread per hardware thread.
+     */
+    static void setNumberOfThreads(unsigned int numberOfThreads);
+    static unsigned int getNumberOfThreads();
+
+    /**
+     * Calls job once for every index in [0, count) and waits for all calls to finish.
+     *
+     * Calls from within a job run serially on the thread running the job,
+     * whether a worker or the thread that called the outer parallelFor.
+     * Calls from several threads at once take turns. Jobs must not throw.
+     *
+     * @param batchSize How many consecutive indices a thread takes at a time
+     */
+    static void parallelFor(size_t count, const std::function<void(size_t)> &job, size_t batchSize = 1);
+
+    /**
+     * Makes every parallelFor called from the current thread run serially
+     * on it. Meant for background threads, such as the asset loaders, whose
+     * work must never keep the workers from the frame's parallelFor calls.
+     */
+    static void setRunSerially(bool serially);
+};
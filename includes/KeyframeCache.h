@@ -0,0 +1,42 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+
+/**
+ * \brief Remembers the last keyframes used when evaluating an animation.
+ *
+ * A Mesh, and its skeleton, is shared by every object drawn with it, so the
+ * cache lives with each animated instance instead. When the animation plays
+ * forward the keys found last time, or the ones right after them, are almost
+ * always still the right ones, which makes finding them O(1). Seeks and
+ * loops fall back to a binary search.
+ *
+ * The cache is sized and filled by the BoneTransformer, it should only ever
+ * be used with a single Mesh.
+ */
+struct KeyframeCache {
+    struct ChannelKeys {
+        unsigned int position = 0;
+        unsigned int rotation = 0;
+        unsigned int scaling = 0;
+    };
+
+    // Indexed by the flattened node index of the skeleton
+    std::vector<ChannelKeys> channels;
+};
@@ -29,4 +29,22 @@ struct Material {
     std::shared_ptr<Texture> diffuseTexture = NULL;
     std::shared_ptr<Texture> bumpMapTexture = NULL;
     std::shared_ptr<Texture> emissiveTexture = NULL;
+
+    /**
+     * The uniform buffer holding the "Material" block read by the standard
+     * shaders. Created by the first call to updateUniformBlock().
+     */
+    GLuint uniformBufferObject = 0;
+
+    /**
+     * Uploads the colors and texture flags to the uniform buffer of the
+     * material. Call it again after changing any of them.
+     */
+    void updateUniformBlock();
+
+    /**
+     * Binds the textures of the material and its uniform buffer to the
+     * units and binding point that the standard shaders read from.
+     */
+    void bind();
 };
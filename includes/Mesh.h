@@ -25,11 +25,12 @@
 #include <Sphere.h>
 #include <assimp/scene.h>
 #include <map>
-#include <assimp/Importer.hpp>
 #include <memory>
+#include "VirtualFileSystem.h"
 
 
 class BoneTransformer;
+struct BoneTransformScratch;
 class Triangle;
 class Chunk;
 class Texture;
@@ -47,10 +48,40 @@ class Mesh {
 public:
     Mesh();
 
-    ~Mesh() = default;
+    /**
+     * Frees the OpenGL buffers and the triangles of the mesh.
+     */
+    ~Mesh();
+
+    Mesh(const Mesh &) = delete;
+    Mesh& operator=(const Mesh &) = delete;
 
     void loadMesh(const std::string &fileName);
 
+    /**
+     * Reads the mesh file and converts it, without touching OpenGL or
+     * loading the textures. Can be called from any thread.
+     *
+     * With the asset cache enabled, see ResourceManager::setAssetCacheEnabled,
+     * the converted mesh is written to a binary mesh next to the file, which
+     * following imports map instead as long as the file is unchanged. Meshes
+     * without animations then skip assimp entirely.
+     */
+    void importMesh(const std::string &fileName);
+
+    /**
+     * The files of the textures the imported materials use in the role, the
+     * bump maps for TextureRole::NORMAL_MAP and the others for TextureRole::COLOR.
+     */
+    std::vector<std::string> getTextureFileNames(TextureRole role);
+
+    /**
+     * Buffers the imported chunks and materials and fetches their textures
+     * from the ResourceManager. Must be called from the thread owning the
+     * OpenGL context.
+     */
+    void uploadMesh();
+
     /**
      * NOTE: The triangles have not been transformed.
      *
@@ -73,10 +104,27 @@ public:
     Sphere getSphere();
 
     std::vector<Chunk>* getChunks();
+
+    /**
+     * The memory held by the vertex data, on the host and in OpenGL buffers, and the triangles.
+     */
+    size_t getMemorySize();
     std::vector<Material>* getMaterials();
 
     bool hasAnimations();
 
+    /**
+     * The skeleton of the mesh along with its animation clips.
+     */
+    std::shared_ptr<BoneTransformer> getBoneTransformer();
+
+    /**
+     * Sets how finely the time of instances playing the same clip is snapped,
+     * so that instances close enough in time share one evaluated pose per
+     * frame. The default of zero shares nothing and never alters playback.
+     */
+    void setAnimationTimeQuantisation(float seconds);
+
     /**
     * Calculates the transform to be applied to each bone at the current time.
     *
@@ -86,7 +134,35 @@ public:
     */
     std::vector<chag::float4x4> getBoneTransforms(float totalElapsedTimeInSeconds);
 
+    /**
+     * Same as above, but reuses the given vector instead of allocating a new
+     * one, and works in the scratch of the animated instance. The mesh itself
+     * keeps no state, so instances can be evaluated in parallel.
+     */
+    void getBoneTransforms(float totalElapsedTimeInSeconds, std::vector<chag::float4x4> &boneTransforms,
+                           BoneTransformScratch &scratch);
+
 private:
+    /**
+     * Reads the binary mesh written when the file was last imported, unless
+     * the file has changed since. The vertices are buffered straight from the
+     * mapped binary mesh.
+     *
+     * @return If the binary mesh could be used
+     */
+    bool readMeshFile(const std::string &fileName);
+
+    /**
+     * Writes the imported mesh to a binary mesh, see MeshFile.h.
+     */
+    void writeMeshFile(const std::string &fileName);
+
+    /**
+     * Imports only the nodes, bones and animations of the file, for animated
+     * meshes read from a binary mesh.
+     */
+    void importSkeleton(const std::string &fileName);
+
     /**
      * Loads all the chunks, materials, triangles and collision details of the mesh
      * in the loaded aiScene.
@@ -111,7 +187,7 @@ private:
      * @param fileNameOfMesh The absolute/relative file path to the file containing the mesh
      */
     void initMaterials(const aiScene *pScene, const std::string &fileNameOfMesh);
-    void initMaterialTextures(Material *material, std::string fileNameOfMesh,
+    void initMaterialTextures(unsigned int materialIndex, std::string fileNameOfMesh,
                               const aiMaterial *loadedMaterial);
     void initMaterialColors(Material *material, const aiMaterial *loadedMaterial);
     void initMaterialShininess(Material *material, const aiMaterial *loadedMaterial);
@@ -152,38 +228,56 @@ private:
     std::string cleanFileName(std::string filePath);
 
     /**
-     * Returns the texture that was specified in the material.
-     * Loads the texture into the resourcemanager if it was not previously loaded, or
-     * fetches it from the resourcemanager if it was.
+     * Returns the file of the texture that was specified in the material.
      *
      * @param material The material containing a texture
      * @param fileNameOfMesh
      * @param type A enum saying which texture type to load from the material
-     * @return A pointer to the texture loaded
+     * @return The path to the texture, empty if the material has none
+     */
+    std::string getTextureFileName(const aiMaterial *material,
+                                   const std::string &fileNameOfMesh,
+                                   aiTextureType type);
+
+    /**
+     * Fetches the texture from the ResourceManager, nullptr for an empty file name.
      */
-    std::shared_ptr<Texture> getTexture(const aiMaterial *material,
-                                        const std::string &fileNameOfMesh,
-                                        aiTextureType type);
+    std::shared_ptr<Texture> fetchTexture(const std::string &fileName, TextureRole role);
 
     /**
      * Initiates OpenGL buffers and buffers the chunk data on to the graphics memory.
      * @param chunk The chunk to be initiated for rendering
+     * @param vertices The interleaved vertices of the chunk
      */
-    void setupChunkForRendering(Chunk &chunk);
+    void setupChunkForRendering(Chunk &chunk, const float *vertices);
 
     void setupSphere(std::vector<chag::float3> *positions);
 
     void createTriangles();
-    Triangle* createTriangleFromPositions(std::vector<chag::float3> positionBuffer,
-                                          std::vector<unsigned int> indices,
+    Triangle* createTriangleFromPositions(const std::vector<chag::float3> &positionBuffer,
+                                          const std::vector<unsigned int> &indices,
                                           unsigned int startIndex);
 
     std::vector<Triangle *> triangles;
     std::vector<Material> materials;
     std::vector<Chunk> m_chunks;
 
+    /**
+     * The texture files of a material, kept from import until upload.
+     */
+    struct MaterialTextureFiles {
+        std::string diffuse;
+        std::string bumpMap;
+        std::string emissive;
+    };
+    std::vector<MaterialTextureFiles> materialTextureFiles;
+
+    // The binary mesh the mesh was read from, kept open until it is uploaded
+    VirtualFile meshFile;
+    // The interleaved vertices of each chunk in meshFile
+    std::vector<const float *> mappedVertices;
+
     std::shared_ptr<BoneTransformer> boneTransformer;
-    Assimp::Importer importer;
 
     Sphere sphere;
     AABB m_aabb;
@@ -50,6 +50,10 @@ public:
 
     ~Octree();
 
+    // Owns its children, so copies would delete them twice
+    Octree(const Octree&) = delete;
+    Octree& operator=(const Octree&) = delete;
+
     void insertTriangle(Triangle* t);
     void insertAll(std::vector<Triangle*> &triangles);
 
@@ -98,9 +102,22 @@ public:
      */
     AABB* getAABB();
 
+    /**
+     * Fits the AABB of every level to the triangles in it and its children,
+     * after the triangles have moved. The triangles stay in the levels they
+     * were inserted into, which makes this much cheaper than rebuilding the
+     * Octree, at the cost of levels overlapping more the further they move.
+     */
+    void refit();
+
 private:
     Octree(chag::float3 origin, chag::float3 halfVector, int depth);
 
+    /**
+     * @return False if there are no triangles in the level or its children
+     */
+    bool refitRecursively();
+
     void setupAABB(chag::float3 origin, chag::float3 halfVector);
 
     /**
@@ -17,13 +17,20 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <cstddef>
 #include "linmath/float3.h"
 #include "linmath/Quaternion.h"
+#include "Random.h"
 
 class ParticleConf {
 
 /**
  * \brief Configuration for how Particles generated by a ParticleGenerator behaves.
+ *
+ * The functions taking a Random are called by the ParticleGenerator with its
+ * own seeded Random, so particles behave the same every time for a given seed.
+ * Configurations written against the functions without one derive from
+ * LegacyParticleConf instead.
  */
 public:
     ParticleConf() = default;
@@ -34,13 +41,13 @@ public:
      * Is called on particle reset.
      * @param genPos The position of the ParticleGenerator spawning the Particle.
      */
-    virtual chag::float3 initialPosition() = 0;
+    virtual chag::float3 initialPosition(Random &random) = 0;
 
     /**
      * The initial velocity for the Particle.
      * Is called on particle reset.
      */
-    virtual chag::float3 initialVelocity() = 0;
+    virtual chag::float3 initialVelocity(Random &random) = 0;
 
     /**
      * Accelerates the Particle given it's current velocity.
@@ -50,10 +57,27 @@ public:
     virtual chag::float3 accelerate(chag::float3 velocity) = 0;
 
     /**
-     * Calculates the Lifetime for the Particle.
+     * Accelerates all live Particles, stored as one array per axis.
+     * Is called each update instead of accelerate for every Particle.
+     * Override it to accelerate the Particles without a call per Particle.
+     * @param count The number of Particles in each array.
+     * @param random The Random of the ParticleGenerator, see Random::fill.
+     */
+    virtual void accelerateAll(float *velocityX, float *velocityY, float *velocityZ, size_t count,
+                               Random &random) {
+        for (size_t i = 0; i < count; i++) {
+            chag::float3 velocity = accelerate(chag::make_vector(velocityX[i], velocityY[i], velocityZ[i]));
+            velocityX[i] = velocity.x;
+            velocityY[i] = velocity.y;
+            velocityZ[i] = velocity.z;
+        }
+    }
+
+    /**
+     * Calculates the Lifetime for the Particle, which must be positive.
      * Is called on particle reset.
      */
-    virtual float calcLifetime() = 0;
+    virtual float calcLifetime(Random &random) = 0;
 
 
     /**
@@ -63,6 +87,12 @@ public:
      */
     virtual chag::float3 calcParticleScale() = 0;
 
+    /**
+     * The size of a Particle relative to calcParticleScale.
+     * Is called on particle reset.
+     */
+    virtual float initialSize(Random &random) { return 1.0f; }
+
     /**
      * Continue to loop the ParticleGenerator.
      * If false no new particle will be spawned when a Particle dies.
@@ -80,3 +110,31 @@ protected:
     bool looping = true;
 
 };
+
+/**
+ * \brief A ParticleConf configured by the functions without a Random.
+ *
+ * While they are called getRand and createRandomVector draw from the Random
+ * of the ParticleGenerator instead of rand(), so the particles still behave
+ * the same every time for a given seed.
+ */
+class LegacyParticleConf : public ParticleConf {
+public:
+    /**
+     * The initial position of a Particle, see ParticleConf::initialPosition.
+     */
+    virtual chag::float3 initialPosition() = 0;
+    chag::float3 initialPosition(Random &random) override { return initialPosition(); }
+
+    /**
+     * The initial velocity for the Particle, see ParticleConf::initialVelocity.
+     */
+    virtual chag::float3 initialVelocity() = 0;
+    chag::float3 initialVelocity(Random &random) override { return initialVelocity(); }
+
+    /**
+     * Calculates the Lifetime for the Particle, see ParticleConf::calcLifetime.
+     */
+    virtual float calcLifetime() = 0;
+    float calcLifetime(Random &random) override { return calcLifetime(); }
+};
@@ -20,13 +20,18 @@
 #include <vector>
 
 #include "IRenderComponent.h"
+#include "Random.h"
 
 
 class Camera;
-class Particle;
+class ParticlePool;
 class ParticleConf;
 class ParticleRenderer;
 
+#define PARTICLE_THROTTLE_DISTANCE 100.0f
+#define PARTICLE_THROTTLED_UPDATE_FRAMES 8
+#define PARTICLE_DEFAULT_BOUNDING_RADIUS 10.0f
+
 
 /**
  * \brief Component that generates, handles and renders particles.
@@ -61,11 +66,34 @@ public:
     ~ParticleGenerator();
 
     /**
-     * Update the position of all spawned Particles.
+     * Adds the time since the last update. The particles are moved when the
+     * Renderer simulates the ParticleStage, before the next frame is drawn.
      * @param dt The time in seconds since last update call.
      */
     void update(float dt);
 
+    /**
+     * Adds the generator to the stage that simulates all particles in parallel.
+     */
+    void addToParticleStage(ParticleStage &particleStage);
+
+    /**
+     * Moves the particles by the time added up since they were last moved.
+     * @param throttled If the emitter is out of view. Throttled generators are
+     *                  only moved every PARTICLE_THROTTLED_UPDATE_FRAMES calls.
+     */
+    void simulate(bool throttled);
+
+    chag::float3 getEmitterPosition();
+    const ParticleConf* getConf() const;
+
+    /**
+     * The radius around the emitter that the particles are expected to stay
+     * within, used to tell if the emitter is in view.
+     */
+    void setBoundingRadius(float boundingRadius);
+    float getBoundingRadius() const;
+
     /**
      * Render shadows from the spawned Particles.
      * @param shaderProgram The ShaderProgram used to render the shadows.
@@ -79,14 +107,47 @@ public:
 
     void renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram) {}
 
+    /**
+     * Restarts the random sequence the ParticleConf is given. Generators
+     * get different seeds in the order they are created, set one to make
+     * a generator independent of that order.
+     */
+    void setSeed(uint64_t seed);
+
+    /**
+     * The live particles, in no particular order.
+     */
+    const ParticlePool& getParticles() const;
+
 private:
+    /**
+     * Spawns a Particle as configured by the ParticleConf, relative to the owner.
+     */
+    void spawnParticle();
+
+    /**
+     * Moves, kills and respawns particles.
+     * @param updates The number of updates dt covers. The particles are
+     *                accelerated and aged by the camera distance once for each.
+     */
+    void step(float dt, int updates);
 
     int maxParticles = 0;
+    bool spawnedInitialParticles = false;
+    bool warnedAboutLifetime = false;
 
-    std::vector<std::unique_ptr<Particle>> particles;
+    // Time and number of updates since the particles were last moved
+    float pendingTime = 0.0f;
+    int pendingUpdates = 0;
+
+    float boundingRadius = PARTICLE_DEFAULT_BOUNDING_RADIUS;
+
+    std::unique_ptr<ParticlePool> particles;
 
     std::shared_ptr<ParticleRenderer> renderer;
     std::shared_ptr<ParticleConf> conf;
     std::shared_ptr<Camera> camera;
 
+    Random random;
+
 };
@@ -26,13 +26,21 @@ class Texture;
 class Camera;
 class ShaderProgram;
 class ParticleConf;
-class Particle;
+class ParticlePool;
+class ParticleInstanceBuffer;
+
+#define PARTICLE_INSTANCE_LOCATION_GPU 2
 
 /**
  * \bief Responsible for rendering particles
  *
  * ParticleRenderer renders Particles. Typically the particles are provided
  * by a ParticleGenerator.
+ *
+ * All particles of a generator are drawn with a single instanced draw call.
+ * The shader reads the particle position and size as a vec4 from
+ * PARTICLE_INSTANCE_LOCATION_GPU and gets the rotation towards the camera
+ * and the scale in the billboardMatrix and particleScale uniforms.
  */
 class ParticleRenderer
 {
@@ -56,7 +64,7 @@ public:
      *
      * @param particles The particles to render.
      */
-    void render(std::vector<std::unique_ptr<Particle>> &particles,
+    void render(const ParticlePool &particles,
                 const chag::float3 &position,
                 const std::shared_ptr<ParticleConf> &conf);
 
@@ -64,9 +72,13 @@ public:
 
 private:
     GLuint vaob;
+    GLuint instanceBufferObject;
 
     std::shared_ptr<Texture> texture;
     std::shared_ptr<Camera> camera;
     std::shared_ptr<ShaderProgram> shaderProgram;
+
+    // Reused between renders to keep its allocations
+    std::unique_ptr<ParticleInstanceBuffer> instanceBuffer;
 };
 
@@ -0,0 +1,68 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4x4.h"
+
+class ParticleGenerator;
+
+/**
+ * \brief Simulates the particles of all ParticleGenerators in parallel.
+ *
+ * ParticleGenerator::update only adds up the time that has passed. Every
+ * frame, before anything is drawn, the Renderer collects the generators
+ * and simulates them on the JobSystem.
+ *
+ * Generators whose emitter is outside the view frustum, or further away than
+ * PARTICLE_THROTTLE_DISTANCE, are throttled: they are only simulated every
+ * PARTICLE_THROTTLED_UPDATE_FRAMES frames, in one step covering all the time
+ * since. A generator coming back into view catches up in a single step.
+ *
+ * Generators sharing a ParticleConf are simulated one after the other, in
+ * the order they were added, so a ParticleConf never needs to be thread safe.
+ */
+class ParticleStage {
+public:
+    void clear();
+
+    void addGenerator(ParticleGenerator *generator);
+
+    size_t getNumberOfGenerators() const;
+
+    /**
+     * Simulates all generators added since the last clear.
+     *
+     * @param viewProjectionMatrix The matrix of the camera the frame is drawn from
+     * @param cameraPosition The position of the same camera
+     */
+    void simulate(const chag::float4x4 &viewProjectionMatrix, const chag::float3 &cameraPosition);
+
+    /**
+     * If a sphere is at least partly inside the frustum of a view projection matrix.
+     */
+    static bool isSphereInFrustum(const chag::float4x4 &viewProjectionMatrix,
+                                  const chag::float3 &center, float radius);
+
+private:
+    std::vector<ParticleGenerator*> generators;
+
+    // The generators split into runs sharing a ParticleConf
+    std::vector<ParticleGenerator*> sortedGenerators;
+    std::vector<size_t> groupStarts;
+};
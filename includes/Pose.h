@@ -0,0 +1,102 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4.h"
+
+/**
+ * \brief The local transformation of every node in a skeleton.
+ *
+ * Translations, rotations and scales are kept in separate streams per
+ * component (structure of arrays), so that blending runs over all nodes at
+ * once, four nodes per SSE instruction. Rotations are unit quaternions
+ * stored as (x, y, z, w). The streams are padded to a multiple of four
+ * nodes with identity transforms.
+ *
+ * Without SSE2, or with POSE_FORCE_SCALAR defined, blend() and
+ * addAdditive() run the scalar versions, which are always built so that
+ * they can be tested against the SSE ones.
+ *
+ * \code
+ * Pose walk(numberOfNodes), run(numberOfNodes), blended;
+ * walkClip.sample(time, true, walk, walkCache);
+ * runClip.sample(time, true, run, runCache);
+ * Pose::blend(walk, run, 0.25f, blended);
+ * \endcode
+ */
+class Pose {
+public:
+    Pose() = default;
+    explicit Pose(size_t numberOfNodes);
+
+    /**
+     * Resizes the pose. Any new nodes get the identity transform.
+     */
+    void resize(size_t numberOfNodes);
+    size_t size() const;
+
+    void setIdentity();
+    void setNode(size_t node, const chag::float3 &translation, const chag::float4 &rotation,
+                 const chag::float3 &scale);
+
+    chag::float3 getTranslation(size_t node) const;
+    chag::float4 getRotation(size_t node) const;
+    chag::float3 getScale(size_t node) const;
+
+    /**
+     * Blends two poses of the same size. Translations and scales are
+     * interpolated linearly and rotations with a normalized lerp along the
+     * shortest path.
+     *
+     * @param weight 0 gives @{code from}, 1 gives @{code to}
+     * @param result May be the same pose as one of the inputs
+     * @throws std::invalid_argument If the poses differ in size
+     */
+    static void blend(const Pose &from, const Pose &to, float weight, Pose &result);
+    static void blendScalar(const Pose &from, const Pose &to, float weight, Pose &result);
+
+    /**
+     * Applies the difference between @{code additive} and @{code reference}
+     * on top of @{code base}, scaled by weight. Used for additive layers,
+     * where the reference is usually the first frame of the additive clip.
+     *
+     * @param result May be the same pose as one of the inputs
+     * @throws std::invalid_argument If the poses differ in size
+     */
+    static void addAdditive(const Pose &base, const Pose &additive, const Pose &reference, float weight,
+                            Pose &result);
+    static void addAdditiveScalar(const Pose &base, const Pose &additive, const Pose &reference, float weight,
+                                  Pose &result);
+
+private:
+    size_t numberOfNodes = 0;
+
+    std::vector<float> translationX, translationY, translationZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    size_t paddedSize() const;
+
+    static void requireSameSize(const Pose &pose, const Pose &other);
+    // Only defined when built with SSE
+    static void blendSse(const Pose &from, const Pose &to, float weight, Pose &result);
+    static void addAdditiveSse(const Pose &base, const Pose &additive, const Pose &reference, float weight,
+                               Pose &result);
+};
@@ -0,0 +1,150 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "VirtualFileSystem.h"
+#include "TextureRole.h"
+
+class Texture;
+class Mesh;
+
+/**
+ * \brief The assets a game loads before its first frame, loaded in parallel.
+ *
+ * decode reads, decodes and imports all the assets at once on the
+ * JobSystem, followed by the textures of the meshes. upload then creates
+ * their OpenGL objects and adds them to the ResourceManager, which the
+ * game fetches them from as usual.
+ *
+ * \code
+ * PreloadManifest manifest;
+ * manifest.addFromFile("startup.manifest");
+ * manifest.addMesh("meshes/ship.obj");
+ * manifest.load();
+ * \endcode
+ *
+ * A manifest file lists one asset per line, lines starting with # are comments:
+ * \code
+ * shader simple shaders/simple.vert shaders/simple.frag
+ * texture textures/crate.png
+ * normalmap textures/crate_normal.png
+ * mesh meshes/ship.obj
+ * file sounds/engine.wav
+ * \endcode
+ */
+class PreloadManifest {
+public:
+    enum class AssetType { SHADER_PROGRAM, TEXTURE, MESH, FILE };
+
+    struct AssetTiming {
+        AssetType type;
+        std::string name;
+        // The time spent reading and decoding the asset, on whichever thread did it
+        double decodeMilliseconds;
+        double uploadMilliseconds;
+    };
+
+    void addShaderProgram(const std::string &name, const std::string &vertexShader,
+                          const std::string &fragmentShader);
+    void addTexture(const std::string &fileName, TextureRole role = TextureRole::COLOR);
+    void addMesh(const std::string &fileName);
+
+    /**
+     * Adds a file that is opened by loaders without an upload step, such as
+     * sounds, fonts and cube map faces. Decoding reads it, so that it is in
+     * memory when it is opened.
+     */
+    void addFile(const std::string &fileName);
+
+    /**
+     * Adds the assets listed in a manifest file.
+     *
+     * @return If the file could be read, lines that can not be parsed are logged and skipped
+     */
+    bool addFromFile(const std::string &manifestFileName);
+
+    /**
+     * Reads and decodes the assets that have not been decoded yet, in
+     * parallel. Touches neither OpenGL nor the ResourceManager, so it can run
+     * without a window.
+     */
+    void decode();
+
+    /**
+     * Uploads the decoded assets and adds them to the ResourceManager. Must
+     * be called from the thread owning the OpenGL context.
+     */
+    void upload();
+
+    /**
+     * Decodes and uploads the assets, returning once all of them are loaded.
+     */
+    void load();
+
+    size_t getNumberOfAssets() const;
+
+    /**
+     * The time of each asset, in the order they were added. Textures of
+     * meshes come after the assets listed.
+     */
+    std::vector<AssetTiming> getTimings() const;
+
+    //@{
+    /**
+     * The wall clock time of the last decode and upload of the manifest.
+     */
+    double getDecodeMilliseconds() const;
+    double getUploadMilliseconds() const;
+    //@}
+
+private:
+    struct Asset {
+        AssetType type;
+        std::string name;
+        std::string vertexShader;
+        std::string fragmentShader;
+        TextureRole textureRole = TextureRole::COLOR;
+
+        // The decoded asset, kept until it is uploaded
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<Mesh> mesh;
+        VirtualFile file;
+
+        bool decoded = false;
+        bool uploaded = false;
+        double decodeMilliseconds = 0.0;
+        double uploadMilliseconds = 0.0;
+    };
+
+    void add(AssetType type, const std::string &name);
+
+    /**
+     * Decodes the assets not decoded yet, in parallel.
+     */
+    void decodeAssets();
+    void decodeAsset(Asset &asset);
+    void uploadAsset(Asset &asset);
+
+    std::vector<Asset> assets;
+    double decodeMilliseconds = 0.0;
+    double uploadMilliseconds = 0.0;
+};
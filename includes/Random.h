@@ -0,0 +1,98 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "linmath/float3.h"
+
+/**
+ * \brief A small, fast and seedable random number generator (xoshiro128**).
+ *
+ * Unlike rand() every Random has its own state, so two generators never
+ * affect each other and the same seed always gives the same sequence.
+ * A Random must not be shared between threads without locking.
+ */
+class Random {
+public:
+    Random(uint64_t seed = 0);
+
+    /**
+     * Restarts the sequence from the given seed.
+     */
+    void seed(uint64_t seed);
+
+    /**
+     * The next 32 random bits.
+     */
+    uint32_t next() {
+        const uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+        const uint32_t t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft(state[3], 11);
+
+        return result;
+    }
+
+    /**
+     * A random float in [0, 1).
+     */
+    float nextFloat() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /**
+     * A random float in [min, max).
+     */
+    float nextFloat(float min, float max) {
+        return min + nextFloat() * (max - min);
+    }
+
+    /**
+     * A vector with every component a random float in [min, max).
+     */
+    chag::float3 nextVector(float min, float max);
+
+    /**
+     * Fills values with count random floats in [min, max).
+     */
+    void fill(float *values, size_t count, float min, float max);
+
+    /**
+     * The Random that getRand and createRandomVector draw from on the calling
+     * thread, or nullptr if they use rand().
+     */
+    static Random* getCurrent();
+
+    /**
+     * Makes getRand and createRandomVector draw from random on the calling
+     * thread until it is replaced. Pass nullptr to go back to rand().
+     */
+    static void setCurrent(Random *random);
+
+private:
+    static uint32_t rotateLeft(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint32_t state[4];
+};
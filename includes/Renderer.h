@@ -23,6 +23,9 @@
 #include "linmath/float4x4.h"
 #include "Effects.h"
 #include "Utils.h"
+#include "ShaderProgram.h"
+#include "AnimationStage.h"
+#include "ParticleStage.h"
 #include <memory>
 
 #define CUBE_MAP_RESOLUTION	   512
@@ -32,6 +35,8 @@ class Camera;
 class Scene;
 class ShaderProgram;
 class IDrawable;
+class InstanceBatcher;
+class UniformRingBuffer;
 
 class Renderer {
 public:
@@ -56,13 +61,51 @@ private:
     void drawShadowMap(Fbo sbo, chag::float4x4 viewProjectionMatrix, Scene *scene);
     void drawShadowCasters(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene);
     void drawTransparent(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene);
-    void setFog(std::shared_ptr<ShaderProgram> &shaderProgram);
-    void setLights(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene);
+
+    /**
+     * Handles of the scene wide uniforms of the standard fragment shader,
+     * resolved once for each program that uses it.
+     */
+    struct SceneUniformHandles {
+        UniformHandle lightMatrix;
+        UniformHandle inverseViewNormalMatrix;
+        UniformHandle viewPosition;
+        UniformHandle viewMatrix;
+        UniformHandle fogEquation;
+        UniformHandle fogDensity;
+        UniformHandle fogEnd;
+        UniformHandle fogStart;
+        UniformHandle fogColor;
+        UniformHandle hasShadowMap;
+        UniformHandle hasCubeMap;
+        UniformHandle objectReflectiveness;
+    };
+    SceneUniformHandles resolveSceneUniformHandles(std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    void setFog(std::shared_ptr<ShaderProgram> &shaderProgram, const SceneUniformHandles &handles);
+    void setLights(Scene *scene);
+    void setSceneUniforms(std::shared_ptr<ShaderProgram> &shaderProgram, const SceneUniformHandles &handles,
+                          Camera *camera, Scene *scene, chag::float4x4 &lightMatrix);
     void drawBloom(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene, int i, int i1, chag::float4x4 &viewProjectionMatrix);
 
     std::shared_ptr<ShaderProgram> shaderProgram;
+    SceneUniformHandles sceneUniformHandles;
+
+    // Streams the per frame "Matrices" and "Lights" blocks, see UniformBlocks.h
+    std::unique_ptr<UniformRingBuffer> uniformRingBuffer;
+
+    // Evaluates the poses of every animated object before the passes that draw them
+    AnimationStage animationStage;
+    ParticleStage particleStage;
+
+    // Instancing
+    std::unique_ptr<InstanceBatcher> instanceBatcher;
+    std::shared_ptr<ShaderProgram> instancedShaderProgram;
+    SceneUniformHandles instancedSceneUniformHandles;
+    std::shared_ptr<ShaderProgram> instancedShadowShaderProgram;
 
     Fbo sbo;
+    UniformHandle shadowReflectivenessHandle;
     Camera *cubeMapCameras[6];
 
 
@@ -0,0 +1,215 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "AssetId.h"
+#include "Logger.h"
+
+/**
+ * \brief The loaded resources of one type, with their memory usage and when they were last used.
+ *
+ * The items are handed out as shared pointers, so the cache can tell
+ * which items nothing outside it references anymore. Those can be evicted
+ * without anyone noticing, the least recently used first.
+ *
+ * Items are found by AssetId in an open addressing hash table. The table
+ * is never changed once published: inserting or erasing builds a new one
+ * under a lock and swaps it in. Fetching therefore only loads the current
+ * table and probes it, and is safe from any thread at any time.
+ *
+ * The use times are given by the caller, so several caches can share one clock.
+ */
+template<typename Type>
+class ResourceCache {
+public:
+    ResourceCache() : table(std::make_shared<Table>()) {}
+
+    /**
+     * The cached item, or nullptr if it is not cached.
+     * Marks the item as used at useTime.
+     */
+    std::shared_ptr<Type> fetch(AssetId id, uint64_t useTime) const {
+        std::shared_ptr<const Table> current = std::atomic_load(&table);
+        const Entry *entry = current->find(id);
+        if (entry == nullptr) {
+            return nullptr;
+        }
+        entry->lastUsed.store(useTime, std::memory_order_relaxed);
+        return entry->item;
+    }
+
+    bool contains(AssetId id) const {
+        return std::atomic_load(&table)->find(id) != nullptr;
+    }
+
+    /**
+     * @param name The name the id is hashed from, kept for finding evictable items
+     * @param memorySize The memory the item holds, in bytes
+     */
+    void insert(const std::string &name, const std::shared_ptr<Type> &item, size_t memorySize, uint64_t useTime) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        AssetId id(name);
+
+        std::vector<std::shared_ptr<Entry>> entries;
+        for (const std::shared_ptr<Entry> &entry : std::atomic_load(&table)->entries) {
+            if (entry->id != id) {
+                entries.push_back(entry);
+            } else {
+                if (entry->name != name) {
+                    Logger::logError("The asset ids of " + entry->name + " and " + name + " collide");
+                }
+                memoryUsage -= entry->memorySize;
+            }
+        }
+
+        std::shared_ptr<Entry> entry = std::make_shared<Entry>(id, name, item, memorySize, useTime);
+        entries.push_back(entry);
+        memoryUsage += memorySize;
+
+        std::atomic_store(&table, std::shared_ptr<const Table>(std::make_shared<Table>(entries)));
+    }
+
+    void erase(AssetId id) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::shared_ptr<const Table> current = std::atomic_load(&table);
+        if (current->find(id) == nullptr) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<Entry>> entries;
+        for (const std::shared_ptr<Entry> &entry : current->entries) {
+            if (entry->id != id) {
+                entries.push_back(entry);
+            } else {
+                memoryUsage -= entry->memorySize;
+            }
+        }
+        std::atomic_store(&table, std::shared_ptr<const Table>(std::make_shared<Table>(entries)));
+    }
+
+    /**
+     * Updates the memory accounted for an item whose size changed, such as a
+     * texture that streamed in more mip levels.
+     */
+    void setMemorySize(AssetId id, size_t memorySize) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const Entry *entry = std::atomic_load(&table)->find(id);
+        if (entry == nullptr) {
+            return;
+        }
+        memoryUsage -= entry->memorySize.exchange(memorySize);
+        memoryUsage += memorySize;
+    }
+
+    /**
+     * Finds the least recently used item that is only referenced by the cache.
+     *
+     * @param name Receives the name the item was inserted with
+     * @return False if every item is referenced elsewhere
+     */
+    bool findLeastRecentlyUsedUnreferenced(std::string &name, uint64_t &lastUsed) const {
+        bool found = false;
+        for (const std::shared_ptr<Entry> &entry : std::atomic_load(&table)->entries) {
+            uint64_t entryLastUsed = entry->lastUsed.load(std::memory_order_relaxed);
+            if (entry->item.use_count() == 1 && (!found || entryLastUsed < lastUsed)) {
+                name = entry->name;
+                lastUsed = entryLastUsed;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Drops every item. Items still referenced elsewhere live on until released there.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::atomic_store(&table, std::shared_ptr<const Table>(std::make_shared<Table>()));
+        memoryUsage = 0;
+    }
+
+    size_t getMemoryUsage() const {
+        return memoryUsage;
+    }
+
+    size_t size() const {
+        return std::atomic_load(&table)->entries.size();
+    }
+
+private:
+    struct Entry {
+        Entry(AssetId id, const std::string &name, const std::shared_ptr<Type> &item,
+              size_t memorySize, uint64_t lastUsed)
+            : id(id), name(name), item(item), memorySize(memorySize), lastUsed(lastUsed) {}
+
+        const AssetId id;
+        const std::string name;
+        const std::shared_ptr<Type> item;
+        mutable std::atomic<size_t> memorySize;
+        mutable std::atomic<uint64_t> lastUsed;
+    };
+
+    /**
+     * An immutable open addressing table, at most half full.
+     */
+    struct Table {
+        Table() : slots(1), mask(0) {}
+
+        Table(const std::vector<std::shared_ptr<Entry>> &entries) : entries(entries) {
+            size_t capacity = 16;
+            while (capacity < entries.size() * 2) {
+                capacity *= 2;
+            }
+            slots.resize(capacity);
+            mask = capacity - 1;
+
+            for (const std::shared_ptr<Entry> &entry : entries) {
+                size_t slot = entry->id.getHash() & mask;
+                while (slots[slot] != nullptr) {
+                    slot = (slot + 1) & mask;
+                }
+                slots[slot] = entry.get();
+            }
+        }
+
+        const Entry* find(AssetId id) const {
+            for (size_t slot = id.getHash() & mask; slots[slot] != nullptr; slot = (slot + 1) & mask) {
+                if (slots[slot]->id == id) {
+                    return slots[slot];
+                }
+            }
+            return nullptr;
+        }
+
+        // Owns the entries, which may be shared with newer tables
+        std::vector<std::shared_ptr<Entry>> entries;
+        std::vector<const Entry*> slots;
+        size_t mask;
+    };
+
+    std::shared_ptr<const Table> table;
+    std::mutex writeMutex;
+    std::atomic<size_t> memoryUsage{0};
+};
@@ -19,6 +19,16 @@
 #include <map>
 #include <sstream>
 #include <memory>
+#include <atomic>
+#include <future>
+#include "AssetId.h"
+#include "ResourceCache.h"
+#include "TextureResidency.h"
+#include "TextureRole.h"
+
+#define RESOURCE_LOADER_THREADS 2
+// At most this many textures stream mip levels at the same time
+#define TEXTURE_STREAMING_LOADS 4
 
 class Texture;
 class Mesh;
@@ -30,6 +40,32 @@ class ShaderProgram;
  * The purpose of this class is to only maintain one copy of
  * each resource in memory and then distribute them as shared pointers.
  *
+ * Resources can also be loaded asynchronously. Reading, decoding and
+ * importing then happen on RESOURCE_LOADER_THREADS loader threads, while
+ * the OpenGL upload waits for processUploads, which the game calls once
+ * per frame. The returned futures become ready once the resource is uploaded.
+ * All functions must be called from the thread owning the OpenGL context.
+ *
+ * \code
+ * std::shared_future<std::shared_ptr<Mesh>> ship = ResourceManager::loadAndFetchMeshAsync("ship.obj");
+ * // Every frame
+ * ResourceManager::processUploads(2.0);
+ * if (ship.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { ... }
+ * \endcode
+ *
+ * Fetching a resource synchronously while it is loading asynchronously
+ * waits for that load to finish.
+ *
+ * The memory held by textures and meshes is accounted for. When it exceeds
+ * the memory budget, the textures and meshes nothing else holds a pointer
+ * to are evicted, least recently fetched first. They are loaded again if
+ * fetched later. Shaders are small and are never evicted.
+ *
+ * Textures can also be streamed. They are then loaded with only their
+ * smallest mip levels, and the renderers request every texture they draw
+ * at the size it covers on screen. Once per frame, updateTextureStreaming
+ * decides which levels each texture needs within the texture streaming
+ * budget, see TextureResidency, and the loader threads decode them.
  */
 class ResourceManager {
 public:
@@ -54,9 +90,13 @@ public:
      * Tries to fetch a Texture from the ResourceManager.
      * If the Texture is not already loaded it is loaded before being fetched.
      *
+     * A texture is loaded once per file name, for the role of the first load.
+     *
      * @param fileName The name of the texture file.
+     * @param role What the texture holds, which decides how it is stored
      */
-    static std::shared_ptr<Texture> loadAndFetchTexture(const std::string &fileName);
+    static std::shared_ptr<Texture> loadAndFetchTexture(const std::string &fileName,
+                                                        TextureRole role = TextureRole::COLOR);
 
     /**
      * @brief Tries to load a Mesh into the ResourceManager and then return it.
@@ -68,32 +108,187 @@ public:
      */
     static std::shared_ptr<Mesh>    loadAndFetchMesh   (const std::string &fileName);
 
+    //@{
+    /**
+     * @brief Fetches an already loaded resource, nullptr if it is not loaded.
+     *
+     * Only costs a hash probe. Unlike the other functions these can be
+     * called from any thread.
+     *
+     * @param id The AssetId of the name or file name the resource was loaded with
+     */
+    static std::shared_ptr<ShaderProgram> fetchShaderProgram(AssetId id);
+    static std::shared_ptr<Texture>       fetchTexture      (AssetId id);
+    static std::shared_ptr<Mesh>          fetchMesh         (AssetId id);
+    //@}
+
+    //@{
+    /**
+     * @brief Adds a resource that was loaded elsewhere, such as by a PreloadManifest.
+     *
+     * The resource must already be uploaded. If a resource is already loaded
+     * under the name, that one is kept and returned instead.
+     *
+     * @return The resource loaded under the name
+     */
+    static std::shared_ptr<ShaderProgram> addShaderProgram(const std::string &name,
+                                                           std::shared_ptr<ShaderProgram> shaderProgram);
+    static std::shared_ptr<Texture> addTexture(const std::string &fileName, std::shared_ptr<Texture> texture);
+    static std::shared_ptr<Mesh>    addMesh   (const std::string &fileName, std::shared_ptr<Mesh> mesh);
+    //@}
 
-private:
-    static std::map<std::string, std::shared_ptr<ShaderProgram>> shaders;
-    static std::map<std::string, std::shared_ptr<Texture>> textures;
-    static std::map<std::string, std::shared_ptr<Mesh>> meshes;
+    /**
+     * @brief Loads a ShaderProgram in the background, see loadAndFetchShaderProgram.
+     *
+     * The shader sources are read on a loader thread and compiled by processUploads.
+     */
+    static std::shared_future<std::shared_ptr<ShaderProgram>> loadAndFetchShaderProgramAsync(
+            const std::string &name, const std::string &vertexShader, const std::string &fragmentShader);
 
     /**
-     * @brief Loads a ShaderProgram into the ResourceManager
+     * @brief Loads a Texture in the background, see loadAndFetchTexture.
+     *
+     * The image is decoded on a loader thread and uploaded by processUploads.
+     */
+    static std::shared_future<std::shared_ptr<Texture>> loadAndFetchTextureAsync(
+            const std::string &fileName, TextureRole role = TextureRole::COLOR);
+
+    /**
+     * @brief Loads a Mesh in the background, see loadAndFetchMesh.
+     *
+     * The mesh is imported on a loader thread, then its textures are loaded
+     * asynchronously as well. The mesh is uploaded by processUploads once
+     * all its textures are.
+     */
+    static std::shared_future<std::shared_ptr<Mesh>> loadAndFetchMeshAsync(const std::string &fileName);
+
+    /**
+     * @brief Uploads the resources that have finished loading in the background.
+     *
+     * Call once per frame. Stops starting new uploads once the budget is spent,
+     * but uploads at least one resource if any is ready.
+     *
+     * @param budgetInMilliseconds How long the uploads may take, negative for no limit
+     */
+    static void processUploads(double budgetInMilliseconds);
+
+    /**
+     * @brief The number of asynchronous loads not yet uploaded.
+     */
+    static size_t getNumberOfPendingLoads();
+
+    /**
+     * @brief Sets how many bytes textures and meshes may use before unused ones are evicted.
+     *
+     * Zero, the default, never evicts anything.
+     */
+    static void setMemoryBudget(size_t bytes);
+    static size_t getMemoryBudget();
+
+    static size_t getTextureMemoryUsage();
+    static size_t getMeshMemoryUsage();
+    static size_t getMemoryUsage();
+
+    /**
+     * @brief Evicts unused textures and meshes until the memory usage is within the budget.
+     *
+     * Is called after every load and by processUploads, call it after
+     * releasing many resources to free them right away.
+     */
+    static void enforceMemoryBudget();
+
+    /**
+     * @brief Releases every resource the ResourceManager holds and forgets the pending loads.
+     *
+     * Textures and meshes delete their OpenGL objects when released, so call
+     * it while the context is still current. Window::start does once its loop
+     * ends, before the caches would otherwise be destroyed along with the
+     * other statics, after the context is gone. Resources still referenced
+     * elsewhere are released when their last user lets go of them.
+     */
+    static void clear();
+
+    /**
+     * @brief Enables the asset cache, which is disabled by default.
+     *
+     * Imported meshes are then converted into binary meshes, see
+     * Mesh::importMesh, and images compressed, see Texture::decodeTexture,
+     * into files next to them, which later loads map instead. Set it before
+     * loading any meshes or textures.
      */
-    static void loadShader(const std::string &vertexShader,
-                           const std::string &fragmentShader,
-                           const std::string &name);
+    static void setAssetCacheEnabled(bool enabled);
+    static bool isAssetCacheEnabled();
 
     /**
-     * @brief Gets a already loaded ShaderProgram from the ResourceManager 
+     * @brief Streams the mip levels of the textures loaded from now on.
+     *
+     * Textures loaded before keep all their levels. Disabled by default.
      */
-    static std::shared_ptr<ShaderProgram> getShader(const std::string &name);
+    static void setTextureStreaming(bool enabled);
+    static bool isTextureStreaming();
 
-    static void loadTexture(const std::string &fileName);
-    static std::shared_ptr<Texture> getTexture(const std::string &fileName);
+    /**
+     * @brief The size new textures are decoded at, see Texture::decodeTexture.
+     *
+     * Only their smallest levels when streaming, otherwise the full image.
+     */
+    static int getTextureDecodeSize();
 
-    static void loadMesh(const std::string &fileName);
-    static std::shared_ptr<Mesh> getMesh(const std::string &fileName);
+    /**
+     * @brief Sets how many bytes the streamed textures may use. Zero, the default, is no limit.
+     */
+    static void setTextureStreamingBudget(size_t bytes);
+    static size_t getTextureStreamingBudget();
 
-    template<typename Type>
-    static std::shared_ptr<Type> getItemFromMap(std::map<std::string, std::shared_ptr<Type>> &map,
-                                                const std::string &id) ;
+    /**
+     * @brief Requests the texture at the size it covers on screen this frame.
+     *
+     * Of several requests in a frame the largest counts. Textures that are
+     * not streamed, or not loaded by the ResourceManager, are ignored.
+     *
+     * @param texture May be null
+     * @param screenSizeInPixels The larger side of the area the texture covers
+     */
+    static void requestTextureSize(Texture *texture, float screenSizeInPixels);
+
+    /**
+     * @brief Picks the mip levels of the streamed textures from this frame's requests and starts streaming them.
+     *
+     * Renderer::drawScene calls it once per frame. Textures no longer drawn
+     * drop back to their smallest levels after a while, see
+     * TextureResidency::setHoldFrames. The new levels are decoded on the
+     * loader threads and swapped in by processUploads.
+     */
+    static void updateTextureStreaming();
+
+
+private:
+    static ResourceCache<ShaderProgram> shaders;
+    static ResourceCache<Texture> textures;
+    static ResourceCache<Mesh> meshes;
+
+    static size_t memoryBudget;
+
+    static TextureResidency textureResidency;
+    static bool textureStreaming;
+    static bool assetCacheEnabled;
+
+    // Incremented on every fetch, to tell which resources were used most recently
+    static std::atomic<uint64_t> useClock;
+
+    /**
+     * @brief Loads a ShaderProgram into the ResourceManager
+     */
+    static std::shared_ptr<ShaderProgram> loadShader(const std::string &vertexShader,
+                                                     const std::string &fragmentShader,
+                                                     const std::string &name);
+
+    static std::shared_ptr<Texture> loadTexture(const std::string &fileName, TextureRole role);
+    static std::shared_ptr<Mesh> loadMesh(const std::string &fileName);
+
+    /**
+     * @brief Caches an uploaded texture, and streams it if streaming is enabled.
+     */
+    static void insertTexture(const std::string &fileName, const std::shared_ptr<Texture> &texture);
 
 };
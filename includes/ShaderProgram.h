@@ -23,6 +23,12 @@
 #include "linmath/float3.h"
 #include "IShader.h"
 
+/**
+ * A uniform location resolved once by ShaderProgram::getUniformHandle().
+ * Setting a uniform through its handle skips the name lookup entirely.
+ */
+typedef GLint UniformHandle;
+
 /**
  * \brief Class for maintaining OpenGL shader programs.
  *
@@ -62,16 +68,42 @@ public:
      */
     void restorePreviousShaderProgram();
 
-    void setUniform1i(std::string name, int value);
-    void setUniform1f(std::string name, float value);
-    void setUniform2f(std::string name, chag::float2 value);
-    void setUniform3f(std::string name, chag::float3 value);
-    void setUniform4f(std::string name, chag::float4 value);
-    void setUniformMatrix4fv(std::string name, chag::float4x4 matrix);
+    /**
+     * Identifies the program linked by the last loadShader(). Every link gets
+     * a new generation, unique across all ShaderPrograms, so a cache of
+     * handles keyed by it is never fooled by a relinked program or by a new
+     * ShaderProgram at the address of a deleted one. Zero until loaded.
+     */
+    unsigned int getGeneration() const;
+
+    /**
+     * Resolves the location of a uniform so that it can be set by handle
+     * later on. Resolve handles once, e.g. when the program is loaded, and
+     * keep them around; they are only valid for this ShaderProgram.
+     */
+    UniformHandle getUniformHandle(const std::string &name);
+
+    void setUniform1i(const std::string &name, int value);
+    void setUniform1f(const std::string &name, float value);
+    void setUniform2f(const std::string &name, const chag::float2 &value);
+    void setUniform3f(const std::string &name, const chag::float3 &value);
+    void setUniform4f(const std::string &name, const chag::float4 &value);
+    void setUniformMatrix4fv(const std::string &name, const chag::float4x4 &matrix);
+
+    void setUniform1i(UniformHandle handle, int value);
+    void setUniform1f(UniformHandle handle, float value);
+    void setUniform2f(UniformHandle handle, const chag::float2 &value);
+    void setUniform3f(UniformHandle handle, const chag::float3 &value);
+    void setUniform4f(UniformHandle handle, const chag::float4 &value);
+    void setUniformMatrix4fv(UniformHandle handle, const chag::float4x4 &matrix);
+    /**
+     * Uploads an array of matrices starting at the given handle in one call.
+     */
+    void setUniformMatrix4fv(UniformHandle handle, const chag::float4x4 *matrices, int count);
 
-    void setUniformBufferObjectBinding(std::string bufferName, int index);
-    void initUniformBufferObject(std::string bufferName, int size, int index);
-    void setUniformBufferSubData(std::string bufferName, int offset, int size, const GLvoid *data);
+    void setUniformBufferObjectBinding(const std::string &bufferName, int index);
+    void initUniformBufferObject(const std::string &bufferName, int size, int index);
+    void setUniformBufferSubData(const std::string &bufferName, int offset, int size, const GLvoid *data);
 
 private:
 
@@ -81,12 +113,13 @@ private:
 
     void createProgram(GLuint vertexShader, GLuint fragmentShader);
 
-    GLint getUniformLocation(std::string name);
+    GLint getUniformLocation(const std::string &name);
 
     IShader* vertexShader;
     IShader* fragmentShader;
 
     GLuint shaderID;
+    unsigned int generation = 0;
     std::map<std::string, GLint> uniformLocations;
     GLint previousShaderProgram;
 
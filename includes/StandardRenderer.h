@@ -17,13 +17,18 @@
 #pragma once
 
 #include "IRenderComponent.h"
+#include "ShaderProgram.h"
 #include "SFML/Window.hpp"
+#include "linmath/float4x4.h"
+#include "AnimationState.h"
 #include <memory>
+#include <vector>
 
 class Mesh;
 class ShaderProgram;
 class GameObject;
 class Chunk;
+struct Material;
 
 /**
  * \brief Renders meshes with the default shader
@@ -42,12 +47,77 @@ public:
     void render();
     void renderShadow(std::shared_ptr<ShaderProgram> &shaderProgram);
     void renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    /**
+     * The mesh can be instanced as long as it is drawn with the given shader
+     * and isn't animated, since the instanced shaders have no bone support.
+     */
+    Mesh* getInstanceableMesh(const std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    /**
+     * Shadows are drawn with the shader of the pass, so the mesh can be
+     * instanced in any shadow pass as long as it isn't animated.
+     */
+    Mesh* getInstanceableShadowMesh(const std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    void addToAnimationStage(AnimationStage &animationStage, SkinnedCollisionMesh *collisionMesh);
+    const std::vector<chag::float4x4>* getBoneTransforms();
+
+    /**
+     * Requests the textures of the mesh at the size of its bounding sphere
+     * on screen, as if the textures were mapped once across the mesh.
+     */
+    void requestTextureSizes(const chag::float3 &cameraPosition, float pixelsPerUnit);
+
+    /**
+     * Binds the uniform blocks and texture units that the standard shaders
+     * read materials and lights from. Only needs to be done once per program,
+     * the shader program must be in use. Also used by Renderer for its own
+     * programs that share the standard fragment shaders.
+     */
+    static void initShaderProgram(std::shared_ptr<ShaderProgram> &shaderProgram);
+
+    /**
+     * The animation playback of the object, used for choosing and blending
+     * clips. Null if the mesh has no animations.
+     */
+    AnimationState* getAnimationState();
 private:
+    /**
+     * Handles of the per object uniforms, resolved the first time an object
+     * is drawn with a program. Each render pass keeps its own set since the
+     * passes use different programs.
+     */
+    struct ObjectUniformHandles {
+        // The ShaderProgram::getGeneration() of the program they were resolved for
+        unsigned int shaderProgramGeneration = 0;
+        UniformHandle modelMatrix;
+        UniformHandle normalMatrix;
+        UniformHandle hasAnimations;
+        UniformHandle bones;
+    };
+
     std::shared_ptr<Mesh> mesh;
     GameObject *gameObject;
-    sf::Clock clock;
+    std::unique_ptr<AnimationState> animationState;
+
+    /**
+     * If the pose of the animation state is older than the last update(). It
+     * is evaluated at most once per frame and shared by all passes and
+     * chunks. Usually by the AnimationStage, otherwise on the first render
+     * after update().
+     */
+    bool poseIsDirty = true;
+    // If the collision mesh hasn't been skinned with the palette since the animation advanced
+    bool collisionIsDirty = true;
+
+    ObjectUniformHandles renderHandles;
+    ObjectUniformHandles shadowHandles;
+    ObjectUniformHandles emissiveHandles;
 
-    void setBones(std::shared_ptr<ShaderProgram> &shaderProgram) const;
+    void resolveUniformHandles(std::shared_ptr<ShaderProgram> &shaderProgram, ObjectUniformHandles &handles);
+    void updatePose();
+    void setBones(std::shared_ptr<ShaderProgram> &shaderProgram, const ObjectUniformHandles &handles);
 };
 
 
@@ -19,20 +19,137 @@
 #include <GL/glew.h>
 #include <FreeImage.h>
 #include <string>
+#include "VirtualFileSystem.h"
+#include "TextureRole.h"
 
 class Texture {
 public:
     Texture() {};
     Texture(GLuint textureID): textureID(textureID) {};
+    ~Texture();
     void bind(GLenum textureUnit);
     void loadTexture(std::string fileName);
+
+    /**
+     * Reads and decodes the image file, without touching OpenGL.
+     * Can be called from any thread.
+     *
+     * With the asset cache enabled, see ResourceManager::setAssetCacheEnabled,
+     * the image is block compressed along with its mip levels the first time
+     * it is loaded, into a file next to it, see TextureFile.h. Later loads only map the compressed levels from
+     * there, until the image changes.
+     *
+     * @param maxSize Halves the image until neither side is larger, keeping
+     *                only the smaller mip levels. Zero keeps the full image.
+     * @return False, after logging why, if the image could not be decoded
+     */
+    bool decodeTexture(const std::string &fileName, int maxSize = 0, TextureRole role = TextureRole::COLOR);
+
+    /**
+     * Creates the OpenGL texture from the decoded image and frees the image.
+     * Must be called from the thread owning the OpenGL context.
+     */
+    void uploadTexture();
     GLuint getID();
 
+    /**
+     * Exchanges the images of the textures, such as a resident texture and
+     * one just uploaded with more or fewer mip levels. Whoever holds either
+     * texture then draws the other image.
+     */
+    void swap(Texture &other);
+
+    //@{
+    /**
+     * The size of the full image, even when only smaller levels are resident.
+     */
     int getHeight();
     int getWidth();
+    //@}
+
+    /**
+     * The first mip level of the full image that is uploaded, zero unless
+     * the image was decoded with a maxSize.
+     */
+    int getResidentLevel();
+
+    const std::string& getFileName();
+    TextureRole getRole();
+
+    /**
+     * If the texture is a normal map uploaded with only its x and y, which
+     * is all of them but those decoded from grey images.
+     */
+    bool isTwoChannelNormalMap();
+
+    /**
+     * The memory used by the uploaded texture and its mipmaps, in bytes.
+     */
+    size_t getMemorySize();
+
+    /**
+     * The bits per texel of the uploaded texture, four or eight when block compressed.
+     */
+    int getBitsPerTexel();
+
+    /**
+     * Configures stb_image the way every texture expects its images. Safe
+     * to call from any thread, only the first call has an effect.
+     */
+    static void setupImageDecoder();
+
+    /**
+     * Compresses the image into the texture cache for the role, unless it
+     * is there already, whether the asset cache is enabled or not. Needs no OpenGL context,
+     * so tools can fill the cache ahead of time, for example to ship it in a pack.
+     *
+     * @return If the cache has the compressed image
+     */
+    static bool transcodeTexture(const std::string &fileName, TextureRole role = TextureRole::COLOR);
 
 private:
 
-    GLuint textureID;
+    GLuint textureID = 0;
+    // Only textures loaded from a file are deleted along with the Texture
+    bool ownsTexture = false;
     int width,height;
+    int residentLevel = 0;
+    int bitsPerTexel = 32;
+    std::string fileName;
+    TextureRole role = TextureRole::COLOR;
+    bool twoChannelNormalMap = false;
+
+    // The decoded image, only kept between decodeTexture and uploadTexture
+    unsigned char *image = nullptr;
+    int components = 0;
+    int imageLevel = 0;
+    // Or the compressed levels when the image was found in the texture cache
+    VirtualFile compressedFile;
+    // The BlockFormat of compressedFile
+    int compressedFormat = 0;
+
+    /**
+     * Replaces the image with its next mip level, of half the size.
+     */
+    static void halveImage(unsigned char *image, int width, int height, int components);
+
+    /**
+     * Maps the compressed levels of the image from the texture cache, if
+     * they are there, up to date and compressed for the role, keeping the
+     * levels no larger than maxSize.
+     */
+    bool readTextureFile(const std::string &fileName, int maxSize);
+
+    /**
+     * Compresses the image and its mip levels into the texture cache.
+     */
+    static bool writeTextureFile(const std::string &fileName, uint64_t sourceHash, TextureRole role,
+                                 const unsigned char *image, int width, int height, int components);
+
+    /**
+     * A 64 bit FNV-1a hash of the contents of an image.
+     */
+    static uint64_t hashSource(const VirtualFile &source);
+
+    void uploadCompressedLevels();
 };
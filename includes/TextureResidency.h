@@ -0,0 +1,172 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetId.h"
+
+// Mip levels this size and smaller are always resident, so a streamed texture can always be drawn
+#define TEXTURE_STREAMING_TAIL_SIZE 64
+// How many updates a texture keeps its level after it was last requested that large
+#define TEXTURE_STREAMING_DEFAULT_HOLD_FRAMES 60
+
+/**
+ * \brief Decides which mip levels of the streamed textures should be resident.
+ *
+ * Each streamed texture keeps a contiguous range of its mip levels, from
+ * its resident level down to the smallest one. Every frame, the renderers
+ * request each texture at the size it covers on screen. update() then
+ * picks the level each texture should have resident: the smallest level
+ * still at least as large as the largest request. A texture only gives up
+ * a level once it has been requested smaller for a number of frames, so
+ * objects moving back and forth, or briefly out of view, do not make it
+ * stream the same levels over and over. Textures no longer requested at all
+ * then fall back to their tail, the levels no larger than
+ * TEXTURE_STREAMING_TAIL_SIZE.
+ *
+ * Textures that have never been requested are not tracked by the requests,
+ * so they keep whatever levels they have resident.
+ *
+ * When the picked levels do not fit in the memory budget, top levels are
+ * dropped from the requested textures with the most texels per covered
+ * pixel first. The tails and the textures that are never requested are
+ * never dropped, so they may exceed a small budget on their own.
+ *
+ * This class only does the bookkeeping and never touches OpenGL, the
+ * ResourceManager does the actual streaming.
+ */
+class TextureResidency {
+public:
+    /**
+     * A texture whose resident level differs from its target level.
+     */
+    struct Change {
+        std::string name;
+        int width;
+        int height;
+        int residentLevel;
+        int targetLevel;
+    };
+
+    /**
+     * Sets how many bytes the streamed textures may use. Zero, the default, is no limit.
+     */
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+
+    /**
+     * Sets for how many updates a texture keeps its level after the last
+     * request that large. Zero follows the requests of every update.
+     */
+    void setHoldFrames(int frames);
+    int getHoldFrames() const;
+
+    /**
+     * Starts tracking a texture, with the levels from residentLevel down resident.
+     * Its target is its resident level until the next update.
+     *
+     * @param bitsPerTexel Less than 32 for block compressed textures
+     */
+    void add(const std::string &name, int width, int height, int residentLevel, int bitsPerTexel = 32);
+    void remove(AssetId id);
+    void clear();
+    bool contains(AssetId id) const;
+    size_t size() const;
+
+    /**
+     * Requests the texture at the given size for this frame. Of several
+     * requests before the next update, the largest counts. Requests for
+     * textures that are not tracked are ignored.
+     *
+     * @param screenSizeInPixels The larger side of the area the texture covers on screen
+     */
+    void requestScreenSize(AssetId id, float screenSizeInPixels);
+
+    /**
+     * Picks the target level of every texture from the requests since the
+     * last update and the ones held from before, within the memory budget,
+     * and forgets the requests.
+     */
+    void update();
+
+    /**
+     * The textures whose resident levels differ from their targets. The
+     * ones dropping levels come first, since they free the memory the
+     * others need, then the ones gaining levels, the most undersampled first.
+     */
+    std::vector<Change> getChanges() const;
+
+    //@{
+    /**
+     * -1 if the texture is not tracked.
+     */
+    int getTargetLevel(AssetId id) const;
+    int getResidentLevel(AssetId id) const;
+    //@}
+
+    /**
+     * Records that the texture now has the levels from level down resident.
+     */
+    void setResidentLevel(AssetId id, int level);
+
+    size_t getResidentMemoryUsage() const;
+    size_t getTargetMemoryUsage() const;
+
+    static int getNumberOfLevels(int width, int height);
+
+    /**
+     * The first level that is no larger than TEXTURE_STREAMING_TAIL_SIZE.
+     */
+    static int getTailLevel(int width, int height);
+
+    /**
+     * The smallest level that is still at least screenSizeInPixels large,
+     * which is the level the GPU samples when the texture covers that size.
+     */
+    static int selectLevel(int width, int height, float screenSizeInPixels);
+
+    /**
+     * The memory used by the levels from firstLevel down.
+     */
+    static size_t getMemorySize(int width, int height, int firstLevel, int bitsPerTexel = 32);
+
+private:
+    struct Entry {
+        std::string name;
+        int width;
+        int height;
+        int residentLevel;
+        int targetLevel;
+        int bitsPerTexel;
+        // The largest size requested since the last update, zero if none
+        float requestedSize;
+        // The size the target level is picked for, kept until smaller requests have lasted holdFrames updates
+        float heldSize;
+        int framesSinceHeldRequest;
+        // If the texture has been requested since it was added
+        bool requested;
+    };
+
+    // Keyed by the hash of the AssetId
+    std::unordered_map<uint64_t, Entry> entries;
+    size_t memoryBudget = 0;
+    int holdFrames = TEXTURE_STREAMING_DEFAULT_HOLD_FRAMES;
+};
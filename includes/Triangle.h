@@ -29,6 +29,11 @@ public:
 
 	BoundingBox *getBoundingBox();
 
+	/**
+	 * Moves the corners of the triangle and updates its bounding box.
+	 */
+	void setPoints(chag::float3 p1, chag::float3 p2, chag::float3 p3);
+
 	chag::float3 p1;
   chag::float3 p2;
   chag::float3 p3;
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include "linmath/float3.h"
+
+/**
+ * C++ mirrors of the std140 uniform blocks declared in the standard shaders.
+ *
+ * Under std140 every vec3 starts on a 16 byte boundary, and so does every
+ * struct and array element, which is why the structs below are padded by
+ * hand. The layouts must be kept in sync with shaders/simple.frag and
+ * shaders/emissive.frag; the static_asserts at the bottom catch the most
+ * common mistakes.
+ */
+
+#define UNIFORM_BLOCK_MAX_POINT_LIGHTS 4
+#define UNIFORM_BLOCK_MAX_SPOT_LIGHTS  4
+
+struct LightColorsStd140 {
+    chag::float3 ambientColor;
+    float padding0;
+    chag::float3 diffuseColor;
+    float padding1;
+    chag::float3 specularColor;
+    float padding2;
+};
+
+struct AttenuationStd140 {
+    float constant;
+    float linear;
+    float exp;
+    float padding;
+};
+
+struct DirectionalLightStd140 {
+    LightColorsStd140 colors;
+    chag::float3 direction;
+    float padding;
+};
+
+struct PointLightStd140 {
+    LightColorsStd140 colors;
+    chag::float3 position;
+    float padding;
+    AttenuationStd140 attenuation;
+};
+
+struct SpotLightStd140 {
+    LightColorsStd140 colors;
+    chag::float3 position;
+    float padding0;
+    chag::float3 direction;
+    float cutoff;
+    float cutoffOuter;
+    float padding1[3];
+    AttenuationStd140 attenuation;
+};
+
+/**
+ * The "Lights" block, uploaded once per frame by the Renderer.
+ */
+struct LightsBlockStd140 {
+    DirectionalLightStd140 directionalLight;
+    PointLightStd140 pointLights[UNIFORM_BLOCK_MAX_POINT_LIGHTS];
+    SpotLightStd140 spotLights[UNIFORM_BLOCK_MAX_SPOT_LIGHTS];
+    int nrPointLights;
+    int nrSpotLights;
+    int padding[2];
+};
+
+/**
+ * The "Material" block, uploaded once whenever a Material changes.
+ */
+struct MaterialBlockStd140 {
+    chag::float3 diffuseColor;
+    float padding0;
+    chag::float3 specularColor;
+    float padding1;
+    chag::float3 ambientColor;
+    float padding2;
+    chag::float3 emissiveColor;
+    float shininess;
+    int hasDiffuseTexture;
+    int hasNormalTexture;
+    int hasEmissiveTexture;
+    int hasTwoChannelNormalTexture;
+};
+
+static_assert(sizeof(chag::float3) == 12, "std140 mirrors assume a tightly packed float3");
+static_assert(sizeof(DirectionalLightStd140) == 64, "DirectionalLight does not match std140");
+static_assert(sizeof(PointLightStd140) == 80, "PointLight does not match std140");
+static_assert(offsetof(SpotLightStd140, cutoff) == 76, "SpotLight does not match std140");
+static_assert(offsetof(SpotLightStd140, attenuation) == 96, "SpotLight does not match std140");
+static_assert(sizeof(SpotLightStd140) == 112, "SpotLight does not match std140");
+static_assert(offsetof(LightsBlockStd140, spotLights) == 384, "Lights block does not match std140");
+static_assert(offsetof(LightsBlockStd140, nrPointLights) == 832, "Lights block does not match std140");
+static_assert(offsetof(MaterialBlockStd140, shininess) == 60, "Material block does not match std140");
+static_assert(sizeof(MaterialBlockStd140) == 80, "Material block does not match std140");
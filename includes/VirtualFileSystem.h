@@ -0,0 +1,114 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+class MappedFile;
+
+/**
+ * A read-only view of the contents of a file, either inside a mounted pack
+ * or mapped from disk. The contents stay valid as long as the VirtualFile,
+ * or a copy of it, is alive.
+ */
+class VirtualFile {
+public:
+    VirtualFile() = default;
+
+    /**
+     * If the file was found.
+     */
+    bool isOpen() const;
+
+    const char *getData() const;
+    size_t getSize() const;
+
+    /**
+     * A copy of the contents, for text files.
+     */
+    std::string getText() const;
+
+private:
+    friend class VirtualFileSystem;
+
+    VirtualFile(std::shared_ptr<const MappedFile> file, const char *data, size_t size);
+
+    // Keeps the pack or the file mapped
+    std::shared_ptr<const MappedFile> file;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * Resolves the files read by all loaders. Files are looked up in the mounted
+ * packs first and on disk otherwise.
+ *
+ * A pack collects many files into one with a hashed table of contents, see
+ * PackFile.h. It is mapped once when mounted, so opening a file in it is a
+ * hash probe instead of a file system call, and files that are loaded
+ * together are read from one place on disk.
+ *
+ * \code
+ * VirtualFileSystem::writePack("assets.pack", { "meshes/cube.obj", "meshes/cube.png" });
+ * VirtualFileSystem::mountPack("assets.pack");
+ * VirtualFile file = VirtualFileSystem::openFile("meshes/cube.obj");
+ * \endcode
+ *
+ * All functions can be called from any thread.
+ */
+class VirtualFileSystem {
+public:
+    /**
+     * Maps the pack and adds its files. Files in packs mounted later take
+     * precedence over files with the same name in earlier packs.
+     *
+     * @return If the pack could be mounted
+     */
+    static bool mountPack(const std::string &packFileName);
+
+    /**
+     * Removes all the mounted packs. Files opened from them stay valid.
+     */
+    static void unmountPacks();
+
+    /**
+     * Opens a file, from the mounted packs if any of them has it.
+     *
+     * @return The file, which is not open if it could not be found
+     */
+    static VirtualFile openFile(const std::string &fileName);
+
+    /**
+     * If the file is in any of the mounted packs or on disk.
+     */
+    static bool exists(const std::string &fileName);
+
+    /**
+     * Writes the files into a pack, named as they are given.
+     *
+     * @return If all the files could be read and the pack written
+     */
+    static bool writePack(const std::string &packFileName, const std::vector<std::string> &fileNames);
+
+    /**
+     * Removes redundant separators, "." and ".." from a path and uses '/' as
+     * separator, so that every name of a file in a pack finds it.
+     */
+    static std::string normalizePath(const std::string &path);
+};
@@ -19,10 +19,20 @@
 
 #define UNIFORM_BUFFER_OBJECT_MATRICES_NAME "Matrices"
 #define UNIFORM_BUFFER_OBJECT_MATRICES_INDEX 0
+#define UNIFORM_BUFFER_OBJECT_LIGHTS_NAME "Lights"
+#define UNIFORM_BUFFER_OBJECT_LIGHTS_INDEX 1
+#define UNIFORM_BUFFER_OBJECT_MATERIAL_NAME "Material"
+#define UNIFORM_BUFFER_OBJECT_MATERIAL_INDEX 2
+
+#define DIFFUSE_TEXTURE_LOCATION 0
+#define NORMAL_TEXTURE_LOCATION 3
+#define EMISSIVE_TEXTURE_LOCATION 4
 
 
 #define SIMPLE_SHADER_NAME "simple_shader"
 #define EMISSIVE_SHADER_NAME "emissive_shader"
+#define SIMPLE_INSTANCED_SHADER_NAME "simple_instanced_shader"
+#define SHADOW_INSTANCED_SHADER_NAME "shadow_instanced_shader"
 
 
 
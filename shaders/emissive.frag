@@ -1,8 +1,18 @@
 #version 330
 in vec2 texCoord;
 
-uniform vec3 material_emissive_color;
-uniform int has_emissive_texture;
+// Same std140 block as in simple.frag, so materials only need one buffer.
+layout(std140) uniform Material {
+    vec3 material_diffuse_color;
+    vec3 material_specular_color;
+    vec3 material_ambient_color;
+    vec3 material_emissive_color;
+    float material_shininess;
+    int has_diffuse_texture;
+    int has_normal_texture;
+    int has_emissive_texture;
+    int has_two_channel_normal_texture;
+};
 uniform sampler2D emissive_texture;
 
 // output to frame buffer.
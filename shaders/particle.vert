@@ -1,10 +1,13 @@
 #version 330
 
-#define scale 0.1
-in	vec3	position;
-in	vec2	texCoordIn;
+#extension GL_ARB_explicit_attrib_location : enable
 
-uniform mat4 modelMatrix;
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoordIn;
+layout(location = 2) in vec4 instance; // Position in xyz and size in w
+
+uniform mat4 billboardMatrix;
+uniform vec3 particleScale;
 
 layout(std140) uniform Matrices {
     mat4 viewMatrix;
@@ -16,5 +19,6 @@ out	vec2	texCoord;
 
 void main() {
 	texCoord = texCoordIn;
-	gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
-}
\ No newline at end of file
+	vec3 offset = (billboardMatrix * vec4(position * particleScale * instance.w, 0.0)).xyz;
+	gl_Position = viewProjectionMatrix * vec4(instance.xyz + offset, 1.0);
+}
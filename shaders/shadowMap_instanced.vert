@@ -0,0 +1,13 @@
+#version 330
+
+#extension GL_ARB_explicit_attrib_location : enable
+
+precision highp float;
+
+layout(location = 0) in vec3 position;
+layout(location = 8) in mat4 modelMatrix;
+uniform mat4 viewProjectionMatrix;
+
+void main() {
+	gl_Position = viewProjectionMatrix * modelMatrix* vec4(position, 1.0);
+}
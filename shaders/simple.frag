@@ -16,6 +16,8 @@ uniform struct Fog {
 	int iEquation;
 } fog;
 
+// The light and material blocks are std140 and mirrored on the CPU side in
+// includes/UniformBlocks.h, keep the two in sync.
 struct Light
 {
 	vec3 ambientColor;
@@ -51,12 +53,15 @@ struct PointLight{
 
 #define MAX_POINT_LIGHTS 4
 #define MAX_SPOT_LIGHTS  4
-uniform int nrPointLights = 0;
-uniform int nrSpotLights  = 0;
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform SpotLight  spotLights [MAX_SPOT_LIGHTS];
-uniform DirectionalLight directionalLight;
 
+// global lights, uploaded once per frame.
+layout(std140) uniform Lights {
+	DirectionalLight directionalLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	SpotLight  spotLights [MAX_SPOT_LIGHTS];
+	int nrPointLights;
+	int nrSpotLights;
+};
 
 // inputs from vertex shader.
 in vec4 color;
@@ -85,16 +90,20 @@ uniform samplerCube cubeMap;
 float object_alpha;
 uniform float object_reflectiveness;
 
-// matrial properties, changed when material changes.
-uniform float material_shininess;
-uniform vec3 material_diffuse_color;
-uniform vec3 material_specular_color;
-uniform vec3 material_emissive_color;
-uniform int has_diffuse_texture;
+// matrial properties, uploaded once per material and bound when material changes.
+layout(std140) uniform Material {
+	vec3 material_diffuse_color;
+	vec3 material_specular_color;
+	vec3 material_ambient_color;
+	vec3 material_emissive_color;
+	float material_shininess;
+	int has_diffuse_texture;
+	int has_normal_texture;
+	int has_emissive_texture;
+	int has_two_channel_normal_texture;
+};
 uniform sampler2D diffuse_texture;
-uniform int has_normal_texture;
 uniform sampler2D normal_texture;
-uniform int has_emissive_texture;
 uniform sampler2D emissive_texture;
 
 
@@ -115,8 +124,15 @@ void main()
 {
 	vec3 normal;
 	if (has_normal_texture == 1) {
-		normal = texture(normal_texture, texCoord.xy).xyz;
-		normal = normalize(normal * 2.0 - 1.0);
+		if (has_two_channel_normal_texture == 1) {
+			// Only x and y are stored, z is positive in tangent space
+			normal.xy = texture(normal_texture, texCoord.xy).xy * 2.0 - 1.0;
+			normal.z = sqrt(max(0.0, 1.0 - dot(normal.xy, normal.xy)));
+		}
+		else {
+			normal = texture(normal_texture, texCoord.xy).xyz;
+			normal = normalize(normal * 2.0 - 1.0);
+		}
 		normal = normalize(TBN * normal);
 	}
 	else {
@@ -0,0 +1,147 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "AsyncLoader.h"
+#include "timer.h"
+#include "JobSystem.h"
+
+AsyncLoader::AsyncLoader(unsigned int numberOfThreads) {
+    if (numberOfThreads == 0) {
+        numberOfThreads = 1;
+    }
+    for (unsigned int i = 0; i < numberOfThreads; i++) {
+        threads.push_back(std::thread(&AsyncLoader::work, this));
+    }
+}
+
+AsyncLoader::~AsyncLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    loadCondition.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<AsyncLoader::Task> AsyncLoader::submit(std::function<void()> load, std::function<bool()> upload) {
+    std::shared_ptr<Task> task = std::make_shared<Task>();
+    task->load = std::move(load);
+    task->upload = std::move(upload);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.push_back(task);
+        numberOfPendingTasks++;
+    }
+    loadCondition.notify_one();
+    return task;
+}
+
+void AsyncLoader::work() {
+    // Loads such as compressing textures would otherwise hold the workers while the frame waits for them
+    JobSystem::setRunSerially(true);
+    while (true) {
+        std::shared_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            loadCondition.wait(lock, [this]() { return stopping || !loads.empty(); });
+            if (stopping) {
+                return;
+            }
+            task = loads.front();
+            loads.pop_front();
+        }
+
+        task->load();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task->loaded = true;
+            uploads.push_back(task);
+        }
+        loadedCondition.notify_all();
+    }
+}
+
+bool AsyncLoader::upload(const std::shared_ptr<Task> &task) {
+    if (task->uploaded) {
+        return true;
+    }
+    if (!task->upload()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    task->uploaded = true;
+    numberOfPendingTasks--;
+    return true;
+}
+
+void AsyncLoader::processUploads(double budgetInMilliseconds) {
+    utils::Timer timer;
+    timer.start();
+
+    // Uploads still waiting on other loads go back in the queue afterwards,
+    // so they are not retried over and over within one call
+    std::vector<std::shared_ptr<Task>> retries;
+    while (true) {
+        std::shared_ptr<Task> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (uploads.empty()) {
+                break;
+            }
+            task = uploads.front();
+            uploads.pop_front();
+        }
+
+        if (!upload(task)) {
+            retries.push_back(task);
+        }
+
+        timer.stop();
+        if (budgetInMilliseconds >= 0.0 && timer.getElapsedTime() >= budgetInMilliseconds) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uploads.insert(uploads.end(), retries.begin(), retries.end());
+}
+
+void AsyncLoader::finish(const std::shared_ptr<Task> &task) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            loadedCondition.wait(lock, [&task]() { return task->loaded; });
+        }
+
+        // Also removes it from the upload queue, since uploaded tasks are skipped there
+        if (upload(task)) {
+            return;
+        }
+
+        processUploads(-1.0);
+        std::this_thread::yield();
+    }
+}
+
+size_t AsyncLoader::getNumberOfPendingTasks() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numberOfPendingTasks;
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Loads resources on background threads and uploads them on the calling thread.
+ *
+ * A load is split in two steps. The load step reads and decodes files on
+ * one of the loader threads. The upload step then runs on the thread
+ * calling processUploads, which is the one owning the OpenGL context, for
+ * as long as the frame has time left for it.
+ *
+ * \code
+ * std::shared_ptr<AsyncLoader::Task> task = loader.submit(
+ *     [texture, fileName]() { texture->decodeTexture(fileName); },
+ *     [texture]() { texture->uploadTexture(); return true; });
+ * // Once per frame
+ * loader.processUploads(2.0);
+ * \endcode
+ */
+class AsyncLoader {
+public:
+    struct Task;
+
+    /**
+     * @param numberOfThreads The number of loader threads, at least one is started.
+     */
+    AsyncLoader(unsigned int numberOfThreads);
+    ~AsyncLoader();
+
+    /**
+     * Queues a load. Neither step may throw.
+     *
+     * @param load Runs on a loader thread, where JobSystem::parallelFor runs serially
+     * @param upload Runs on the thread calling processUploads once load is
+     *               done. Returning false retries it on a later call, for
+     *               uploads waiting on other loads.
+     */
+    std::shared_ptr<Task> submit(std::function<void()> load, std::function<bool()> upload);
+
+    /**
+     * Runs the uploads of finished loads until the budget is spent.
+     * At least one upload is run if any is ready, however long it takes.
+     *
+     * @param budgetInMilliseconds A negative budget runs all ready uploads
+     */
+    void processUploads(double budgetInMilliseconds);
+
+    /**
+     * Waits for the task to load, then uploads it right away. Runs other
+     * ready uploads as well while this one is waiting on them.
+     */
+    void finish(const std::shared_ptr<Task> &task);
+
+    /**
+     * The number of tasks not yet uploaded.
+     */
+    size_t getNumberOfPendingTasks();
+
+    struct Task {
+        std::function<void()> load;
+        std::function<bool()> upload;
+        bool loaded = false;
+        bool uploaded = false;
+    };
+
+private:
+    void work();
+
+    /**
+     * Runs the upload of a loaded task, true if it is done.
+     */
+    bool upload(const std::shared_ptr<Task> &task);
+
+    std::mutex mutex;
+    std::condition_variable loadCondition;
+    std::condition_variable loadedCondition;
+    bool stopping = false;
+
+    std::deque<std::shared_ptr<Task>> loads;
+    std::deque<std::shared_ptr<Task>> uploads;
+    size_t numberOfPendingTasks = 0;
+
+    std::vector<std::thread> threads;
+};
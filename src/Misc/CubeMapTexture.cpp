@@ -19,12 +19,25 @@
 #include <Texture.h>
 #include <stb_image.h>
 #include <Logger.h>
+#include <VirtualFileSystem.h>
+#include <JobSystem.h>
+#include <cstring>
 
+#define CUBE_MAP_FACES 6
 
 CubeMapTexture::CubeMapTexture(const std::string &posXFilename, const std::string &negXFilename,
                                const std::string &posYFilename, const std::string &negYFilename,
                                const std::string &posZFilename, const std::string &negZFilename) {
 
+    //************************************************
+    //     Decode the faces before any OpenGL work
+    //************************************************
+    // In the order of the GL_TEXTURE_CUBE_MAP_* face enums
+    const std::string filenames[CUBE_MAP_FACES] = {posXFilename, negXFilename,
+                                                   posYFilename, negYFilename,
+                                                   posZFilename, negZFilename};
+    bool decoded = decodeFaces(filenames);
+
     //************************************************
     //    Creating a texture ID for the OpenGL texture
     //************************************************
@@ -36,19 +49,14 @@ CubeMapTexture::CubeMapTexture(const std::string &posXFilename, const std::strin
     //************************************************
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    loadCubeMapFace(posXFilename, GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-    loadCubeMapFace(negXFilename, GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-    loadCubeMapFace(posYFilename, GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-    loadCubeMapFace(negYFilename, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-    loadCubeMapFace(posZFilename, GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-    loadCubeMapFace(negZFilename, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
+    if (decoded) {
+        uploadFaces();
+    }
 
     //************************************************
     //            Set filtering parameters
     //************************************************
 
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
     // Sets the type of mipmap interpolation to be used on magnifying and 
     // minifying the active texture. 
     // For cube maps, filtering across faces causes artifacts - so disable filtering
@@ -76,25 +84,78 @@ CubeMapTexture::~CubeMapTexture()
 {
 }
 
-void CubeMapTexture::loadCubeMapFace(std::string filename, GLenum face)
+bool CubeMapTexture::decodeFaces(const std::string filenames[])
 {
-    // TODO(Bubbad) LET TEXTURE HANDLE ALL THIS
-    stbi_set_flip_vertically_on_load(true);
-
-    int width;
-    int height;
-    int comp;
-    unsigned char* image = stbi_load(filename.c_str(), &width, &height, &comp, 0);
+    Texture::setupImageDecoder();
+
+    // Only the headers are read up front, so a mismatched face is found
+    // before any of the six is decoded
+    VirtualFile files[CUBE_MAP_FACES];
+    int widths[CUBE_MAP_FACES];
+    int heights[CUBE_MAP_FACES];
+    int components[CUBE_MAP_FACES];
+    for (int i = 0; i < CUBE_MAP_FACES; i++) {
+        files[i] = VirtualFileSystem::openFile(filenames[i]);
+        if (!files[i].isOpen() ||
+            !stbi_info_from_memory(reinterpret_cast<const stbi_uc *>(files[i].getData()), (int)files[i].getSize(),
+                                   &widths[i], &heights[i], &components[i])) {
+            Logger::logError("Couldnt load image " + filenames[i]);
+            return false;
+        }
+        if (widths[i] != heights[i] || widths[i] != widths[0] || components[i] != components[0]) {
+            Logger::logError("Cube map face " + filenames[i] + " is " + std::to_string(widths[i]) + "x" +
+                             std::to_string(heights[i]) + " with " + std::to_string(components[i]) +
+                             " components, expected a square face like " + filenames[0] + " (" +
+                             std::to_string(widths[0]) + "x" + std::to_string(widths[0]) + ", " +
+                             std::to_string(components[0]) + " components)");
+            return false;
+        }
+    }
 
-    if (image == nullptr) {
-        Logger::logError("Couldnt load image "+ filename);
+    // Grey and grey-alpha images are expanded, everything is uploaded as RGB or RGBA
+    m_faceSize = widths[0];
+    m_components = components[0] == 3 ? 3 : 4;
+    size_t faceBytes = (size_t)m_faceSize * m_faceSize * m_components;
+    m_faceData.resize(faceBytes * CUBE_MAP_FACES);
+
+    bool faceDecoded[CUBE_MAP_FACES] = {};
+    JobSystem::parallelFor(CUBE_MAP_FACES, [&](size_t i) {
+        int width;
+        int height;
+        int comp;
+        stbi_uc *image = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(files[i].getData()),
+                                               (int)files[i].getSize(), &width, &height, &comp, m_components);
+        if (image != nullptr && width == m_faceSize && height == m_faceSize) {
+            memcpy(&m_faceData[i * faceBytes], image, faceBytes);
+            faceDecoded[i] = true;
+        }
+        stbi_image_free(image);
+    });
+
+    for (int i = 0; i < CUBE_MAP_FACES; i++) {
+        if (!faceDecoded[i]) {
+            Logger::logError("Couldnt load image " + filenames[i]);
+            std::vector<unsigned char>().swap(m_faceData);
+            return false;
+        }
     }
+    return true;
+}
 
-    GLenum format = comp == 3 ? GL_RGB : GL_RGBA;
+void CubeMapTexture::uploadFaces()
+{
+    GLenum format = m_components == 3 ? GL_RGB : GL_RGBA;
+    size_t faceBytes = (size_t)m_faceSize * m_faceSize * m_components;
 
-    glTexImage2D(face, 0, GL_SRGB_ALPHA_EXT, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < CUBE_MAP_FACES; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB_ALPHA_EXT, m_faceSize, m_faceSize, 0,
+                     format, GL_UNSIGNED_BYTE, &m_faceData[i * faceBytes]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    stbi_image_free(image);
+    std::vector<unsigned char>().swap(m_faceData);
 }
 
 void CubeMapTexture::bind(GLenum textureUnit) {
@@ -0,0 +1,54 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * The layout of the asset packs mounted by VirtualFileSystem. A pack starts
+ * with a PackFileHeader, followed by the table of contents, the null
+ * terminated names of the files and finally their contents. All offsets are
+ * in bytes from the start of the pack and aligned to PACK_FILE_ALIGNMENT.
+ *
+ * The table of contents is an open addressing hash table of tableSize
+ * entries, a power of two. A file is found by probing linearly from the
+ * entry at the hash of its AssetId, until the entry is found or an empty
+ * entry is reached.
+ */
+
+#define PACK_FILE_EXTENSION ".pack"
+// "BPAK" in a little endian file
+#define PACK_FILE_MAGIC 0x4b415042
+#define PACK_FILE_VERSION 1
+#define PACK_FILE_ALIGNMENT 16
+
+struct PackFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numFiles;
+    uint32_t tableSize;
+    uint64_t tableOffset;
+};
+
+struct PackFileEntry {
+    // The hash of the AssetId of the normalized file name
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    // Zero for an empty entry
+    uint64_t nameOffset;
+};
@@ -0,0 +1,261 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "PreloadManifest.h"
+#include <sstream>
+#include <JobSystem.h>
+#include <Logger.h>
+#include <ResourceManager.h>
+#include <ShaderProgram.h>
+#include <shader/VertexShader.h>
+#include <shader/FragmentShader.h>
+#include "Texture.h"
+#include "Mesh.h"
+#include "timer.h"
+
+// Reading one byte per page is enough to bring a mapped file into memory
+#define PRELOAD_PAGE_SIZE 4096
+
+namespace {
+
+std::string readShaderSource(const std::string &fileName) {
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (!file.isOpen()) {
+        Logger::logError("Could not read the shader " + fileName);
+    }
+    return file.getText();
+}
+
+}
+
+void PreloadManifest::addShaderProgram(const std::string &name, const std::string &vertexShader,
+                                       const std::string &fragmentShader) {
+    add(AssetType::SHADER_PROGRAM, name);
+    for (Asset &asset : assets) {
+        if (asset.type == AssetType::SHADER_PROGRAM && asset.name == name) {
+            asset.vertexShader = vertexShader;
+            asset.fragmentShader = fragmentShader;
+        }
+    }
+}
+
+void PreloadManifest::addTexture(const std::string &fileName, TextureRole role) {
+    add(AssetType::TEXTURE, fileName);
+    for (Asset &asset : assets) {
+        if (asset.type == AssetType::TEXTURE && asset.name == fileName) {
+            asset.textureRole = role;
+        }
+    }
+}
+
+void PreloadManifest::addMesh(const std::string &fileName) {
+    add(AssetType::MESH, fileName);
+}
+
+void PreloadManifest::addFile(const std::string &fileName) {
+    add(AssetType::FILE, fileName);
+}
+
+void PreloadManifest::add(AssetType type, const std::string &name) {
+    for (const Asset &asset : assets) {
+        if (asset.type == type && asset.name == name) {
+            return;
+        }
+    }
+    Asset asset;
+    asset.type = type;
+    asset.name = name;
+    assets.push_back(asset);
+}
+
+bool PreloadManifest::addFromFile(const std::string &manifestFileName) {
+    VirtualFile file = VirtualFileSystem::openFile(manifestFileName);
+    if (!file.isOpen()) {
+        Logger::logError("Could not read the preload manifest " + manifestFileName);
+        return false;
+    }
+
+    std::istringstream lines(file.getText());
+    std::string line;
+    for (int lineNumber = 1; std::getline(lines, line); lineNumber++) {
+        std::istringstream words(line);
+        std::string type, name, vertexShader, fragmentShader;
+        if (!(words >> type) || type[0] == '#') {
+            continue;
+        }
+
+        if (type == "shader" && words >> name >> vertexShader >> fragmentShader) {
+            addShaderProgram(name, vertexShader, fragmentShader);
+        } else if (type == "texture" && words >> name) {
+            addTexture(name);
+        } else if (type == "normalmap" && words >> name) {
+            addTexture(name, TextureRole::NORMAL_MAP);
+        } else if (type == "mesh" && words >> name) {
+            addMesh(name);
+        } else if (type == "file" && words >> name) {
+            addFile(name);
+        } else {
+            Logger::logWarning(manifestFileName + ":" + std::to_string(lineNumber) + " is not an asset: " + line);
+        }
+    }
+    return true;
+}
+
+void PreloadManifest::decode() {
+    utils::Timer timer;
+    timer.start();
+
+    decodeAssets();
+
+    // The textures of the meshes are only known once they are imported
+    size_t numberOfAssets = assets.size();
+    for (size_t i = 0; i < numberOfAssets; i++) {
+        if (assets[i].type == AssetType::MESH && assets[i].mesh != nullptr) {
+            for (TextureRole role : {TextureRole::COLOR, TextureRole::NORMAL_MAP}) {
+                for (const std::string &fileName : assets[i].mesh->getTextureFileNames(role)) {
+                    addTexture(fileName, role);
+                }
+            }
+        }
+    }
+    decodeAssets();
+
+    timer.stop();
+    decodeMilliseconds = timer.getElapsedTime();
+}
+
+void PreloadManifest::upload() {
+    utils::Timer timer;
+    timer.start();
+
+    // Meshes fetch their textures from the ResourceManager when they are uploaded
+    for (Asset &asset : assets) {
+        if (asset.decoded && !asset.uploaded && asset.type != AssetType::MESH) {
+            uploadAsset(asset);
+        }
+    }
+    for (Asset &asset : assets) {
+        if (asset.decoded && !asset.uploaded && asset.type == AssetType::MESH) {
+            uploadAsset(asset);
+        }
+    }
+
+    timer.stop();
+    uploadMilliseconds = timer.getElapsedTime();
+}
+
+void PreloadManifest::load() {
+    decode();
+    upload();
+}
+
+void PreloadManifest::decodeAssets() {
+    JobSystem::parallelFor(assets.size(), [this](size_t i) {
+        if (!assets[i].decoded) {
+            decodeAsset(assets[i]);
+        }
+    });
+}
+
+void PreloadManifest::decodeAsset(Asset &asset) {
+    utils::Timer timer;
+    timer.start();
+
+    switch (asset.type) {
+        case AssetType::SHADER_PROGRAM:
+            asset.vertexSource = readShaderSource(asset.vertexShader);
+            asset.fragmentSource = readShaderSource(asset.fragmentShader);
+            break;
+        case AssetType::TEXTURE:
+            asset.texture = std::make_shared<Texture>();
+            asset.texture->decodeTexture(asset.name, ResourceManager::getTextureDecodeSize(), asset.textureRole);
+            break;
+        case AssetType::MESH:
+            asset.mesh = std::make_shared<Mesh>();
+            asset.mesh->importMesh(asset.name);
+            break;
+        case AssetType::FILE: {
+            asset.file = VirtualFileSystem::openFile(asset.name);
+            if (!asset.file.isOpen()) {
+                Logger::logError("Could not read " + asset.name);
+            }
+            volatile char touched = 0;
+            for (size_t offset = 0; offset < asset.file.getSize(); offset += PRELOAD_PAGE_SIZE) {
+                touched += asset.file.getData()[offset];
+            }
+            break;
+        }
+    }
+
+    timer.stop();
+    asset.decodeMilliseconds = timer.getElapsedTime();
+    asset.decoded = true;
+}
+
+void PreloadManifest::uploadAsset(Asset &asset) {
+    utils::Timer timer;
+    timer.start();
+
+    switch (asset.type) {
+        case AssetType::SHADER_PROGRAM: {
+            std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
+            shaderProgram->loadShader(VertexShader::fromSource(asset.vertexSource),
+                                      FragmentShader::fromSource(asset.fragmentSource));
+            ResourceManager::addShaderProgram(asset.name, shaderProgram);
+            asset.vertexSource.clear();
+            asset.fragmentSource.clear();
+            break;
+        }
+        case AssetType::TEXTURE:
+            asset.texture->uploadTexture();
+            ResourceManager::addTexture(asset.name, asset.texture);
+            asset.texture.reset();
+            break;
+        case AssetType::MESH:
+            asset.mesh->uploadMesh();
+            ResourceManager::addMesh(asset.name, asset.mesh);
+            asset.mesh.reset();
+            break;
+        case AssetType::FILE:
+            // The contents stay in the file system cache for the loader opening it
+            asset.file = VirtualFile();
+            break;
+    }
+
+    timer.stop();
+    asset.uploadMilliseconds = timer.getElapsedTime();
+    asset.uploaded = true;
+}
+
+size_t PreloadManifest::getNumberOfAssets() const {
+    return assets.size();
+}
+
+std::vector<PreloadManifest::AssetTiming> PreloadManifest::getTimings() const {
+    std::vector<AssetTiming> timings;
+    for (const Asset &asset : assets) {
+        timings.push_back({ asset.type, asset.name, asset.decodeMilliseconds, asset.uploadMilliseconds });
+    }
+    return timings;
+}
+
+double PreloadManifest::getDecodeMilliseconds() const {
+    return decodeMilliseconds;
+}
+
+double PreloadManifest::getUploadMilliseconds() const {
+    return uploadMilliseconds;
+}
@@ -16,6 +16,8 @@
  */
 #include "ResourceManager.h"
 #include <sstream>
+#include <algorithm>
+#include <unordered_map>
 #include <Logger.h>
 #include <ShaderProgram.h>
 #include <shader/VertexShader.h>
@@ -23,89 +25,474 @@
 #include "objects/Chunk.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include "glutil/glutil.h"
+#include "AsyncLoader.h"
 
-std::map<std::string, std::shared_ptr<ShaderProgram>> ResourceManager::shaders;
-std::map<std::string, std::shared_ptr<Texture>> ResourceManager::textures;
-std::map<std::string, std::shared_ptr<Mesh>> ResourceManager::meshes;
+ResourceCache<ShaderProgram> ResourceManager::shaders;
+ResourceCache<Texture> ResourceManager::textures;
+ResourceCache<Mesh> ResourceManager::meshes;
+size_t ResourceManager::memoryBudget = 0;
+TextureResidency ResourceManager::textureResidency;
+bool ResourceManager::textureStreaming = false;
+bool ResourceManager::assetCacheEnabled = false;
+std::atomic<uint64_t> ResourceManager::useClock(0);
+
+namespace {
+
+/**
+ * A resource loading in the background, until it has been uploaded.
+ */
+template<typename Type>
+struct PendingLoad {
+    std::shared_ptr<AsyncLoader::Task> task;
+    std::shared_future<std::shared_ptr<Type>> future;
+};
+
+// Keyed by the hash of the AssetId
+std::unordered_map<uint64_t, PendingLoad<ShaderProgram>> pendingShaders;
+std::unordered_map<uint64_t, PendingLoad<Texture>> pendingTextures;
+std::unordered_map<uint64_t, PendingLoad<Mesh>> pendingMeshes;
+
+// The textures streaming levels in the background, keyed by the hash of the AssetId
+std::unordered_map<uint64_t, std::shared_ptr<AsyncLoader::Task>> streamingTextures;
+
+AsyncLoader& getLoader() {
+    // Started the first time anything is loaded asynchronously
+    static AsyncLoader loader(RESOURCE_LOADER_THREADS);
+    return loader;
+}
+
+template<typename Type>
+std::shared_future<std::shared_ptr<Type>> makeReadyFuture(const std::shared_ptr<Type> &item) {
+    std::promise<std::shared_ptr<Type>> promise;
+    promise.set_value(item);
+    return promise.get_future().share();
+}
+
+/**
+ * Waits for and uploads the resource if it is loading in the background.
+ */
+template<typename Type>
+void finishPendingLoad(std::unordered_map<uint64_t, PendingLoad<Type>> &pending, AssetId id) {
+    typename std::unordered_map<uint64_t, PendingLoad<Type>>::iterator it = pending.find(id.getHash());
+    if (it != pending.end()) {
+        // The upload removes the entry, keep the task alive until then
+        std::shared_ptr<AsyncLoader::Task> task = it->second.task;
+        getLoader().finish(task);
+    }
+}
+
+std::string readShaderSource(const std::string &fileName) {
+    const char *text = textFileRead(fileName.c_str(), true);
+    if (text == nullptr) {
+        return "";
+    }
+    std::string source(text);
+    delete[] text;
+    return source;
+}
+
+}
 
 std::shared_ptr<ShaderProgram> ResourceManager::loadAndFetchShaderProgram(
     const std::string &shaderName,
     const std::string &vertexShader,
     const std::string &fragmentShader)
 {
-    try {
-        return getShader(shaderName);
-    } catch (std::invalid_argument exception) {
-        loadShader(vertexShader, fragmentShader, shaderName);
-        return getShader(shaderName);
+    AssetId id(shaderName);
+    finishPendingLoad(pendingShaders, id);
+    std::shared_ptr<ShaderProgram> shaderProgram = fetchShaderProgram(id);
+    if (shaderProgram == nullptr) {
+        shaderProgram = loadShader(vertexShader, fragmentShader, shaderName);
     }
+    return shaderProgram;
 }
 
-std::shared_ptr<Texture> ResourceManager::loadAndFetchTexture(const std::string &fileName) {
-    try {
-        return getTexture(fileName);
-    } catch (std::invalid_argument exception) {
-        loadTexture(fileName);
-        return getTexture(fileName);
+std::shared_ptr<Texture> ResourceManager::loadAndFetchTexture(const std::string &fileName, TextureRole role) {
+    AssetId id(fileName);
+    finishPendingLoad(pendingTextures, id);
+    std::shared_ptr<Texture> texture = fetchTexture(id);
+    if (texture == nullptr) {
+        texture = loadTexture(fileName, role);
+        enforceMemoryBudget();
     }
+    return texture;
 }
 
 std::shared_ptr<Mesh> ResourceManager::loadAndFetchMesh(const std::string &fileName) {
-    try {
-        return getMesh(fileName);
-    } catch (std::invalid_argument exception) {
-        loadMesh(fileName);
-        return getMesh(fileName);
+    AssetId id(fileName);
+    finishPendingLoad(pendingMeshes, id);
+    std::shared_ptr<Mesh> mesh = fetchMesh(id);
+    if (mesh == nullptr) {
+        mesh = loadMesh(fileName);
+        enforceMemoryBudget();
+    }
+    return mesh;
+}
+
+std::shared_ptr<ShaderProgram> ResourceManager::fetchShaderProgram(AssetId id) {
+    return shaders.fetch(id, ++useClock);
+}
+
+std::shared_ptr<Texture> ResourceManager::fetchTexture(AssetId id) {
+    return textures.fetch(id, ++useClock);
+}
+
+std::shared_ptr<Mesh> ResourceManager::fetchMesh(AssetId id) {
+    return meshes.fetch(id, ++useClock);
+}
+
+std::shared_ptr<ShaderProgram> ResourceManager::addShaderProgram(const std::string &name,
+                                                                std::shared_ptr<ShaderProgram> shaderProgram) {
+    std::shared_ptr<ShaderProgram> loaded = fetchShaderProgram(name);
+    if (loaded != nullptr) {
+        return loaded;
+    }
+    shaders.insert(name, shaderProgram, 0, ++useClock);
+    return shaderProgram;
+}
+
+std::shared_ptr<Texture> ResourceManager::addTexture(const std::string &fileName, std::shared_ptr<Texture> texture) {
+    std::shared_ptr<Texture> loaded = fetchTexture(fileName);
+    if (loaded != nullptr) {
+        return loaded;
+    }
+    insertTexture(fileName, texture);
+    enforceMemoryBudget();
+    return texture;
+}
+
+std::shared_ptr<Mesh> ResourceManager::addMesh(const std::string &fileName, std::shared_ptr<Mesh> mesh) {
+    std::shared_ptr<Mesh> loaded = fetchMesh(fileName);
+    if (loaded != nullptr) {
+        return loaded;
     }
+    meshes.insert(fileName, mesh, mesh->getMemorySize(), ++useClock);
+    enforceMemoryBudget();
+    return mesh;
 }
 
-void ResourceManager::loadShader(const std::string &vertexShader,
-                                 const std::string &fragmentShader,
-                                 const std::string &name)
+std::shared_future<std::shared_ptr<ShaderProgram>> ResourceManager::loadAndFetchShaderProgramAsync(
+    const std::string &shaderName,
+    const std::string &vertexShader,
+    const std::string &fragmentShader)
+{
+    AssetId id(shaderName);
+    std::unordered_map<uint64_t, PendingLoad<ShaderProgram>>::iterator pending = pendingShaders.find(id.getHash());
+    if (pending != pendingShaders.end()) {
+        return pending->second.future;
+    }
+    std::shared_ptr<ShaderProgram> loaded = fetchShaderProgram(id);
+    if (loaded != nullptr) {
+        return makeReadyFuture(loaded);
+    }
+
+    std::shared_ptr<std::string> vertexSource = std::make_shared<std::string>();
+    std::shared_ptr<std::string> fragmentSource = std::make_shared<std::string>();
+    std::shared_ptr<std::promise<std::shared_ptr<ShaderProgram>>> promise =
+            std::make_shared<std::promise<std::shared_ptr<ShaderProgram>>>();
+
+    PendingLoad<ShaderProgram> load;
+    load.future = promise->get_future().share();
+    load.task = getLoader().submit(
+        [vertexSource, fragmentSource, vertexShader, fragmentShader]() {
+            *vertexSource = readShaderSource(vertexShader);
+            *fragmentSource = readShaderSource(fragmentShader);
+        },
+        [vertexSource, fragmentSource, shaderName, id, promise]() {
+            std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
+            shaderProgram->loadShader(VertexShader::fromSource(*vertexSource),
+                                      FragmentShader::fromSource(*fragmentSource));
+            shaders.insert(shaderName, shaderProgram, 0, ++useClock);
+            pendingShaders.erase(id.getHash());
+            promise->set_value(shaderProgram);
+            return true;
+        });
+
+    pendingShaders.insert(std::pair<uint64_t, PendingLoad<ShaderProgram>>(id.getHash(), load));
+    return load.future;
+}
+
+std::shared_future<std::shared_ptr<Texture>> ResourceManager::loadAndFetchTextureAsync(const std::string &fileName,
+                                                                                        TextureRole role) {
+    AssetId id(fileName);
+    std::unordered_map<uint64_t, PendingLoad<Texture>>::iterator pending = pendingTextures.find(id.getHash());
+    if (pending != pendingTextures.end()) {
+        return pending->second.future;
+    }
+    std::shared_ptr<Texture> loaded = fetchTexture(id);
+    if (loaded != nullptr) {
+        return makeReadyFuture(loaded);
+    }
+
+    std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+    int decodeSize = getTextureDecodeSize();
+    std::shared_ptr<std::promise<std::shared_ptr<Texture>>> promise =
+            std::make_shared<std::promise<std::shared_ptr<Texture>>>();
+
+    PendingLoad<Texture> load;
+    load.future = promise->get_future().share();
+    load.task = getLoader().submit(
+        [texture, fileName, decodeSize, role]() {
+            texture->decodeTexture(fileName, decodeSize, role);
+        },
+        [texture, fileName, id, promise]() {
+            texture->uploadTexture();
+            insertTexture(fileName, texture);
+            pendingTextures.erase(id.getHash());
+            promise->set_value(texture);
+            enforceMemoryBudget();
+            return true;
+        });
+
+    pendingTextures.insert(std::pair<uint64_t, PendingLoad<Texture>>(id.getHash(), load));
+    return load.future;
+}
+
+std::shared_future<std::shared_ptr<Mesh>> ResourceManager::loadAndFetchMeshAsync(const std::string &fileName) {
+    AssetId id(fileName);
+    std::unordered_map<uint64_t, PendingLoad<Mesh>>::iterator pending = pendingMeshes.find(id.getHash());
+    if (pending != pendingMeshes.end()) {
+        return pending->second.future;
+    }
+    std::shared_ptr<Mesh> loaded = fetchMesh(id);
+    if (loaded != nullptr) {
+        return makeReadyFuture(loaded);
+    }
+
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+    std::shared_ptr<std::promise<std::shared_ptr<Mesh>>> promise =
+            std::make_shared<std::promise<std::shared_ptr<Mesh>>>();
+
+    // The textures are only known once the mesh is imported
+    bool texturesRequested = false;
+    std::vector<std::shared_future<std::shared_ptr<Texture>>> textureLoads;
+
+    PendingLoad<Mesh> load;
+    load.future = promise->get_future().share();
+    load.task = getLoader().submit(
+        [mesh, fileName]() {
+            mesh->importMesh(fileName);
+        },
+        [mesh, fileName, id, promise, texturesRequested, textureLoads]() mutable {
+            if (!texturesRequested) {
+                for (TextureRole role : {TextureRole::COLOR, TextureRole::NORMAL_MAP}) {
+                    for (const std::string &textureFileName : mesh->getTextureFileNames(role)) {
+                        textureLoads.push_back(loadAndFetchTextureAsync(textureFileName, role));
+                    }
+                }
+                texturesRequested = true;
+            }
+            for (std::shared_future<std::shared_ptr<Texture>> &textureLoad : textureLoads) {
+                if (textureLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    return false;
+                }
+            }
+
+            mesh->uploadMesh();
+            meshes.insert(fileName, mesh, mesh->getMemorySize(), ++useClock);
+            pendingMeshes.erase(id.getHash());
+            promise->set_value(mesh);
+            enforceMemoryBudget();
+            return true;
+        });
+
+    pendingMeshes.insert(std::pair<uint64_t, PendingLoad<Mesh>>(id.getHash(), load));
+    return load.future;
+}
+
+void ResourceManager::processUploads(double budgetInMilliseconds) {
+    if (getNumberOfPendingLoads() > 0 || !streamingTextures.empty()) {
+        getLoader().processUploads(budgetInMilliseconds);
+    }
+    enforceMemoryBudget();
+}
+
+size_t ResourceManager::getNumberOfPendingLoads() {
+    return pendingShaders.size() + pendingTextures.size() + pendingMeshes.size();
+}
+
+std::shared_ptr<ShaderProgram> ResourceManager::loadShader(const std::string &vertexShader,
+                                                           const std::string &fragmentShader,
+                                                           const std::string &name)
 {
     std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
     shaderProgram->loadShader(new VertexShader(vertexShader), new FragmentShader(fragmentShader));
-    shaders.insert(std::pair<std::string, std::shared_ptr<ShaderProgram>>
-                            (name, std::move(shaderProgram)));
+    shaders.insert(name, shaderProgram, 0, ++useClock);
+    return shaderProgram;
 }
 
-void ResourceManager::loadTexture(const std::string &fileName) {
+std::shared_ptr<Texture> ResourceManager::loadTexture(const std::string &fileName, TextureRole role) {
     std::shared_ptr<Texture> texture = std::make_shared<Texture>();
-    texture->loadTexture(fileName);
-    textures.insert(std::pair<std::string, std::shared_ptr<Texture>>(fileName, std::move(texture)));
+    texture->decodeTexture(fileName, getTextureDecodeSize(), role);
+    texture->uploadTexture();
+    insertTexture(fileName, texture);
+    return texture;
 }
 
-void ResourceManager::loadMesh(const std::string &fileName) {
+void ResourceManager::insertTexture(const std::string &fileName, const std::shared_ptr<Texture> &texture) {
+    textures.insert(fileName, texture, texture->getMemorySize(), ++useClock);
+    if (textureStreaming) {
+        textureResidency.add(fileName, texture->getWidth(), texture->getHeight(), texture->getResidentLevel(),
+                             texture->getBitsPerTexel());
+    }
+}
+
+std::shared_ptr<Mesh> ResourceManager::loadMesh(const std::string &fileName) {
     std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
     mesh->loadMesh(fileName);
-    meshes.insert(std::pair<std::string, std::shared_ptr<Mesh>>(fileName, std::move(mesh)));
+    meshes.insert(fileName, mesh, mesh->getMemorySize(), ++useClock);
+    return mesh;
 }
 
-std::shared_ptr<ShaderProgram> ResourceManager::getShader(const std::string &name) {
-    return getItemFromMap(shaders, name);
+void ResourceManager::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+    enforceMemoryBudget();
 }
 
-std::shared_ptr<Texture> ResourceManager::getTexture(const std::string &fileName) {
-    return getItemFromMap(textures, fileName);
+size_t ResourceManager::getMemoryBudget() {
+    return memoryBudget;
 }
 
+size_t ResourceManager::getTextureMemoryUsage() {
+    return textures.getMemoryUsage();
+}
 
-std::shared_ptr<Mesh> ResourceManager::getMesh(const std::string &fileName) {
-    return getItemFromMap(meshes, fileName);
+size_t ResourceManager::getMeshMemoryUsage() {
+    return meshes.getMemoryUsage();
 }
 
-template<typename Type>
-std::shared_ptr<Type> ResourceManager::getItemFromMap(
-    std::map<std::string, std::shared_ptr<Type>> &map,
-    const std::string &id)
-{
-    typename std::map<std::string, std::shared_ptr<Type>>::iterator it = map.find(id);
-    if( it != map.end()) {
-        return it->second;
-    } else {
-        std::stringstream errorMessage;
-        errorMessage << id << " hasn't been loaded into ResourceManager before fetched";
-        throw std::invalid_argument(errorMessage.str());
+size_t ResourceManager::getMemoryUsage() {
+    return getTextureMemoryUsage() + getMeshMemoryUsage();
+}
+
+void ResourceManager::enforceMemoryBudget() {
+    if (memoryBudget == 0) {
+        return;
     }
+
+    // Evicting a mesh releases its textures, so look for candidates again after every eviction
+    while (getMemoryUsage() > memoryBudget) {
+        std::string textureName, meshName;
+        uint64_t textureLastUsed = 0, meshLastUsed = 0;
+        bool hasTexture = textures.findLeastRecentlyUsedUnreferenced(textureName, textureLastUsed);
+        bool hasMesh = meshes.findLeastRecentlyUsedUnreferenced(meshName, meshLastUsed);
+
+        if (!hasTexture && !hasMesh) {
+            return;
+        }
+
+        if (hasMesh && (!hasTexture || meshLastUsed <= textureLastUsed)) {
+            Logger::logDebug("Evicting mesh " + meshName);
+            meshes.erase(meshName);
+        } else {
+            Logger::logDebug("Evicting texture " + textureName);
+            textures.erase(textureName);
+            textureResidency.remove(textureName);
+        }
+    }
+}
+
+void ResourceManager::setAssetCacheEnabled(bool enabled) {
+    assetCacheEnabled = enabled;
 }
 
+bool ResourceManager::isAssetCacheEnabled() {
+    return assetCacheEnabled;
+}
+
+void ResourceManager::setTextureStreaming(bool enabled) {
+    textureStreaming = enabled;
+}
+
+bool ResourceManager::isTextureStreaming() {
+    return textureStreaming;
+}
+
+int ResourceManager::getTextureDecodeSize() {
+    return textureStreaming ? TEXTURE_STREAMING_TAIL_SIZE : 0;
+}
+
+void ResourceManager::clear() {
+    pendingShaders.clear();
+    pendingTextures.clear();
+    pendingMeshes.clear();
+    streamingTextures.clear();
+    textureResidency.clear();
+
+    shaders.clear();
+    textures.clear();
+    meshes.clear();
+}
+
+void ResourceManager::setTextureStreamingBudget(size_t bytes) {
+    textureResidency.setMemoryBudget(bytes);
+}
+
+size_t ResourceManager::getTextureStreamingBudget() {
+    return textureResidency.getMemoryBudget();
+}
+
+void ResourceManager::requestTextureSize(Texture *texture, float screenSizeInPixels) {
+    if (texture != nullptr && textureResidency.size() > 0) {
+        textureResidency.requestScreenSize(texture->getFileName(), screenSizeInPixels);
+    }
+}
+
+void ResourceManager::updateTextureStreaming() {
+    if (textureResidency.size() == 0) {
+        return;
+    }
+    textureResidency.update();
+
+    for (const TextureResidency::Change &change : textureResidency.getChanges()) {
+        if (streamingTextures.size() >= TEXTURE_STREAMING_LOADS) {
+            break;
+        }
+        AssetId id(change.name);
+        if (streamingTextures.find(id.getHash()) != streamingTextures.end()) {
+            continue;
+        }
+
+        std::shared_ptr<Texture> resident = textures.fetch(id, useClock);
+        if (resident == nullptr) {
+            continue;
+        }
+        TextureRole role = resident->getRole();
+
+        // Decoded into a texture of its own, so the resident one can be drawn meanwhile
+        std::shared_ptr<Texture> streamed = std::make_shared<Texture>();
+        std::shared_ptr<bool> decoded = std::make_shared<bool>(false);
+        std::string fileName = change.name;
+        int decodeSize = std::max(1, std::max(change.width, change.height) >> change.targetLevel);
+
+        streamingTextures[id.getHash()] = getLoader().submit(
+            [streamed, decoded, fileName, decodeSize, role]() {
+                *decoded = streamed->decodeTexture(fileName, decodeSize, role);
+            },
+            [streamed, decoded, fileName, id]() {
+                streamingTextures.erase(id.getHash());
+                std::shared_ptr<Texture> texture = fetchTexture(id);
+                if (texture == nullptr || !textureResidency.contains(id)) {
+                    // Evicted while streaming
+                    return true;
+                }
+                if (!*decoded) {
+                    // Stop streaming it rather than failing again every frame
+                    textureResidency.remove(id);
+                    return true;
+                }
+
+                // The old levels end up in the local texture and are deleted along with it
+                Texture levels;
+                levels.swap(*streamed);
+                levels.uploadTexture();
+                texture->swap(levels);
+
+                textureResidency.setResidentLevel(id, texture->getResidentLevel());
+                textures.setMemorySize(id, texture->getMemorySize());
+                Logger::logDebug("Streamed " + fileName + " from level " + std::to_string(texture->getResidentLevel()));
+                return true;
+            });
+    }
+}
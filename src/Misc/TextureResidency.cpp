@@ -0,0 +1,256 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "TextureResidency.h"
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace {
+
+int getLevelSize(int width, int height, int level) {
+    return std::max(1, std::max(width, height) >> level);
+}
+
+/**
+ * How many texels of its top resident level the texture has per pixel it
+ * covers on screen. The higher, the less dropping that level is noticed.
+ */
+float getTexelsPerPixel(int width, int height, int level, float requestedSize) {
+    if (requestedSize <= 0.0f) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return getLevelSize(width, height, level) / requestedSize;
+}
+
+}
+
+void TextureResidency::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+}
+
+size_t TextureResidency::getMemoryBudget() const {
+    return memoryBudget;
+}
+
+void TextureResidency::setHoldFrames(int frames) {
+    holdFrames = std::max(0, frames);
+}
+
+int TextureResidency::getHoldFrames() const {
+    return holdFrames;
+}
+
+void TextureResidency::add(const std::string &name, int width, int height, int residentLevel, int bitsPerTexel) {
+    Entry entry;
+    entry.name = name;
+    entry.width = width;
+    entry.height = height;
+    entry.bitsPerTexel = bitsPerTexel;
+    entry.residentLevel = std::min(residentLevel, getNumberOfLevels(width, height) - 1);
+    entry.targetLevel = entry.residentLevel;
+    entry.requestedSize = 0.0f;
+    entry.heldSize = 0.0f;
+    entry.framesSinceHeldRequest = 0;
+    entry.requested = false;
+    entries[AssetId(name).getHash()] = entry;
+}
+
+void TextureResidency::remove(AssetId id) {
+    entries.erase(id.getHash());
+}
+
+void TextureResidency::clear() {
+    entries.clear();
+}
+
+bool TextureResidency::contains(AssetId id) const {
+    return entries.find(id.getHash()) != entries.end();
+}
+
+size_t TextureResidency::size() const {
+    return entries.size();
+}
+
+void TextureResidency::requestScreenSize(AssetId id, float screenSizeInPixels) {
+    std::unordered_map<uint64_t, Entry>::iterator it = entries.find(id.getHash());
+    if (it != entries.end()) {
+        it->second.requestedSize = std::max(it->second.requestedSize, screenSizeInPixels);
+        it->second.requested = true;
+    }
+}
+
+void TextureResidency::update() {
+    size_t usage = 0;
+    for (std::pair<const uint64_t, Entry> &item : entries) {
+        Entry &entry = item.second;
+        if (!entry.requested) {
+            entry.targetLevel = entry.residentLevel;
+            usage += getMemorySize(entry.width, entry.height, entry.targetLevel, entry.bitsPerTexel);
+            continue;
+        }
+
+        if (entry.requestedSize >= entry.heldSize) {
+            entry.heldSize = entry.requestedSize;
+            entry.framesSinceHeldRequest = 0;
+        } else if (++entry.framesSinceHeldRequest > holdFrames) {
+            entry.heldSize = entry.requestedSize;
+            entry.framesSinceHeldRequest = 0;
+        }
+
+        int tailLevel = getTailLevel(entry.width, entry.height);
+        if (entry.heldSize > 0.0f) {
+            entry.targetLevel = std::min(selectLevel(entry.width, entry.height, entry.heldSize), tailLevel);
+        } else {
+            entry.targetLevel = tailLevel;
+        }
+        usage += getMemorySize(entry.width, entry.height, entry.targetLevel, entry.bitsPerTexel);
+    }
+
+    if (memoryBudget != 0 && usage > memoryBudget) {
+        // Drop the top level of the most oversampled texture until the rest fits,
+        // ties are broken by hash so the outcome does not depend on the map order
+        std::priority_queue<std::pair<float, uint64_t>> candidates;
+        for (std::pair<const uint64_t, Entry> &item : entries) {
+            Entry &entry = item.second;
+            if (entry.requested && entry.targetLevel < getTailLevel(entry.width, entry.height)) {
+                candidates.push(std::make_pair(getTexelsPerPixel(entry.width, entry.height, entry.targetLevel,
+                                                                 entry.heldSize), item.first));
+            }
+        }
+
+        while (usage > memoryBudget && !candidates.empty()) {
+            uint64_t hash = candidates.top().second;
+            Entry &entry = entries[hash];
+            candidates.pop();
+
+            usage -= getMemorySize(entry.width, entry.height, entry.targetLevel, entry.bitsPerTexel);
+            entry.targetLevel++;
+            usage += getMemorySize(entry.width, entry.height, entry.targetLevel, entry.bitsPerTexel);
+
+            if (entry.targetLevel < getTailLevel(entry.width, entry.height)) {
+                candidates.push(std::make_pair(getTexelsPerPixel(entry.width, entry.height, entry.targetLevel,
+                                                                 entry.heldSize), hash));
+            }
+        }
+    }
+
+    for (std::pair<const uint64_t, Entry> &item : entries) {
+        item.second.requestedSize = 0.0f;
+    }
+}
+
+std::vector<TextureResidency::Change> TextureResidency::getChanges() const {
+    std::vector<std::pair<float, const Entry*>> drops;
+    std::vector<std::pair<float, const Entry*>> loads;
+    for (const std::pair<const uint64_t, Entry> &item : entries) {
+        const Entry &entry = item.second;
+        if (entry.targetLevel > entry.residentLevel) {
+            drops.push_back(std::make_pair(0.0f, &entry));
+        } else if (entry.targetLevel < entry.residentLevel) {
+            loads.push_back(std::make_pair(getTexelsPerPixel(entry.width, entry.height, entry.residentLevel,
+                                                             entry.heldSize), &entry));
+        }
+    }
+    std::sort(loads.begin(), loads.end(),
+              [](const std::pair<float, const Entry*> &a, const std::pair<float, const Entry*> &b) {
+                  return a.first < b.first;
+              });
+
+    std::vector<Change> changes;
+    for (const std::vector<std::pair<float, const Entry*>> *list : {&drops, &loads}) {
+        for (const std::pair<float, const Entry*> &item : *list) {
+            Change change;
+            change.name = item.second->name;
+            change.width = item.second->width;
+            change.height = item.second->height;
+            change.residentLevel = item.second->residentLevel;
+            change.targetLevel = item.second->targetLevel;
+            changes.push_back(change);
+        }
+    }
+    return changes;
+}
+
+int TextureResidency::getTargetLevel(AssetId id) const {
+    std::unordered_map<uint64_t, Entry>::const_iterator it = entries.find(id.getHash());
+    return it != entries.end() ? it->second.targetLevel : -1;
+}
+
+int TextureResidency::getResidentLevel(AssetId id) const {
+    std::unordered_map<uint64_t, Entry>::const_iterator it = entries.find(id.getHash());
+    return it != entries.end() ? it->second.residentLevel : -1;
+}
+
+void TextureResidency::setResidentLevel(AssetId id, int level) {
+    std::unordered_map<uint64_t, Entry>::iterator it = entries.find(id.getHash());
+    if (it != entries.end()) {
+        it->second.residentLevel = level;
+    }
+}
+
+size_t TextureResidency::getResidentMemoryUsage() const {
+    size_t usage = 0;
+    for (const std::pair<const uint64_t, Entry> &item : entries) {
+        usage += getMemorySize(item.second.width, item.second.height, item.second.residentLevel,
+                               item.second.bitsPerTexel);
+    }
+    return usage;
+}
+
+size_t TextureResidency::getTargetMemoryUsage() const {
+    size_t usage = 0;
+    for (const std::pair<const uint64_t, Entry> &item : entries) {
+        usage += getMemorySize(item.second.width, item.second.height, item.second.targetLevel,
+                               item.second.bitsPerTexel);
+    }
+    return usage;
+}
+
+int TextureResidency::getNumberOfLevels(int width, int height) {
+    int levels = 1;
+    while ((std::max(width, height) >> levels) > 0) {
+        levels++;
+    }
+    return levels;
+}
+
+int TextureResidency::getTailLevel(int width, int height) {
+    int level = 0;
+    while (getLevelSize(width, height, level) > TEXTURE_STREAMING_TAIL_SIZE) {
+        level++;
+    }
+    return level;
+}
+
+int TextureResidency::selectLevel(int width, int height, float screenSizeInPixels) {
+    int lastLevel = getNumberOfLevels(width, height) - 1;
+    int level = 0;
+    while (level < lastLevel && getLevelSize(width, height, level + 1) >= screenSizeInPixels) {
+        level++;
+    }
+    return level;
+}
+
+size_t TextureResidency::getMemorySize(int width, int height, int firstLevel, int bitsPerTexel) {
+    size_t size = 0;
+    int lastLevel = getNumberOfLevels(width, height) - 1;
+    for (int level = firstLevel; level <= lastLevel; level++) {
+        size_t texels = (size_t)std::max(1, width >> level) * std::max(1, height >> level);
+        size += (texels * bitsPerTexel + 7) / 8;
+    }
+    return size;
+}
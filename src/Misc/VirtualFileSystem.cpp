@@ -0,0 +1,300 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "VirtualFileSystem.h"
+#include "PackFile.h"
+#include "AssetId.h"
+#include "Logger.h"
+#include "common/MappedFile.h"
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace {
+
+/**
+ * A mounted pack, whose header and table of contents point into the mapped pack.
+ */
+struct Pack {
+    std::shared_ptr<MappedFile> file;
+    const PackFileHeader *header;
+    const PackFileEntry *table;
+};
+
+std::mutex packsMutex;
+std::vector<Pack> packs;
+
+size_t alignOffset(size_t offset) {
+    return (offset + PACK_FILE_ALIGNMENT - 1) / PACK_FILE_ALIGNMENT * PACK_FILE_ALIGNMENT;
+}
+
+bool isInPack(const MappedFile &file, uint64_t offset, uint64_t size) {
+    return offset <= file.getSize() && size <= file.getSize() - offset;
+}
+
+/**
+ * @return The entry of the file, nullptr if it isn't in the pack
+ */
+const PackFileEntry *findInPack(const Pack &pack, const std::string &normalizedFileName, uint64_t hash) {
+    uint32_t mask = pack.header->tableSize - 1;
+    for (uint32_t probe = 0; probe < pack.header->tableSize; probe++) {
+        const PackFileEntry &entry = pack.table[(hash + probe) & mask];
+        if (entry.nameOffset == 0) {
+            return nullptr;
+        }
+        if (entry.hash == hash && normalizedFileName == pack.file->getData() + entry.nameOffset) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void writePadding(std::ofstream &out, size_t &offset) {
+    static const char zeros[PACK_FILE_ALIGNMENT] = {};
+    size_t alignedOffset = alignOffset(offset);
+    out.write(zeros, alignedOffset - offset);
+    offset = alignedOffset;
+}
+
+}
+
+VirtualFile::VirtualFile(std::shared_ptr<const MappedFile> file, const char *data, size_t size)
+    : file(file), data(data), size(size)
+{
+}
+
+bool VirtualFile::isOpen() const {
+    return file != nullptr;
+}
+
+const char *VirtualFile::getData() const {
+    return data;
+}
+
+size_t VirtualFile::getSize() const {
+    return size;
+}
+
+std::string VirtualFile::getText() const {
+    return std::string(data, size);
+}
+
+bool VirtualFileSystem::mountPack(const std::string &packFileName) {
+    Pack pack;
+    pack.file = std::make_shared<MappedFile>();
+    if (!pack.file->open(packFileName)) {
+        Logger::logError("Could not open the pack " + packFileName);
+        return false;
+    }
+
+    const MappedFile &file = *pack.file;
+    pack.header = reinterpret_cast<const PackFileHeader *>(file.getData());
+    if (!isInPack(file, 0, sizeof(PackFileHeader)) ||
+        pack.header->magic != PACK_FILE_MAGIC || pack.header->version != PACK_FILE_VERSION) {
+        Logger::logError(packFileName + " is not a pack of this version");
+        return false;
+    }
+
+    // Validate the table once, so that opening files can trust it
+    uint32_t tableSize = pack.header->tableSize;
+    bool valid = tableSize != 0 && (tableSize & (tableSize - 1)) == 0 &&
+                 pack.header->tableOffset % PACK_FILE_ALIGNMENT == 0 &&
+                 isInPack(file, pack.header->tableOffset, (uint64_t)tableSize * sizeof(PackFileEntry));
+    pack.table = reinterpret_cast<const PackFileEntry *>(file.getData() + pack.header->tableOffset);
+    bool hasEmptyEntry = false;
+    for (uint32_t i = 0; valid && i < tableSize; i++) {
+        const PackFileEntry &entry = pack.table[i];
+        if (entry.nameOffset == 0) {
+            hasEmptyEntry = true;
+            continue;
+        }
+        valid = isInPack(file, entry.offset, entry.size) && isInPack(file, entry.nameOffset, 1) &&
+                memchr(file.getData() + entry.nameOffset, '\0', file.getSize() - entry.nameOffset) != nullptr;
+    }
+    if (!valid || !hasEmptyEntry) {
+        Logger::logError("The pack " + packFileName + " is corrupt");
+        return false;
+    }
+
+    Logger::logInfo("Mounted the pack " + packFileName + " with " +
+                    std::to_string(pack.header->numFiles) + " files");
+    std::lock_guard<std::mutex> lock(packsMutex);
+    packs.push_back(pack);
+    return true;
+}
+
+void VirtualFileSystem::unmountPacks() {
+    std::lock_guard<std::mutex> lock(packsMutex);
+    packs.clear();
+}
+
+VirtualFile VirtualFileSystem::openFile(const std::string &fileName) {
+    std::string normalizedFileName = normalizePath(fileName);
+    uint64_t hash = AssetId(normalizedFileName).getHash();
+    {
+        std::lock_guard<std::mutex> lock(packsMutex);
+        for (std::vector<Pack>::reverse_iterator pack = packs.rbegin(); pack != packs.rend(); ++pack) {
+            const PackFileEntry *entry = findInPack(*pack, normalizedFileName, hash);
+            if (entry != nullptr) {
+                return VirtualFile(pack->file, pack->file->getData() + entry->offset, entry->size);
+            }
+        }
+    }
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(fileName)) {
+        return VirtualFile();
+    }
+    return VirtualFile(file, file->getData(), file->getSize());
+}
+
+bool VirtualFileSystem::exists(const std::string &fileName) {
+    std::string normalizedFileName = normalizePath(fileName);
+    uint64_t hash = AssetId(normalizedFileName).getHash();
+    {
+        std::lock_guard<std::mutex> lock(packsMutex);
+        for (const Pack &pack : packs) {
+            if (findInPack(pack, normalizedFileName, hash) != nullptr) {
+                return true;
+            }
+        }
+    }
+
+    struct stat fileStatus;
+    return stat(fileName.c_str(), &fileStatus) == 0;
+}
+
+bool VirtualFileSystem::writePack(const std::string &packFileName, const std::vector<std::string> &fileNames) {
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    for (const std::string &fileName : fileNames) {
+        std::string name = normalizePath(fileName);
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            continue;
+        }
+        std::unique_ptr<MappedFile> file(new MappedFile());
+        if (!file->open(fileName)) {
+            Logger::logError("Could not read " + fileName + " into the pack " + packFileName);
+            return false;
+        }
+        names.push_back(name);
+        files.push_back(std::move(file));
+    }
+
+    // At most half of the table is used, which keeps the probes short
+    PackFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PACK_FILE_MAGIC;
+    header.version = PACK_FILE_VERSION;
+    header.numFiles = (uint32_t)names.size();
+    header.tableSize = 16;
+    while (header.tableSize < names.size() * 2) {
+        header.tableSize *= 2;
+    }
+    header.tableOffset = alignOffset(sizeof(PackFileHeader));
+
+    // Lay out the names after the table and the contents after the names
+    std::vector<PackFileEntry> table(header.tableSize);
+    memset(table.data(), 0, table.size() * sizeof(PackFileEntry));
+    size_t offset = header.tableOffset + table.size() * sizeof(PackFileEntry);
+    std::vector<uint64_t> nameOffsets;
+    for (const std::string &name : names) {
+        offset = alignOffset(offset);
+        nameOffsets.push_back(offset);
+        offset += name.size() + 1;
+    }
+    uint32_t mask = header.tableSize - 1;
+    for (size_t i = 0; i < names.size(); i++) {
+        offset = alignOffset(offset);
+        uint64_t hash = AssetId(names[i]).getHash();
+        uint32_t slot = hash & mask;
+        while (table[slot].nameOffset != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot].hash = hash;
+        table[slot].offset = offset;
+        table[slot].size = files[i]->getSize();
+        table[slot].nameOffset = nameOffsets[i];
+        offset += files[i]->getSize();
+    }
+
+    // Written under another name first, so that a mounted pack is never overwritten while it is read
+    std::string temporaryFileName = packFileName + ".tmp";
+    std::ofstream out(temporaryFileName, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    offset = sizeof(header);
+    writePadding(out, offset);
+    out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(PackFileEntry));
+    offset += table.size() * sizeof(PackFileEntry);
+    for (const std::string &name : names) {
+        writePadding(out, offset);
+        out.write(name.c_str(), name.size() + 1);
+        offset += name.size() + 1;
+    }
+    for (const std::unique_ptr<MappedFile> &file : files) {
+        writePadding(out, offset);
+        out.write(file->getData(), file->getSize());
+        offset += file->getSize();
+    }
+    out.close();
+    if (!out) {
+        Logger::logError("Could not write the pack " + packFileName);
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+
+    // Renaming does not replace existing files on all platforms
+    std::remove(packFileName.c_str());
+    if (std::rename(temporaryFileName.c_str(), packFileName.c_str()) != 0) {
+        Logger::logError("Could not write the pack " + packFileName);
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string VirtualFileSystem::normalizePath(const std::string &path) {
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+    std::vector<std::string> segments;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string segment = path.substr(start, end - start);
+        if (segment == "..") {
+            if (!segments.empty() && segments.back() != "..") {
+                segments.pop_back();
+            } else if (!absolute) {
+                segments.push_back(segment);
+            }
+        } else if (!segment.empty() && segment != ".") {
+            segments.push_back(segment);
+        }
+        start = end + 1;
+    }
+
+    std::string normalizedPath = absolute ? "/" : "";
+    for (size_t i = 0; i < segments.size(); i++) {
+        normalizedPath += (i == 0 ? "" : "/") + segments[i];
+    }
+    return normalizedPath;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "AnimationClip.h"
+#include <algorithm>
+#include <cmath>
+#include <assimp/anim.h>
+
+AnimationClip::AnimationClip(const aiAnimation *animation, const std::vector<std::string> &nodeNames,
+                             const Pose &bindPose, bool compress) : compressed(compress), bindPose(bindPose) {
+    name = std::string(animation->mName.data);
+    ticksPerSecond = animation->mTicksPerSecond != 0 ? animation->mTicksPerSecond : 25;
+    durationInTicks = animation->mDuration;
+
+    nodeTracks.assign(nodeNames.size(), -1);
+    for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+        const aiNodeAnim *channel = animation->mChannels[i];
+        std::vector<std::string>::const_iterator node = std::find(nodeNames.begin(), nodeNames.end(),
+                                                                  std::string(channel->mNodeName.data));
+        if (node == nodeNames.end() || nodeTracks[node - nodeNames.begin()] != -1) {
+            continue;
+        }
+
+        std::vector<float> positionTimes, scalingTimes, rotationTimes;
+        std::vector<chag::float3> positions, scalings;
+        std::vector<chag::float4> rotations;
+        for (unsigned int key = 0; key < channel->mNumPositionKeys; key++) {
+            const aiVectorKey &positionKey = channel->mPositionKeys[key];
+            positionTimes.push_back((float)positionKey.mTime);
+            positions.push_back(chag::make_vector(positionKey.mValue.x, positionKey.mValue.y, positionKey.mValue.z));
+        }
+        for (unsigned int key = 0; key < channel->mNumScalingKeys; key++) {
+            const aiVectorKey &scalingKey = channel->mScalingKeys[key];
+            scalingTimes.push_back((float)scalingKey.mTime);
+            scalings.push_back(chag::make_vector(scalingKey.mValue.x, scalingKey.mValue.y, scalingKey.mValue.z));
+        }
+        for (unsigned int key = 0; key < channel->mNumRotationKeys; key++) {
+            const aiQuatKey &rotationKey = channel->mRotationKeys[key];
+            rotationTimes.push_back((float)rotationKey.mTime);
+            rotations.push_back(chag::make_vector(rotationKey.mValue.x, rotationKey.mValue.y,
+                                                  rotationKey.mValue.z, rotationKey.mValue.w));
+        }
+
+        if (compressed) {
+            CompressedTrack track;
+            track.position = CompressedVectorTrack(positionTimes, positions, ANIMATION_COMPRESSION_POSITION_TOLERANCE);
+            track.scaling = CompressedVectorTrack(scalingTimes, scalings, ANIMATION_COMPRESSION_SCALE_TOLERANCE);
+            track.rotation = CompressedRotationTrack(rotationTimes, rotations, ANIMATION_COMPRESSION_ROTATION_TOLERANCE);
+            nodeTracks[node - nodeNames.begin()] = (int)compressedTracks.size();
+            compressedTracks.push_back(track);
+        } else {
+            ExactTrack track;
+            track.position = ExactVectorTrack(positionTimes, positions);
+            track.scaling = ExactVectorTrack(scalingTimes, scalings);
+            track.rotation = ExactRotationTrack(rotationTimes, rotations);
+            nodeTracks[node - nodeNames.begin()] = (int)exactTracks.size();
+            exactTracks.push_back(track);
+        }
+    }
+
+    KeyframeCache keyframeCache;
+    sample(0.0f, false, referencePose, keyframeCache);
+}
+
+const std::string &AnimationClip::getName() const {
+    return name;
+}
+
+float AnimationClip::getDurationInSeconds() const {
+    return (float)(durationInTicks / ticksPerSecond);
+}
+
+bool AnimationClip::isCompressed() const {
+    return compressed;
+}
+
+bool AnimationClip::animatesNode(size_t node) const {
+    return nodeTracks[node] != -1;
+}
+
+const Pose &AnimationClip::getReferencePose() const {
+    return referencePose;
+}
+
+float AnimationClip::getTick(float timeInSeconds, bool loop) const {
+    double elapsedTimeInTicks = timeInSeconds * ticksPerSecond;
+    if (durationInTicks <= 0.0) {
+        return 0.0f;
+    }
+    if (loop) {
+        return (float)fmod(elapsedTimeInTicks, durationInTicks);
+    }
+    return (float)std::min(elapsedTimeInTicks, durationInTicks);
+}
+
+void AnimationClip::sample(float timeInSeconds, bool loop, Pose &pose, KeyframeCache &keyframeCache) const {
+    size_t numberOfNodes = nodeTracks.size();
+    pose.resize(numberOfNodes);
+    if (keyframeCache.channels.size() != numberOfNodes) {
+        keyframeCache.channels.assign(numberOfNodes, KeyframeCache::ChannelKeys());
+    }
+
+    float tick = getTick(timeInSeconds, loop);
+    if (compressed) {
+        sampleTracks(compressedTracks, tick, pose, keyframeCache);
+    } else {
+        sampleTracks(exactTracks, tick, pose, keyframeCache);
+    }
+}
+
+template<typename T>
+void AnimationClip::sampleTracks(const std::vector<T> &tracks, float tick, Pose &pose,
+                                 KeyframeCache &keyframeCache) const {
+    for (size_t node = 0; node < nodeTracks.size(); node++) {
+        if (nodeTracks[node] == -1) {
+            pose.setNode(node, bindPose.getTranslation(node), bindPose.getRotation(node), bindPose.getScale(node));
+            continue;
+        }
+
+        const T &track = tracks[nodeTracks[node]];
+        KeyframeCache::ChannelKeys &keys = keyframeCache.channels[node];
+
+        pose.setNode(node, track.position.sample(tick, keys.position, bindPose.getTranslation(node)),
+                     track.rotation.sample(tick, keys.rotation, bindPose.getRotation(node)),
+                     track.scaling.sample(tick, keys.scaling, bindPose.getScale(node)));
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4.h"
+#include "KeyframeCache.h"
+#include "CompressedTrack.h"
+#include "Pose.h"
+
+struct aiAnimation;
+
+/**
+ * \brief An animation with its keyframes copied out of assimp.
+ *
+ * The keyframes are compressed when copied unless asked not to, see
+ * CompressedVectorTrack and CompressedRotationTrack.
+ *
+ * The tracks of the clip are indexed by the flattened nodes of the skeleton
+ * it was loaded for, so sampling never has to look anything up by name.
+ * Nodes that the clip doesn't animate are sampled as their bind pose.
+ */
+class AnimationClip {
+public:
+    /**
+     * @param animation The assimp animation to copy the keyframes from
+     * @param nodeNames The names of the nodes of the skeleton, in flattened order
+     * @param bindPose The local transformation of each node when not animated
+     * @param compress If the keyframes are compressed, or kept at full precision
+     */
+    AnimationClip(const aiAnimation *animation, const std::vector<std::string> &nodeNames, const Pose &bindPose,
+                  bool compress = true);
+
+    const std::string &getName() const;
+    float getDurationInSeconds() const;
+    bool isCompressed() const;
+
+    /**
+     * @return If the clip has a track for the node
+     */
+    bool animatesNode(size_t node) const;
+
+    /**
+     * Samples the local transformation of every node.
+     *
+     * @param timeInSeconds The time since the clip started playing
+     * @param loop If the clip should wrap around instead of stopping on its last frame
+     * @param pose Receives the sampled pose, resized to the number of nodes
+     * @param keyframeCache The keys found by the last sample, see KeyframeCache
+     */
+    void sample(float timeInSeconds, bool loop, Pose &pose, KeyframeCache &keyframeCache) const;
+
+    /**
+     * The pose at the first frame of the clip. Additive layers apply their
+     * difference from this pose.
+     */
+    const Pose &getReferencePose() const;
+
+private:
+    template<typename VectorTrack, typename RotationTrack>
+    struct Track {
+        VectorTrack position;
+        RotationTrack rotation;
+        VectorTrack scaling;
+    };
+    typedef Track<CompressedVectorTrack, CompressedRotationTrack> CompressedTrack;
+    typedef Track<ExactVectorTrack, ExactRotationTrack> ExactTrack;
+
+    std::string name;
+    double ticksPerSecond;
+    double durationInTicks;
+
+    bool compressed;
+    // The index into the tracks for each node, -1 if the node isn't animated
+    std::vector<int> nodeTracks;
+    // Only the tracks matching compressed are filled
+    std::vector<CompressedTrack> compressedTracks;
+    std::vector<ExactTrack> exactTracks;
+    Pose bindPose;
+    Pose referencePose;
+
+    float getTick(float timeInSeconds, bool loop) const;
+
+    template<typename T>
+    void sampleTracks(const std::vector<T> &tracks, float tick, Pose &pose, KeyframeCache &keyframeCache) const;
+};
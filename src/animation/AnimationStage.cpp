@@ -0,0 +1,61 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "AnimationStage.h"
+#include <algorithm>
+#include "AnimationState.h"
+#include "JobSystem.h"
+#include "animation/PoseCache.h"
+#include "collision/SkinnedCollisionMesh.h"
+
+void AnimationStage::clear() {
+    instances.clear();
+}
+
+void AnimationStage::addInstance(AnimationState *animationState, bool evaluatePose,
+                                 SkinnedCollisionMesh *collisionMesh) {
+    Instance instance = { animationState, evaluatePose, collisionMesh };
+    instances.push_back(instance);
+}
+
+size_t AnimationStage::getNumberOfInstances() const {
+    return instances.size();
+}
+
+void AnimationStage::evaluate() {
+    // Poses are only shared within the frame, so the caches never outgrow it
+    std::vector<PoseCache*> poseCaches;
+    for (const Instance &instance : instances) {
+        if (instance.evaluatePose) {
+            poseCaches.push_back(&instance.animationState->getPoseCache());
+        }
+    }
+    std::sort(poseCaches.begin(), poseCaches.end());
+    poseCaches.erase(std::unique(poseCaches.begin(), poseCaches.end()), poseCaches.end());
+    for (PoseCache *poseCache : poseCaches) {
+        poseCache->clear();
+    }
+
+    JobSystem::parallelFor(instances.size(), [this](size_t i) {
+        const Instance &instance = instances[i];
+        if (instance.evaluatePose) {
+            instance.animationState->evaluate();
+        }
+        if (instance.collisionMesh != nullptr) {
+            instance.collisionMesh->update(instance.animationState->getBoneTransforms());
+        }
+    });
+}
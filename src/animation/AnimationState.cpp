@@ -0,0 +1,181 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "AnimationState.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "objects/BoneTransformer.h"
+
+AnimationState::AnimationState(std::shared_ptr<BoneTransformer> skeleton) : skeleton(skeleton) {
+    if (skeleton->getNumberOfAnimationClips() > 0) {
+        current.clipIndex = 0;
+    }
+}
+
+std::vector<std::string> AnimationState::getClipNames() const {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < skeleton->getNumberOfAnimationClips(); i++) {
+        names.push_back(skeleton->getAnimationClip(i).getName());
+    }
+    return names;
+}
+
+int AnimationState::findClip(const std::string &clipName) const {
+    int clipIndex = skeleton->getAnimationClipIndex(clipName);
+    if (clipIndex == -1) {
+        throw std::invalid_argument("The mesh has no animation clip named " + clipName);
+    }
+    return clipIndex;
+}
+
+void AnimationState::play(const std::string &clipName, float fadeInSeconds, bool loop) {
+    int clipIndex = findClip(clipName);
+
+    if (fadeInSeconds > 0.0f && current.clipIndex != -1) {
+        previous = current;
+        fadeDuration = fadeInSeconds;
+        fadeTime = 0.0f;
+    } else {
+        previous.clipIndex = -1;
+    }
+
+    current.clipIndex = clipIndex;
+    current.timeInSeconds = 0.0f;
+    current.loop = loop;
+}
+
+void AnimationState::setLayer(const std::string &clipName, float weight) {
+    int clipIndex = findClip(clipName);
+
+    for (Layer &layer : layers) {
+        if (layer.playback.clipIndex == clipIndex) {
+            layer.weight = weight;
+            return;
+        }
+    }
+
+    Layer layer;
+    layer.playback.clipIndex = clipIndex;
+    layer.weight = weight;
+    layers.push_back(layer);
+}
+
+void AnimationState::removeLayer(const std::string &clipName) {
+    int clipIndex = skeleton->getAnimationClipIndex(clipName);
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (layers[i].playback.clipIndex == clipIndex) {
+            layers.erase(layers.begin() + i);
+            return;
+        }
+    }
+}
+
+void AnimationState::update(float dt) {
+    current.timeInSeconds += dt;
+
+    if (previous.clipIndex != -1) {
+        previous.timeInSeconds += dt;
+        fadeTime += dt;
+        if (fadeTime >= fadeDuration) {
+            previous.clipIndex = -1;
+        }
+    }
+
+    for (Layer &layer : layers) {
+        layer.playback.timeInSeconds += dt;
+    }
+}
+
+void AnimationState::sample(ClipPlayback &playback, Pose &result) {
+    const AnimationClip &clip = skeleton->getAnimationClip((size_t)playback.clipIndex);
+    clip.sample(playback.timeInSeconds, playback.loop, result, playback.keyframeCache);
+}
+
+bool AnimationState::isPlayingSingleClip() const {
+    if (current.clipIndex == -1 || previous.clipIndex != -1) {
+        return false;
+    }
+    for (const Layer &layer : layers) {
+        if (layer.weight != 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AnimationState::evaluate() {
+    if (isPlayingSingleClip() && skeleton->getPoseCache().getTimeQuantisation() > 0.0f) {
+        evaluateShared();
+        return;
+    }
+    sharedBoneTransforms.reset();
+
+    if (current.clipIndex == -1) {
+        pose = skeleton->getBindPose();
+    } else {
+        sample(current, pose);
+    }
+
+    if (previous.clipIndex != -1) {
+        sample(previous, fadingPose);
+        Pose::blend(fadingPose, pose, fadeTime / fadeDuration, pose);
+    }
+
+    for (Layer &layer : layers) {
+        if (layer.weight == 0.0f) {
+            continue;
+        }
+        sample(layer.playback, layerPose);
+        const AnimationClip &clip = skeleton->getAnimationClip((size_t)layer.playback.clipIndex);
+        Pose::addAdditive(pose, layerPose, clip.getReferencePose(), layer.weight, pose);
+    }
+
+    skeleton->calculateBoneTransforms(pose, boneTransforms, globalTransformations);
+}
+
+const std::vector<chag::float4x4> &AnimationState::getBoneTransforms() const {
+    return sharedBoneTransforms ? *sharedBoneTransforms : boneTransforms;
+}
+
+PoseCache &AnimationState::getPoseCache() {
+    return skeleton->getPoseCache();
+}
+
+void AnimationState::evaluateShared() {
+    const AnimationClip &clip = skeleton->getAnimationClip((size_t)current.clipIndex);
+    PoseCache &poseCache = skeleton->getPoseCache();
+
+    // Wrap or clamp first so instances a whole number of loops apart share a pose
+    float duration = clip.getDurationInSeconds();
+    float time = current.timeInSeconds;
+    if (duration > 0.0f) {
+        time = current.loop ? (float)fmod(time, duration) : std::min(time, duration);
+    }
+
+    long long step;
+    float quantisedTime = poseCache.quantise(time, duration, step);
+
+    sharedBoneTransforms = poseCache.find(current.clipIndex, current.loop, step);
+    if (sharedBoneTransforms) {
+        return;
+    }
+
+    clip.sample(quantisedTime, current.loop, pose, current.keyframeCache);
+    std::shared_ptr<std::vector<chag::float4x4>> evaluated = std::make_shared<std::vector<chag::float4x4>>();
+    skeleton->calculateBoneTransforms(pose, *evaluated, globalTransformations);
+    sharedBoneTransforms = poseCache.insert(current.clipIndex, current.loop, step, evaluated);
+}
@@ -0,0 +1,308 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "CompressedTrack.h"
+#include <algorithm>
+#include <cmath>
+
+#define QUANTISED_VECTOR_RANGE 65535.0f
+// Components are stored as 15 bit values centered around this, so zero is exact
+#define QUANTISED_ROTATION_CENTER 16383
+#define SMALLEST_THREE_MAX 0.70710678f
+
+/**
+ * Spherical interpolation of two quaternions, stored as (x, y, z, w).
+ * Matches aiQuaternion::Interpolate.
+ */
+static chag::float4 slerp(const chag::float4 &from, const chag::float4 &to, float factor) {
+    float cosom = from.x * to.x + from.y * to.y + from.z * to.z + from.w * to.w;
+
+    chag::float4 end = to;
+    if (cosom < 0.0f) {
+        cosom = -cosom;
+        end = chag::make_vector(-to.x, -to.y, -to.z, -to.w);
+    }
+
+    float sclp, sclq;
+    if ((1.0f - cosom) > 0.0001f) {
+        float omega = std::acos(cosom);
+        float sinom = std::sin(omega);
+        sclp = std::sin((1.0f - factor) * omega) / sinom;
+        sclq = std::sin(factor * omega) / sinom;
+    } else {
+        // Very close, use a linear interpolation
+        sclp = 1.0f - factor;
+        sclq = factor;
+    }
+
+    return chag::make_vector(sclp * from.x + sclq * end.x,
+                             sclp * from.y + sclq * end.y,
+                             sclp * from.z + sclq * end.z,
+                             sclp * from.w + sclq * end.w);
+}
+
+static chag::float3 lerp(const chag::float3 &from, const chag::float3 &to, float factor) {
+    return from + (to - from) * factor;
+}
+
+static float vectorError(const chag::float3 &a, const chag::float3 &b) {
+    return std::max(std::fabs(a.x - b.x), std::max(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+}
+
+static float rotationError(const chag::float4 &a, const chag::float4 &b) {
+    return 1.0f - std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+}
+
+/**
+ * Picks the keys to keep, greedily extending each segment for as long as
+ * interpolating between its ends reproduces every key in between.
+ */
+template<typename T, typename Interpolate, typename Error>
+static std::vector<size_t> reduceKeys(const std::vector<float> &times, const std::vector<T> &values,
+                                      float tolerance, Interpolate interpolate, Error error) {
+    std::vector<size_t> keptKeys;
+    size_t numberOfKeys = values.size();
+    if (numberOfKeys == 0) {
+        return keptKeys;
+    }
+
+    keptKeys.push_back(0);
+    size_t start = 0;
+    for (size_t end = start + 2; end < numberOfKeys; end++) {
+        float duration = times[end] - times[start];
+        for (size_t key = start + 1; key < end; key++) {
+            float factor = duration > 0.0f ? (times[key] - times[start]) / duration : 0.0f;
+            if (error(interpolate(values[start], values[end], factor), values[key]) > tolerance) {
+                start = end - 1;
+                keptKeys.push_back(start);
+                break;
+            }
+        }
+    }
+
+    // A track that never changes only needs its first key
+    if (numberOfKeys > 1 && !(keptKeys.size() == 1 && error(values[0], values[numberOfKeys - 1]) <= tolerance)) {
+        keptKeys.push_back(numberOfKeys - 1);
+    }
+    return keptKeys;
+}
+
+/**
+ * Finds the key right before the tick and how far the tick is towards the next key.
+ */
+static unsigned int findKey(float tick, const std::vector<float> &times, unsigned int &cachedIndex, float &factor) {
+    unsigned int numberOfKeys = (unsigned int)times.size();
+    unsigned int key = numberOfKeys - 2;
+
+    bool found = false;
+    // Forward playback almost always stays on the same keys, or moves on to the next ones
+    for (unsigned int i = cachedIndex; i < cachedIndex + 2 && i + 1 < numberOfKeys; i++) {
+        if ((i == 0 || times[i] <= tick) && tick < times[i + 1]) {
+            key = i;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        std::vector<float>::const_iterator nextKey = std::upper_bound(times.begin() + 1, times.end(), tick);
+        if (nextKey != times.end()) {
+            key = (unsigned int)(nextKey - times.begin()) - 1;
+        }
+    }
+    cachedIndex = key;
+
+    float deltaTime = times[key + 1] - times[key];
+    factor = deltaTime > 0.0f ? (tick - times[key]) / deltaTime : 0.0f;
+    factor = std::max(0.0f, std::min(1.0f, factor));
+    return key;
+}
+
+static uint16_t quantise(float value, float minimum, float extent) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    float normalized = std::max(0.0f, std::min(1.0f, (value - minimum) / extent));
+    return (uint16_t)std::lround(normalized * QUANTISED_VECTOR_RANGE);
+}
+
+CompressedVectorTrack::CompressedVectorTrack(const std::vector<float> &times, const std::vector<chag::float3> &values,
+                                             float tolerance) {
+    std::vector<size_t> keptKeys = reduceKeys(times, values, tolerance, lerp, vectorError);
+    if (keptKeys.empty()) {
+        return;
+    }
+
+    chag::float3 maximum = values[keptKeys[0]];
+    minimum = values[keptKeys[0]];
+    for (size_t key : keptKeys) {
+        minimum = chag::make_vector(std::min(minimum.x, values[key].x), std::min(minimum.y, values[key].y),
+                                    std::min(minimum.z, values[key].z));
+        maximum = chag::make_vector(std::max(maximum.x, values[key].x), std::max(maximum.y, values[key].y),
+                                    std::max(maximum.z, values[key].z));
+    }
+    extent = maximum - minimum;
+
+    this->times.reserve(keptKeys.size());
+    this->values.reserve(keptKeys.size() * 3);
+    for (size_t key : keptKeys) {
+        this->times.push_back(times[key]);
+        this->values.push_back(quantise(values[key].x, minimum.x, extent.x));
+        this->values.push_back(quantise(values[key].y, minimum.y, extent.y));
+        this->values.push_back(quantise(values[key].z, minimum.z, extent.z));
+    }
+}
+
+size_t CompressedVectorTrack::getNumberOfKeys() const {
+    return times.size();
+}
+
+chag::float3 CompressedVectorTrack::decode(size_t key) const {
+    const uint16_t *value = &values[key * 3];
+    return chag::make_vector(minimum.x + extent.x * (value[0] / QUANTISED_VECTOR_RANGE),
+                             minimum.y + extent.y * (value[1] / QUANTISED_VECTOR_RANGE),
+                             minimum.z + extent.z * (value[2] / QUANTISED_VECTOR_RANGE));
+}
+
+chag::float3 CompressedVectorTrack::sample(float tick, unsigned int &cachedIndex,
+                                           const chag::float3 &defaultValue) const {
+    if (times.empty()) {
+        return defaultValue;
+    }
+    if (times.size() == 1) {
+        return decode(0);
+    }
+
+    float factor;
+    unsigned int key = findKey(tick, times, cachedIndex, factor);
+    return lerp(decode(key), decode(key + 1), factor);
+}
+
+CompressedRotationTrack::CompressedRotationTrack(const std::vector<float> &times,
+                                                 const std::vector<chag::float4> &rotations, float tolerance) {
+    std::vector<size_t> keptKeys = reduceKeys(times, rotations, tolerance, slerp, rotationError);
+
+    this->times.reserve(keptKeys.size());
+    values.resize(keptKeys.size() * 3);
+    for (size_t i = 0; i < keptKeys.size(); i++) {
+        this->times.push_back(times[keptKeys[i]]);
+        encode(rotations[keptKeys[i]], &values[i * 3]);
+    }
+}
+
+size_t CompressedRotationTrack::getNumberOfKeys() const {
+    return times.size();
+}
+
+void CompressedRotationTrack::encode(const chag::float4 &rotation, uint16_t packed[3]) {
+    float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(components[i]) > std::fabs(components[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so the largest component can always be positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    int packedComponent = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        float value = std::max(-1.0f, std::min(1.0f, sign * components[i] / SMALLEST_THREE_MAX));
+        packed[packedComponent++] = (uint16_t)(std::lround(value * QUANTISED_ROTATION_CENTER) + QUANTISED_ROTATION_CENTER);
+    }
+    // The top bits of the first two components hold the index of the largest one
+    packed[0] |= (uint16_t)((largest >> 1) << 15);
+    packed[1] |= (uint16_t)((largest & 1) << 15);
+}
+
+chag::float4 CompressedRotationTrack::decode(const uint16_t packed[3]) {
+    int largest = ((packed[0] >> 15) << 1) | (packed[1] >> 15);
+
+    float components[4];
+    float sumOfSquares = 0.0f;
+    int packedComponent = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        int value = (packed[packedComponent++] & 0x7FFF) - QUANTISED_ROTATION_CENTER;
+        components[i] = value * (SMALLEST_THREE_MAX / QUANTISED_ROTATION_CENTER);
+        sumOfSquares += components[i] * components[i];
+    }
+    components[largest] = std::sqrt(std::max(0.0f, 1.0f - sumOfSquares));
+
+    return chag::make_vector(components[0], components[1], components[2], components[3]);
+}
+
+chag::float4 CompressedRotationTrack::sample(float tick, unsigned int &cachedIndex,
+                                             const chag::float4 &defaultValue) const {
+    if (times.empty()) {
+        return defaultValue;
+    }
+    if (times.size() == 1) {
+        return decode(&values[0]);
+    }
+
+    float factor;
+    unsigned int key = findKey(tick, times, cachedIndex, factor);
+    return slerp(decode(&values[key * 3]), decode(&values[(key + 1) * 3]), factor);
+}
+
+ExactVectorTrack::ExactVectorTrack(const std::vector<float> &times, const std::vector<chag::float3> &values)
+        : times(times), values(values) {
+}
+
+size_t ExactVectorTrack::getNumberOfKeys() const {
+    return times.size();
+}
+
+chag::float3 ExactVectorTrack::sample(float tick, unsigned int &cachedIndex, const chag::float3 &defaultValue) const {
+    if (times.empty()) {
+        return defaultValue;
+    }
+    if (times.size() == 1) {
+        return values[0];
+    }
+
+    float factor;
+    unsigned int key = findKey(tick, times, cachedIndex, factor);
+    return lerp(values[key], values[key + 1], factor);
+}
+
+ExactRotationTrack::ExactRotationTrack(const std::vector<float> &times, const std::vector<chag::float4> &rotations)
+        : times(times), rotations(rotations) {
+}
+
+size_t ExactRotationTrack::getNumberOfKeys() const {
+    return times.size();
+}
+
+chag::float4 ExactRotationTrack::sample(float tick, unsigned int &cachedIndex,
+                                        const chag::float4 &defaultValue) const {
+    if (times.empty()) {
+        return defaultValue;
+    }
+    if (times.size() == 1) {
+        return rotations[0];
+    }
+
+    float factor;
+    unsigned int key = findKey(tick, times, cachedIndex, factor);
+    return slerp(rotations[key], rotations[key + 1], factor);
+}
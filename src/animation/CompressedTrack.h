@@ -0,0 +1,142 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4.h"
+
+// The largest position error, in model units, allowed when removing keys
+#define ANIMATION_COMPRESSION_POSITION_TOLERANCE 0.0001f
+// The largest scale error allowed when removing keys
+#define ANIMATION_COMPRESSION_SCALE_TOLERANCE 0.0001f
+// The largest rotation error allowed when removing keys, as 1 - |dot| of the quaternions
+#define ANIMATION_COMPRESSION_ROTATION_TOLERANCE 0.000001f
+
+/**
+ * \brief A position or scaling track, compressed at load.
+ *
+ * Keys that linear interpolation of their neighbours reproduces within the
+ * tolerance are removed, and the remaining ones are quantised to 16 bits
+ * per component within the range of the track. A key takes 6 bytes
+ * instead of 12, and a track that never changes keeps a single key.
+ */
+class CompressedVectorTrack {
+public:
+    CompressedVectorTrack() = default;
+    CompressedVectorTrack(const std::vector<float> &times, const std::vector<chag::float3> &values, float tolerance);
+
+    size_t getNumberOfKeys() const;
+
+    /**
+     * Interpolates the track at the tick.
+     *
+     * @param cachedIndex The key found last time, see KeyframeCache
+     * @param defaultValue Returned if the track has no keys
+     */
+    chag::float3 sample(float tick, unsigned int &cachedIndex, const chag::float3 &defaultValue) const;
+
+private:
+    std::vector<float> times;
+    std::vector<uint16_t> values;
+    chag::float3 minimum;
+    chag::float3 extent;
+
+    chag::float3 decode(size_t key) const;
+};
+
+/**
+ * \brief A rotation track, compressed at load.
+ *
+ * Keys that slerp of their neighbours reproduces within the tolerance are
+ * removed. The remaining quaternions are stored as their three smallest
+ * components in 15 bits each, plus the index of the largest one, which is
+ * recomputed from the others since the quaternion has unit length. A key
+ * takes 6 bytes instead of 16.
+ */
+class CompressedRotationTrack {
+public:
+    CompressedRotationTrack() = default;
+    CompressedRotationTrack(const std::vector<float> &times, const std::vector<chag::float4> &rotations, float tolerance);
+
+    size_t getNumberOfKeys() const;
+
+    /**
+     * Interpolates the track at the tick.
+     *
+     * @param cachedIndex The key found last time, see KeyframeCache
+     * @param defaultValue Returned if the track has no keys
+     */
+    chag::float4 sample(float tick, unsigned int &cachedIndex, const chag::float4 &defaultValue) const;
+
+    static void encode(const chag::float4 &rotation, uint16_t packed[3]);
+    static chag::float4 decode(const uint16_t packed[3]);
+
+private:
+    std::vector<float> times;
+    std::vector<uint16_t> values;
+};
+
+/**
+ * \brief A position or scaling track that keeps every key at full precision.
+ *
+ * Sampled exactly like the keys assimp loaded, for clips that must not be
+ * compressed.
+ */
+class ExactVectorTrack {
+public:
+    ExactVectorTrack() = default;
+    ExactVectorTrack(const std::vector<float> &times, const std::vector<chag::float3> &values);
+
+    size_t getNumberOfKeys() const;
+
+    /**
+     * Interpolates the track at the tick.
+     *
+     * @param cachedIndex The key found last time, see KeyframeCache
+     * @param defaultValue Returned if the track has no keys
+     */
+    chag::float3 sample(float tick, unsigned int &cachedIndex, const chag::float3 &defaultValue) const;
+
+private:
+    std::vector<float> times;
+    std::vector<chag::float3> values;
+};
+
+/**
+ * \brief A rotation track that keeps every key at full precision.
+ */
+class ExactRotationTrack {
+public:
+    ExactRotationTrack() = default;
+    ExactRotationTrack(const std::vector<float> &times, const std::vector<chag::float4> &rotations);
+
+    size_t getNumberOfKeys() const;
+
+    /**
+     * Interpolates the track at the tick.
+     *
+     * @param cachedIndex The key found last time, see KeyframeCache
+     * @param defaultValue Returned if the track has no keys
+     */
+    chag::float4 sample(float tick, unsigned int &cachedIndex, const chag::float4 &defaultValue) const;
+
+private:
+    std::vector<float> times;
+    std::vector<chag::float4> rotations;
+};
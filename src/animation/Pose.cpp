@@ -0,0 +1,358 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "Pose.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(POSE_FORCE_SCALAR)
+#include <emmintrin.h>
+#define POSE_USE_SSE
+#endif
+
+#define POSE_NODES_PER_BATCH 4
+
+Pose::Pose(size_t numberOfNodes) {
+    resize(numberOfNodes);
+}
+
+size_t Pose::paddedSize() const {
+    return (numberOfNodes + POSE_NODES_PER_BATCH - 1) / POSE_NODES_PER_BATCH * POSE_NODES_PER_BATCH;
+}
+
+void Pose::resize(size_t numberOfNodes) {
+    this->numberOfNodes = numberOfNodes;
+    size_t size = paddedSize();
+
+    translationX.resize(size, 0.0f);
+    translationY.resize(size, 0.0f);
+    translationZ.resize(size, 0.0f);
+    rotationX.resize(size, 0.0f);
+    rotationY.resize(size, 0.0f);
+    rotationZ.resize(size, 0.0f);
+    rotationW.resize(size, 1.0f);
+    scaleX.resize(size, 1.0f);
+    scaleY.resize(size, 1.0f);
+    scaleZ.resize(size, 1.0f);
+}
+
+size_t Pose::size() const {
+    return numberOfNodes;
+}
+
+void Pose::setIdentity() {
+    size_t size = paddedSize();
+    translationX.assign(size, 0.0f);
+    translationY.assign(size, 0.0f);
+    translationZ.assign(size, 0.0f);
+    rotationX.assign(size, 0.0f);
+    rotationY.assign(size, 0.0f);
+    rotationZ.assign(size, 0.0f);
+    rotationW.assign(size, 1.0f);
+    scaleX.assign(size, 1.0f);
+    scaleY.assign(size, 1.0f);
+    scaleZ.assign(size, 1.0f);
+}
+
+void Pose::setNode(size_t node, const chag::float3 &translation, const chag::float4 &rotation,
+                   const chag::float3 &scale) {
+    translationX[node] = translation.x;
+    translationY[node] = translation.y;
+    translationZ[node] = translation.z;
+    rotationX[node] = rotation.x;
+    rotationY[node] = rotation.y;
+    rotationZ[node] = rotation.z;
+    rotationW[node] = rotation.w;
+    scaleX[node] = scale.x;
+    scaleY[node] = scale.y;
+    scaleZ[node] = scale.z;
+}
+
+chag::float3 Pose::getTranslation(size_t node) const {
+    return chag::make_vector(translationX[node], translationY[node], translationZ[node]);
+}
+
+chag::float4 Pose::getRotation(size_t node) const {
+    return chag::make_vector(rotationX[node], rotationY[node], rotationZ[node], rotationW[node]);
+}
+
+chag::float3 Pose::getScale(size_t node) const {
+    return chag::make_vector(scaleX[node], scaleY[node], scaleZ[node]);
+}
+
+void Pose::requireSameSize(const Pose &pose, const Pose &other) {
+    if (pose.size() != other.size()) {
+        throw std::invalid_argument("Poses of " + std::to_string(pose.size()) + " and "
+                                    + std::to_string(other.size()) + " nodes can't be combined.");
+    }
+}
+
+#ifdef POSE_USE_SSE
+
+static inline __m128 lerp4(__m128 from, __m128 to, __m128 weight) {
+    return _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), weight));
+}
+
+static inline void normalize4(__m128 &x, __m128 &y, __m128 &z, __m128 &w) {
+    __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                      _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+    __m128 length = _mm_sqrt_ps(lengthSquared);
+    x = _mm_div_ps(x, length);
+    y = _mm_div_ps(y, length);
+    z = _mm_div_ps(z, length);
+    w = _mm_div_ps(w, length);
+}
+
+void Pose::blendSse(const Pose &from, const Pose &to, float weight, Pose &result) {
+    result.resize(from.size());
+    size_t size = from.paddedSize();
+
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 oneMinusW = _mm_set1_ps(1.0f - weight);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t i = 0; i < size; i += POSE_NODES_PER_BATCH) {
+        _mm_storeu_ps(&result.translationX[i], lerp4(_mm_loadu_ps(&from.translationX[i]), _mm_loadu_ps(&to.translationX[i]), w));
+        _mm_storeu_ps(&result.translationY[i], lerp4(_mm_loadu_ps(&from.translationY[i]), _mm_loadu_ps(&to.translationY[i]), w));
+        _mm_storeu_ps(&result.translationZ[i], lerp4(_mm_loadu_ps(&from.translationZ[i]), _mm_loadu_ps(&to.translationZ[i]), w));
+        _mm_storeu_ps(&result.scaleX[i], lerp4(_mm_loadu_ps(&from.scaleX[i]), _mm_loadu_ps(&to.scaleX[i]), w));
+        _mm_storeu_ps(&result.scaleY[i], lerp4(_mm_loadu_ps(&from.scaleY[i]), _mm_loadu_ps(&to.scaleY[i]), w));
+        _mm_storeu_ps(&result.scaleZ[i], lerp4(_mm_loadu_ps(&from.scaleZ[i]), _mm_loadu_ps(&to.scaleZ[i]), w));
+
+        __m128 ax = _mm_loadu_ps(&from.rotationX[i]);
+        __m128 ay = _mm_loadu_ps(&from.rotationY[i]);
+        __m128 az = _mm_loadu_ps(&from.rotationZ[i]);
+        __m128 aw = _mm_loadu_ps(&from.rotationW[i]);
+        __m128 bx = _mm_loadu_ps(&to.rotationX[i]);
+        __m128 by = _mm_loadu_ps(&to.rotationY[i]);
+        __m128 bz = _mm_loadu_ps(&to.rotationZ[i]);
+        __m128 bw = _mm_loadu_ps(&to.rotationW[i]);
+
+        // Flip the target where needed so that we blend along the shortest path
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                                _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+        __m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit);
+        __m128 toWeight = _mm_xor_ps(w, flip);
+
+        __m128 x = _mm_add_ps(_mm_mul_ps(ax, oneMinusW), _mm_mul_ps(bx, toWeight));
+        __m128 y = _mm_add_ps(_mm_mul_ps(ay, oneMinusW), _mm_mul_ps(by, toWeight));
+        __m128 z = _mm_add_ps(_mm_mul_ps(az, oneMinusW), _mm_mul_ps(bz, toWeight));
+        __m128 qw = _mm_add_ps(_mm_mul_ps(aw, oneMinusW), _mm_mul_ps(bw, toWeight));
+        normalize4(x, y, z, qw);
+
+        _mm_storeu_ps(&result.rotationX[i], x);
+        _mm_storeu_ps(&result.rotationY[i], y);
+        _mm_storeu_ps(&result.rotationZ[i], z);
+        _mm_storeu_ps(&result.rotationW[i], qw);
+    }
+}
+
+void Pose::addAdditiveSse(const Pose &base, const Pose &additive, const Pose &reference, float weight, Pose &result) {
+    result.resize(base.size());
+    size_t size = base.paddedSize();
+
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+
+    for (size_t i = 0; i < size; i += POSE_NODES_PER_BATCH) {
+        // Translation: base + w * (additive - reference)
+        __m128 tx = _mm_sub_ps(_mm_loadu_ps(&additive.translationX[i]), _mm_loadu_ps(&reference.translationX[i]));
+        __m128 ty = _mm_sub_ps(_mm_loadu_ps(&additive.translationY[i]), _mm_loadu_ps(&reference.translationY[i]));
+        __m128 tz = _mm_sub_ps(_mm_loadu_ps(&additive.translationZ[i]), _mm_loadu_ps(&reference.translationZ[i]));
+        _mm_storeu_ps(&result.translationX[i], _mm_add_ps(_mm_loadu_ps(&base.translationX[i]), _mm_mul_ps(tx, w)));
+        _mm_storeu_ps(&result.translationY[i], _mm_add_ps(_mm_loadu_ps(&base.translationY[i]), _mm_mul_ps(ty, w)));
+        _mm_storeu_ps(&result.translationZ[i], _mm_add_ps(_mm_loadu_ps(&base.translationZ[i]), _mm_mul_ps(tz, w)));
+
+        // Scale: base * lerp(1, additive / reference, w), a zero reference scale adds nothing
+        __m128 sx = _mm_loadu_ps(&reference.scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&reference.scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&reference.scaleZ[i]);
+        __m128 validX = _mm_cmpneq_ps(sx, zero);
+        __m128 validY = _mm_cmpneq_ps(sy, zero);
+        __m128 validZ = _mm_cmpneq_ps(sz, zero);
+        __m128 ratioX = _mm_div_ps(_mm_loadu_ps(&additive.scaleX[i]), _mm_or_ps(_mm_and_ps(validX, sx), _mm_andnot_ps(validX, one)));
+        __m128 ratioY = _mm_div_ps(_mm_loadu_ps(&additive.scaleY[i]), _mm_or_ps(_mm_and_ps(validY, sy), _mm_andnot_ps(validY, one)));
+        __m128 ratioZ = _mm_div_ps(_mm_loadu_ps(&additive.scaleZ[i]), _mm_or_ps(_mm_and_ps(validZ, sz), _mm_andnot_ps(validZ, one)));
+        ratioX = _mm_or_ps(_mm_and_ps(validX, ratioX), _mm_andnot_ps(validX, one));
+        ratioY = _mm_or_ps(_mm_and_ps(validY, ratioY), _mm_andnot_ps(validY, one));
+        ratioZ = _mm_or_ps(_mm_and_ps(validZ, ratioZ), _mm_andnot_ps(validZ, one));
+        _mm_storeu_ps(&result.scaleX[i], _mm_mul_ps(_mm_loadu_ps(&base.scaleX[i]), lerp4(one, ratioX, w)));
+        _mm_storeu_ps(&result.scaleY[i], _mm_mul_ps(_mm_loadu_ps(&base.scaleY[i]), lerp4(one, ratioY, w)));
+        _mm_storeu_ps(&result.scaleZ[i], _mm_mul_ps(_mm_loadu_ps(&base.scaleZ[i]), lerp4(one, ratioZ, w)));
+
+        // Rotation: delta = conjugate(reference) * additive
+        __m128 rx = _mm_xor_ps(_mm_loadu_ps(&reference.rotationX[i]), signBit);
+        __m128 ry = _mm_xor_ps(_mm_loadu_ps(&reference.rotationY[i]), signBit);
+        __m128 rz = _mm_xor_ps(_mm_loadu_ps(&reference.rotationZ[i]), signBit);
+        __m128 rw = _mm_loadu_ps(&reference.rotationW[i]);
+        __m128 ax = _mm_loadu_ps(&additive.rotationX[i]);
+        __m128 ay = _mm_loadu_ps(&additive.rotationY[i]);
+        __m128 az = _mm_loadu_ps(&additive.rotationZ[i]);
+        __m128 aw = _mm_loadu_ps(&additive.rotationW[i]);
+
+        __m128 dw = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(rw, aw), _mm_mul_ps(rx, ax)), _mm_add_ps(_mm_mul_ps(ry, ay), _mm_mul_ps(rz, az)));
+        __m128 dx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rw, ax), _mm_mul_ps(rx, aw)), _mm_sub_ps(_mm_mul_ps(ry, az), _mm_mul_ps(rz, ay)));
+        __m128 dy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, ay), _mm_mul_ps(rx, az)), _mm_add_ps(_mm_mul_ps(ry, aw), _mm_mul_ps(rz, ax)));
+        __m128 dz = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(rw, az), _mm_mul_ps(rx, ay)), _mm_mul_ps(ry, ax)), _mm_mul_ps(rz, aw));
+
+        // Scale the delta by weight, nlerp from identity along the shortest path
+        __m128 flip = _mm_and_ps(_mm_cmplt_ps(dw, zero), signBit);
+        __m128 deltaWeight = _mm_xor_ps(w, flip);
+        dx = _mm_mul_ps(dx, deltaWeight);
+        dy = _mm_mul_ps(dy, deltaWeight);
+        dz = _mm_mul_ps(dz, deltaWeight);
+        dw = _mm_add_ps(_mm_sub_ps(one, w), _mm_mul_ps(dw, deltaWeight));
+        normalize4(dx, dy, dz, dw);
+
+        // result = base * delta
+        __m128 bx = _mm_loadu_ps(&base.rotationX[i]);
+        __m128 by = _mm_loadu_ps(&base.rotationY[i]);
+        __m128 bz = _mm_loadu_ps(&base.rotationZ[i]);
+        __m128 bw = _mm_loadu_ps(&base.rotationW[i]);
+
+        __m128 qw = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(bw, dw), _mm_mul_ps(bx, dx)), _mm_add_ps(_mm_mul_ps(by, dy), _mm_mul_ps(bz, dz)));
+        __m128 qx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bw, dx), _mm_mul_ps(bx, dw)), _mm_sub_ps(_mm_mul_ps(by, dz), _mm_mul_ps(bz, dy)));
+        __m128 qy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(bw, dy), _mm_mul_ps(bx, dz)), _mm_add_ps(_mm_mul_ps(by, dw), _mm_mul_ps(bz, dx)));
+        __m128 qz = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(bw, dz), _mm_mul_ps(bx, dy)), _mm_mul_ps(by, dx)), _mm_mul_ps(bz, dw));
+        normalize4(qx, qy, qz, qw);
+
+        _mm_storeu_ps(&result.rotationX[i], qx);
+        _mm_storeu_ps(&result.rotationY[i], qy);
+        _mm_storeu_ps(&result.rotationZ[i], qz);
+        _mm_storeu_ps(&result.rotationW[i], qw);
+    }
+}
+
+#endif
+
+static inline float lerp(float from, float to, float weight) {
+    return from + (to - from) * weight;
+}
+
+static inline void normalize(float &x, float &y, float &z, float &w) {
+    float length = std::sqrt(x * x + y * y + z * z + w * w);
+    x /= length;
+    y /= length;
+    z /= length;
+    w /= length;
+}
+
+void Pose::blendScalar(const Pose &from, const Pose &to, float weight, Pose &result) {
+    requireSameSize(from, to);
+    result.resize(from.size());
+    size_t size = from.paddedSize();
+
+    for (size_t i = 0; i < size; i++) {
+        result.translationX[i] = lerp(from.translationX[i], to.translationX[i], weight);
+        result.translationY[i] = lerp(from.translationY[i], to.translationY[i], weight);
+        result.translationZ[i] = lerp(from.translationZ[i], to.translationZ[i], weight);
+        result.scaleX[i] = lerp(from.scaleX[i], to.scaleX[i], weight);
+        result.scaleY[i] = lerp(from.scaleY[i], to.scaleY[i], weight);
+        result.scaleZ[i] = lerp(from.scaleZ[i], to.scaleZ[i], weight);
+
+        float dot = from.rotationX[i] * to.rotationX[i] + from.rotationY[i] * to.rotationY[i]
+                  + from.rotationZ[i] * to.rotationZ[i] + from.rotationW[i] * to.rotationW[i];
+        float toWeight = dot < 0.0f ? -weight : weight;
+
+        float x = from.rotationX[i] * (1.0f - weight) + to.rotationX[i] * toWeight;
+        float y = from.rotationY[i] * (1.0f - weight) + to.rotationY[i] * toWeight;
+        float z = from.rotationZ[i] * (1.0f - weight) + to.rotationZ[i] * toWeight;
+        float w = from.rotationW[i] * (1.0f - weight) + to.rotationW[i] * toWeight;
+        normalize(x, y, z, w);
+
+        result.rotationX[i] = x;
+        result.rotationY[i] = y;
+        result.rotationZ[i] = z;
+        result.rotationW[i] = w;
+    }
+}
+
+void Pose::addAdditiveScalar(const Pose &base, const Pose &additive, const Pose &reference, float weight,
+                             Pose &result) {
+    requireSameSize(base, additive);
+    requireSameSize(base, reference);
+    result.resize(base.size());
+    size_t size = base.paddedSize();
+
+    for (size_t i = 0; i < size; i++) {
+        result.translationX[i] = base.translationX[i] + (additive.translationX[i] - reference.translationX[i]) * weight;
+        result.translationY[i] = base.translationY[i] + (additive.translationY[i] - reference.translationY[i]) * weight;
+        result.translationZ[i] = base.translationZ[i] + (additive.translationZ[i] - reference.translationZ[i]) * weight;
+
+        float ratioX = reference.scaleX[i] != 0.0f ? additive.scaleX[i] / reference.scaleX[i] : 1.0f;
+        float ratioY = reference.scaleY[i] != 0.0f ? additive.scaleY[i] / reference.scaleY[i] : 1.0f;
+        float ratioZ = reference.scaleZ[i] != 0.0f ? additive.scaleZ[i] / reference.scaleZ[i] : 1.0f;
+        result.scaleX[i] = base.scaleX[i] * lerp(1.0f, ratioX, weight);
+        result.scaleY[i] = base.scaleY[i] * lerp(1.0f, ratioY, weight);
+        result.scaleZ[i] = base.scaleZ[i] * lerp(1.0f, ratioZ, weight);
+
+        // delta = conjugate(reference) * additive
+        float rx = -reference.rotationX[i], ry = -reference.rotationY[i], rz = -reference.rotationZ[i];
+        float rw = reference.rotationW[i];
+        float ax = additive.rotationX[i], ay = additive.rotationY[i], az = additive.rotationZ[i];
+        float aw = additive.rotationW[i];
+
+        float dw = rw * aw - rx * ax - ry * ay - rz * az;
+        float dx = rw * ax + rx * aw + ry * az - rz * ay;
+        float dy = rw * ay - rx * az + ry * aw + rz * ax;
+        float dz = rw * az + rx * ay - ry * ax + rz * aw;
+
+        // Scale the delta by weight, nlerp from identity along the shortest path
+        float deltaWeight = dw < 0.0f ? -weight : weight;
+        dx *= deltaWeight;
+        dy *= deltaWeight;
+        dz *= deltaWeight;
+        dw = (1.0f - weight) + dw * deltaWeight;
+        normalize(dx, dy, dz, dw);
+
+        // result = base * delta
+        float bx = base.rotationX[i], by = base.rotationY[i], bz = base.rotationZ[i], bw = base.rotationW[i];
+        float qw = bw * dw - bx * dx - by * dy - bz * dz;
+        float qx = bw * dx + bx * dw + by * dz - bz * dy;
+        float qy = bw * dy - bx * dz + by * dw + bz * dx;
+        float qz = bw * dz + bx * dy - by * dx + bz * dw;
+        normalize(qx, qy, qz, qw);
+
+        result.rotationX[i] = qx;
+        result.rotationY[i] = qy;
+        result.rotationZ[i] = qz;
+        result.rotationW[i] = qw;
+    }
+}
+
+
+void Pose::blend(const Pose &from, const Pose &to, float weight, Pose &result) {
+#ifdef POSE_USE_SSE
+    requireSameSize(from, to);
+    blendSse(from, to, weight, result);
+#else
+    blendScalar(from, to, weight, result);
+#endif
+}
+
+void Pose::addAdditive(const Pose &base, const Pose &additive, const Pose &reference, float weight, Pose &result) {
+#ifdef POSE_USE_SSE
+    requireSameSize(base, additive);
+    requireSameSize(base, reference);
+    addAdditiveSse(base, additive, reference, weight, result);
+#else
+    addAdditiveScalar(base, additive, reference, weight, result);
+#endif
+}
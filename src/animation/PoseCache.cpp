@@ -0,0 +1,74 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "PoseCache.h"
+#include <cmath>
+
+PoseCache::PoseCache() : timeQuantisation(0.0f) {
+}
+
+void PoseCache::setTimeQuantisation(float seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    timeQuantisation = seconds > 0.0f ? seconds : 0.0f;
+    poses.clear();
+}
+
+float PoseCache::getTimeQuantisation() const {
+    return timeQuantisation;
+}
+
+float PoseCache::quantise(float timeInSeconds, float durationInSeconds, long long &step) const {
+    const float timeQuantisation = this->timeQuantisation;
+    if (timeQuantisation == 0.0f) {
+        step = 0;
+        return timeInSeconds;
+    }
+
+    step = llround(timeInSeconds / timeQuantisation);
+    // Rounding up past the end would wrap a looping clip back to its start
+    if (durationInSeconds > 0.0f && step * timeQuantisation > durationInSeconds) {
+        step = (long long)floor(durationInSeconds / timeQuantisation);
+    }
+    return step * timeQuantisation;
+}
+
+std::shared_ptr<const std::vector<chag::float4x4>> PoseCache::find(int clipIndex, bool loop, long long step) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key = { clipIndex, loop, step };
+    auto it = poses.find(key);
+    if (it == poses.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+std::shared_ptr<const std::vector<chag::float4x4>> PoseCache::insert(int clipIndex, bool loop, long long step,
+                                                                     std::shared_ptr<const std::vector<chag::float4x4>> boneTransforms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key = { clipIndex, loop, step };
+    // Keeps the pose of another thread that evaluated it first
+    return poses.insert(std::make_pair(key, boneTransforms)).first->second;
+}
+
+void PoseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    poses.clear();
+}
+
+size_t PoseCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return poses.size();
+}
@@ -0,0 +1,95 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "linmath/float4x4.h"
+
+/**
+ * \brief Shares evaluated bone transforms between instances of a skeleton within a frame.
+ *
+ * Crowds often play the same clip at nearly the same time. Once a time
+ * quantisation is set, instances that play a clip alone (no crossfade or
+ * additive layers) snap their time to its grid and look their pose up
+ * here by clip and step, so every distinct pose is evaluated once per
+ * frame no matter how many instances show it. They then all read the same
+ * palette. A coarser grid shares more poses at the cost of choppier
+ * playback. Without a quantisation, the default, the cache is not used.
+ *
+ * The AnimationStage clears the cache before evaluating each frame, so it
+ * never holds more than the poses of one frame.
+ *
+ * Instances are evaluated in parallel, so every access is locked. The lock
+ * only guards the map, palettes are immutable once inserted. Two threads
+ * may both evaluate a missing pose, the first one inserted is kept.
+ */
+class PoseCache {
+public:
+    PoseCache();
+
+    void setTimeQuantisation(float seconds);
+    float getTimeQuantisation() const;
+
+    /**
+     * Snaps a time to the quantisation grid, never past the end of the clip.
+     * Only meaningful with a quantisation set.
+     *
+     * @param durationInSeconds The duration of the clip, or zero if unknown
+     * @param step Receives the key of the time, for find and insert
+     * @return The time to evaluate the pose at
+     */
+    float quantise(float timeInSeconds, float durationInSeconds, long long &step) const;
+
+    /**
+     * @return The cached bone transforms of a pose, null if not evaluated yet
+     */
+    std::shared_ptr<const std::vector<chag::float4x4>> find(int clipIndex, bool loop, long long step) const;
+
+    /**
+     * @return The palette now cached for the pose, another thread's if it got there first
+     */
+    std::shared_ptr<const std::vector<chag::float4x4>> insert(int clipIndex, bool loop, long long step,
+                                                              std::shared_ptr<const std::vector<chag::float4x4>> boneTransforms);
+
+    void clear();
+    size_t size() const;
+
+private:
+    struct Key {
+        int clipIndex;
+        bool loop;
+        long long step;
+
+        bool operator==(const Key &other) const {
+            return clipIndex == other.clipIndex && loop == other.loop && step == other.step;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<long long>()(key.step) ^ (std::hash<int>()(key.clipIndex) << 1) ^ (size_t)key.loop;
+        }
+    };
+
+    mutable std::mutex mutex;
+    std::atomic<float> timeQuantisation;
+    std::unordered_map<Key, std::shared_ptr<const std::vector<chag::float4x4>>, KeyHash> poses;
+};
@@ -17,6 +17,7 @@
 
 #include "Triangle.h"
 #include "Octree.h"
+#include <cfloat>
 
 #define DEFAULT_ORIGIN chag::make_vector(0.0f, 0.0f, 0.0f)
 #define DEFAULT_HALFVECTOR chag::make_vector(1.0f, 1.0f, 1.0f)
@@ -29,7 +30,11 @@ Octree::Octree() {
 }
 
 Octree::~Octree() {
-
+    if (hasChildren()) {
+        for (int i = 0; i < 8; i++) {
+            delete children[i];
+        }
+    }
 }
 
 Octree::Octree(chag::float3 origin, chag::float3 halfVector)
@@ -121,6 +126,48 @@ void Octree::createChildren() {
     }
 }
 
+void Octree::refit() {
+    if (!refitRecursively()) {
+        // Nothing to collide with, shrink to a point so the AABB is still valid
+        aabb.minV = origin;
+        aabb.maxV = origin;
+    }
+}
+
+bool Octree::refitRecursively() {
+    bool hasContent = false;
+    chag::float3 minV = chag::make_vector(FLT_MAX, FLT_MAX, FLT_MAX);
+    chag::float3 maxV = chag::make_vector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (Triangle *t : ts) {
+        BoundingBox *boundingBox = t->getBoundingBox();
+        // points[0] holds the maximum and points[7] the minimum of the box
+        minV = combineTwoPointsByComparator(minV, boundingBox->points[7], [](float p1, float p2) { return p1 < p2; });
+        maxV = combineTwoPointsByComparator(maxV, boundingBox->points[0], [](float p1, float p2) { return p1 > p2; });
+        hasContent = true;
+    }
+
+    if (hasChildren()) {
+        for (int i = 0; i < 8; i++) {
+            if (children[i]->refitRecursively()) {
+                AABB *childAabb = children[i]->getAABB();
+                minV = combineTwoPointsByComparator(minV, childAabb->minV, [](float p1, float p2) { return p1 < p2; });
+                maxV = combineTwoPointsByComparator(maxV, childAabb->maxV, [](float p1, float p2) { return p1 > p2; });
+                hasContent = true;
+            } else {
+                children[i]->getAABB()->minV = children[i]->origin;
+                children[i]->getAABB()->maxV = children[i]->origin;
+            }
+        }
+    }
+
+    if (hasContent) {
+        aabb.minV = minV;
+        aabb.maxV = maxV;
+    }
+    return hasContent;
+}
+
 bool Octree::hasChildren() {
     return *children != NULL;
 }
@@ -208,8 +255,9 @@ bool testSlab(float rayO, float rayD, float minV, float maxV, float *tNear, floa
 
 
 bool Octree::rayCastIntersectsAABB(chag::float3 rayOrigin, chag::float3 rayVector) {
-    chag::float3 maxCorner = chag::make_vector(origin.x + halfVector.x, origin.y + halfVector.y, origin.z + halfVector.z);
-    chag::float3 minCorner = chag::make_vector(origin.x - halfVector.x, origin.y - halfVector.y, origin.z - halfVector.z);
+    // The AABB is the cube of the level, unless the Octree has been refitted
+    chag::float3 maxCorner = aabb.maxV;
+    chag::float3 minCorner = aabb.minV;
 
     float tNear = -FLT_MAX, tFar = FLT_MAX;
 
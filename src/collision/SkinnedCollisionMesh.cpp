@@ -0,0 +1,132 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "SkinnedCollisionMesh.h"
+#include "Mesh.h"
+#include "Octree.h"
+#include "Triangle.h"
+#include "objects/Chunk.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SKINNING_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+SkinnedCollisionMesh::SkinnedCollisionMesh(Mesh *mesh) {
+    for (Chunk &chunk : *mesh->getChunks()) {
+        unsigned int firstVertex = (unsigned int)bindPosePositions.size();
+
+        bindPosePositions.insert(bindPosePositions.end(), chunk.m_positions.begin(), chunk.m_positions.end());
+        if (chunk.bones.size() == chunk.m_positions.size()) {
+            influences.insert(influences.end(), chunk.bones.begin(), chunk.bones.end());
+        } else {
+            influences.resize(bindPosePositions.size());
+        }
+
+        // Same triangles, in the same order, as Mesh::createTriangles
+        for (unsigned int i = 0; i + 2 < chunk.m_indices.size(); i += 3) {
+            indices.push_back(firstVertex + chunk.m_indices[i + 0]);
+            indices.push_back(firstVertex + chunk.m_indices[i + 1]);
+            indices.push_back(firstVertex + chunk.m_indices[i + 2]);
+        }
+    }
+    skinnedPositions = bindPosePositions;
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        triangles.push_back(new Triangle(bindPosePositions[indices[i]], bindPosePositions[indices[i + 1]],
+                                         bindPosePositions[indices[i + 2]]));
+    }
+
+    AABB* aabb = mesh->getAABB();
+    chag::float3 halfVector = (aabb->maxV - aabb->minV) / 2;
+    chag::float3 origin = aabb->maxV - halfVector;
+    octree = new Octree(origin, halfVector);
+    octree->insertAll(triangles);
+}
+
+SkinnedCollisionMesh::~SkinnedCollisionMesh() {
+    delete octree;
+    for (Triangle *triangle : triangles) {
+        delete triangle;
+    }
+}
+
+Octree* SkinnedCollisionMesh::getOctree() {
+    return octree;
+}
+
+void SkinnedCollisionMesh::update(const std::vector<chag::float4x4> &boneTransforms) {
+    skinPositions(bindPosePositions, influences, boneTransforms, skinnedPositions);
+
+    for (size_t i = 0; i < triangles.size(); i++) {
+        triangles[i]->setPoints(skinnedPositions[indices[i * 3]], skinnedPositions[indices[i * 3 + 1]],
+                                skinnedPositions[indices[i * 3 + 2]]);
+    }
+    octree->refit();
+}
+
+void SkinnedCollisionMesh::skinPositions(const std::vector<chag::float3> &positions,
+                                         const std::vector<BoneInfluenceOnVertex> &influences,
+                                         const std::vector<chag::float4x4> &boneTransforms,
+                                         std::vector<chag::float3> &skinnedPositions) {
+    skinnedPositions.resize(positions.size());
+
+    for (size_t vertex = 0; vertex < positions.size(); vertex++) {
+        const BoneInfluenceOnVertex &influence = influences[vertex];
+        const chag::float3 &position = positions[vertex];
+
+        // addBoneData fills the first slot first, so this is a vertex without bones
+        if (influence.weights[0] == 0.0f) {
+            skinnedPositions[vertex] = position;
+            continue;
+        }
+
+#ifdef SKINNING_USE_SSE
+        __m128 c1 = _mm_setzero_ps();
+        __m128 c2 = _mm_setzero_ps();
+        __m128 c3 = _mm_setzero_ps();
+        __m128 c4 = _mm_setzero_ps();
+        for (int i = 0; i < MAX_NUM_BONES; i++) {
+            if (influence.weights[i] == 0.0f) {
+                continue;
+            }
+            const chag::float4x4 &bone = boneTransforms[influence.ids[i]];
+            __m128 weight = _mm_set1_ps(influence.weights[i]);
+            c1 = _mm_add_ps(c1, _mm_mul_ps(weight, _mm_loadu_ps(&bone.c1.x)));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(weight, _mm_loadu_ps(&bone.c2.x)));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(weight, _mm_loadu_ps(&bone.c3.x)));
+            c4 = _mm_add_ps(c4, _mm_mul_ps(weight, _mm_loadu_ps(&bone.c4.x)));
+        }
+
+        __m128 skinned = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c1, _mm_set1_ps(position.x)),
+                                               _mm_mul_ps(c2, _mm_set1_ps(position.y))),
+                                    _mm_add_ps(_mm_mul_ps(c3, _mm_set1_ps(position.z)), c4));
+        float result[4];
+        _mm_storeu_ps(result, skinned);
+        skinnedPositions[vertex] = chag::make_vector(result[0], result[1], result[2]);
+#else
+        chag::float4 skinned = chag::make_vector(0.0f, 0.0f, 0.0f, 0.0f);
+        chag::float4 homogeneousPosition = chag::make_vector(position.x, position.y, position.z, 1.0f);
+        for (int i = 0; i < MAX_NUM_BONES; i++) {
+            if (influence.weights[i] == 0.0f) {
+                continue;
+            }
+            skinned = skinned + (boneTransforms[influence.ids[i]] * homogeneousPosition) * influence.weights[i];
+        }
+        skinnedPositions[vertex] = chag::make_vector(skinned.x, skinned.y, skinned.z);
+#endif
+    }
+}
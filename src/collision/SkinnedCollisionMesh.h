@@ -0,0 +1,74 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4x4.h"
+#include "objects/BoneInfluenceOnVertex.h"
+
+class Mesh;
+class Octree;
+class Triangle;
+
+/**
+ * \brief The collision triangles of one animated object, following its pose.
+ *
+ * A Mesh only has triangles in its bind pose, shared by every object using
+ * it. This keeps a copy of the triangles for a single object and skins them
+ * on the CPU with the same bone palette and four bone influences per vertex
+ * as the vertex shader. The Octree is built once from the bind pose and
+ * only refitted as the triangles move.
+ */
+class SkinnedCollisionMesh {
+public:
+    /**
+     * @param mesh An animated mesh, drawn with the skeleton whose palettes are passed to update
+     */
+    SkinnedCollisionMesh(Mesh *mesh);
+    ~SkinnedCollisionMesh();
+
+    /**
+     * Skins the triangles with the bone palette and refits the Octree around them.
+     */
+    void update(const std::vector<chag::float4x4> &boneTransforms);
+
+    /**
+     * NOTE: The octree has not been transformed by the model matrix.
+     */
+    Octree* getOctree();
+
+    /**
+     * Applies the weighted bone transforms to the positions, with SSE when available.
+     * Vertices without any bone influence keep their position.
+     */
+    static void skinPositions(const std::vector<chag::float3> &positions,
+                              const std::vector<BoneInfluenceOnVertex> &influences,
+                              const std::vector<chag::float4x4> &boneTransforms,
+                              std::vector<chag::float3> &skinnedPositions);
+
+private:
+    // The positions and influences of all chunks, one after another
+    std::vector<chag::float3> bindPosePositions;
+    std::vector<BoneInfluenceOnVertex> influences;
+    std::vector<chag::float3> skinnedPositions;
+
+    // The three vertices of each triangle
+    std::vector<unsigned int> indices;
+    std::vector<Triangle*> triangles;
+    Octree *octree;
+};
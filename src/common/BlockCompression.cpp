@@ -0,0 +1,410 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "BlockCompression.h"
+#include <JobSystem.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+namespace {
+
+// Weight of the second end point for each BC1 index in four color mode
+const float COLOR_INDEX_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+/**
+ * Copies a 4x4 block of texels, repeating the last row and column past the edges.
+ */
+void readBlock(const unsigned char *rgba, int width, int height, int blockX, int blockY, unsigned char *block) {
+    for (int y = 0; y < 4; y++) {
+        int sourceY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sourceY * width + sourceX) * 4], 4);
+        }
+    }
+}
+
+void writeBlock(const unsigned char *block, int width, int height, int blockX, int blockY, unsigned char *rgba) {
+    for (int y = 0; y < 4 && blockY * 4 + y < height; y++) {
+        for (int x = 0; x < 4 && blockX * 4 + x < width; x++) {
+            memcpy(&rgba[((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+        }
+    }
+}
+
+uint16_t packColor(const float *color) {
+    int r = std::max(0, std::min(31, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::max(0, std::min(63, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::max(0, std::min(31, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpackColor(uint16_t packed, int *color) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+/**
+ * The colors a BC1 block can pick from. The three color mode, used when
+ * the end points are not in descending order, has black as its fourth.
+ */
+void getColorPalette(uint16_t color0, uint16_t color1, bool fourColors, int palette[4][3]) {
+    unpackColor(color0, palette[0]);
+    unpackColor(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (fourColors) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+/**
+ * Encodes the block with the given end points in four color mode.
+ *
+ * @return The squared error of the block
+ */
+int encodeColors(const unsigned char *block, uint16_t color0, uint16_t color1, unsigned char *out) {
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    int error = 0;
+    int palette[4][3];
+    getColorPalette(color0, color1, true, palette);
+    // Equal end points make every entry the same, leaving the indices at zero
+    if (color0 != color1) {
+        for (int i = 0; i < 16; i++) {
+            int bestIndex = 0;
+            int bestError = 0;
+            for (int index = 0; index < 4; index++) {
+                int indexError = 0;
+                for (int c = 0; c < 3; c++) {
+                    int difference = block[i * 4 + c] - palette[index][c];
+                    indexError += difference * difference;
+                }
+                if (index == 0 || indexError < bestError) {
+                    bestIndex = index;
+                    bestError = indexError;
+                }
+            }
+            indices |= (uint32_t)bestIndex << (i * 2);
+            error += bestError;
+        }
+    } else {
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 3; c++) {
+                int difference = block[i * 4 + c] - palette[0][c];
+                error += difference * difference;
+            }
+        }
+    }
+
+    out[0] = (unsigned char)(color0 & 0xff);
+    out[1] = (unsigned char)(color0 >> 8);
+    out[2] = (unsigned char)(color1 & 0xff);
+    out[3] = (unsigned char)(color1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+    }
+    return error;
+}
+
+/**
+ * The end points that best fit the block for the indices it was encoded
+ * with, by least squares. False if the indices do not span a line.
+ */
+bool fitColorEndPoints(const unsigned char *block, const unsigned char *encoded, float *endPoint0, float *endPoint1) {
+    uint32_t indices = (uint32_t)encoded[4] | ((uint32_t)encoded[5] << 8) |
+                       ((uint32_t)encoded[6] << 16) | ((uint32_t)encoded[7] << 24);
+
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int i = 0; i < 16; i++) {
+        float b = COLOR_INDEX_WEIGHTS[(indices >> (i * 2)) & 3];
+        float a = 1.0f - b;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += a * block[i * 4 + c];
+            bx[c] += b * block[i * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        endPoint0[c] = std::max(0.0f, std::min(255.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+        endPoint1[c] = std::max(0.0f, std::min(255.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+    }
+    return true;
+}
+
+void compressColorBlock(const unsigned char *block, unsigned char *out) {
+    float mean[3] = {};
+    float minimum[3] = {255.0f, 255.0f, 255.0f};
+    float maximum[3] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            mean[c] += block[i * 4 + c] / 16.0f;
+            minimum[c] = std::min(minimum[c], (float)block[i * 4 + c]);
+            maximum[c] = std::max(maximum[c], (float)block[i * 4 + c]);
+        }
+    }
+
+    float covariance[3][3] = {};
+    for (int i = 0; i < 16; i++) {
+        float centered[3];
+        for (int c = 0; c < 3; c++) {
+            centered[c] = block[i * 4 + c] - mean[c];
+        }
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                covariance[row][column] += centered[row] * centered[column];
+            }
+        }
+    }
+
+    // The principal axis by power iteration, starting along the bounding box diagonal
+    float axis[3];
+    for (int c = 0; c < 3; c++) {
+        axis[c] = maximum[c] - minimum[c];
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[3];
+        float largest = 0.0f;
+        for (int row = 0; row < 3; row++) {
+            next[row] = covariance[row][0] * axis[0] + covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+            largest = std::max(largest, fabsf(next[row]));
+        }
+        if (largest == 0.0f) {
+            break;
+        }
+        for (int c = 0; c < 3; c++) {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    // The texels furthest apart along the axis, moved slightly inwards
+    // since the end points are rarely hit exactly
+    int minimumTexel = 0;
+    int maximumTexel = 0;
+    float minimumProjection = 0.0f;
+    float maximumProjection = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float projection = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            projection += (block[i * 4 + c] - mean[c]) * axis[c];
+        }
+        if (i == 0 || projection < minimumProjection) {
+            minimumProjection = projection;
+            minimumTexel = i;
+        }
+        if (i == 0 || projection > maximumProjection) {
+            maximumProjection = projection;
+            maximumTexel = i;
+        }
+    }
+    float endPoint0[3];
+    float endPoint1[3];
+    for (int c = 0; c < 3; c++) {
+        float inset = (block[maximumTexel * 4 + c] - block[minimumTexel * 4 + c]) / 16.0f;
+        endPoint0[c] = block[maximumTexel * 4 + c] - inset;
+        endPoint1[c] = block[minimumTexel * 4 + c] + inset;
+    }
+
+    int error = encodeColors(block, packColor(endPoint0), packColor(endPoint1), out);
+    for (int iteration = 0; iteration < 2 && error > 0; iteration++) {
+        if (!fitColorEndPoints(block, out, endPoint0, endPoint1)) {
+            break;
+        }
+        unsigned char refined[8];
+        int refinedError = encodeColors(block, packColor(endPoint0), packColor(endPoint1), refined);
+        if (refinedError >= error) {
+            break;
+        }
+        memcpy(out, refined, 8);
+        error = refinedError;
+    }
+}
+
+void decompressColorBlock(const unsigned char *in, bool alwaysFourColors, unsigned char *block) {
+    uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8));
+    uint16_t color1 = (uint16_t)(in[2] | (in[3] << 8));
+    bool fourColors = alwaysFourColors || color0 > color1;
+    int palette[4][3];
+    getColorPalette(color0, color1, fourColors, palette);
+
+    for (int i = 0; i < 16; i++) {
+        int index = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        for (int c = 0; c < 3; c++) {
+            block[i * 4 + c] = (unsigned char)palette[index][c];
+        }
+        block[i * 4 + 3] = (!fourColors && index == 3) ? 0 : 255;
+    }
+}
+
+/**
+ * The values an interpolated single channel block, as in BC3 alpha, BC4 and
+ * BC5, can pick from. Six interpolated values plus zero and 255 are used
+ * when the end points are not in descending order.
+ */
+void getChannelPalette(int value0, int value1, int palette[8]) {
+    palette[0] = value0;
+    palette[1] = value1;
+    if (value0 > value1) {
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+        }
+    } else {
+        for (int i = 2; i < 6; i++) {
+            palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+/**
+ * Encodes one channel of the block, every fourth byte starting at values.
+ */
+void compressChannelBlock(const unsigned char *values, unsigned char *out) {
+    int minimum = 255;
+    int maximum = 0;
+    for (int i = 0; i < 16; i++) {
+        minimum = std::min(minimum, (int)values[i * 4]);
+        maximum = std::max(maximum, (int)values[i * 4]);
+    }
+
+    int palette[8];
+    getChannelPalette(maximum, minimum, palette);
+
+    uint64_t indices = 0;
+    if (maximum != minimum) {
+        for (int i = 0; i < 16; i++) {
+            int bestIndex = 0;
+            for (int index = 1; index < 8; index++) {
+                if (abs(values[i * 4] - palette[index]) < abs(values[i * 4] - palette[bestIndex])) {
+                    bestIndex = index;
+                }
+            }
+            indices |= (uint64_t)bestIndex << (i * 3);
+        }
+    }
+
+    out[0] = (unsigned char)maximum;
+    out[1] = (unsigned char)minimum;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+    }
+}
+
+void decompressChannelBlock(const unsigned char *in, unsigned char *values) {
+    int palette[8];
+    getChannelPalette(in[0], in[1], palette);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= (uint64_t)in[2 + i] << (i * 8);
+    }
+    for (int i = 0; i < 16; i++) {
+        values[i * 4] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+}
+
+size_t BlockCompression::getBlockSize(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t BlockCompression::getCompressedSize(BlockFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+void BlockCompression::compressImage(BlockFormat format, const unsigned char *rgba, int width, int height,
+                                     unsigned char *blocks) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockSize = getBlockSize(format);
+
+    JobSystem::parallelFor((size_t)blocksY, [&](size_t blockY) {
+        unsigned char block[16 * 4];
+        for (int blockX = 0; blockX < blocksX; blockX++) {
+            readBlock(rgba, width, height, blockX, (int)blockY, block);
+            unsigned char *out = &blocks[(blockY * blocksX + blockX) * blockSize];
+            switch (format) {
+                case BlockFormat::BC1:
+                    compressColorBlock(block, out);
+                    break;
+                case BlockFormat::BC3:
+                    compressChannelBlock(block + 3, out);
+                    compressColorBlock(block, out + 8);
+                    break;
+                case BlockFormat::BC5:
+                    compressChannelBlock(block, out);
+                    compressChannelBlock(block + 1, out + 8);
+                    break;
+            }
+        }
+    });
+}
+
+void BlockCompression::decompressImage(BlockFormat format, const unsigned char *blocks, int width, int height,
+                                       unsigned char *rgba) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockSize = getBlockSize(format);
+
+    JobSystem::parallelFor((size_t)blocksY, [&](size_t blockY) {
+        unsigned char block[16 * 4];
+        for (int blockX = 0; blockX < blocksX; blockX++) {
+            const unsigned char *in = &blocks[(blockY * blocksX + blockX) * blockSize];
+            switch (format) {
+                case BlockFormat::BC1:
+                    decompressColorBlock(in, false, block);
+                    break;
+                case BlockFormat::BC3:
+                    decompressColorBlock(in + 8, true, block);
+                    decompressChannelBlock(in, block + 3);
+                    break;
+                case BlockFormat::BC5:
+                    decompressChannelBlock(in, block);
+                    decompressChannelBlock(in + 8, block + 1);
+                    for (int i = 0; i < 16; i++) {
+                        block[i * 4 + 2] = 0;
+                        block[i * 4 + 3] = 255;
+                    }
+                    break;
+            }
+            writeBlock(block, width, height, blockX, (int)blockY, rgba);
+        }
+    });
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * The block compressed formats textures are cached in. Each stores 4x4
+ * texel blocks, of 8 bytes for BC1 and 16 bytes for BC3 and BC5.
+ */
+enum class BlockFormat {
+    // RGB at 4 bits per texel
+    BC1 = 1,
+    // RGBA, a BC1 color block and an interpolated alpha block
+    BC3 = 3,
+    // Two interpolated channels, red and green, for normal maps
+    BC5 = 5
+};
+
+/**
+ * \brief Software encoders and decoders for the S3TC and RGTC block formats.
+ *
+ * The colors of a block are fitted along their principal axis and the end
+ * points refined by least squares, which is close to what offline tools
+ * reach at a fraction of the time. No GPU is needed, so textures can be
+ * compressed by tools and on machines without the formats.
+ *
+ * Images are RGBA with four bytes per texel. Images whose sides are not
+ * multiples of four are padded by repeating their last row and column.
+ */
+class BlockCompression {
+public:
+    static size_t getBlockSize(BlockFormat format);
+
+    /**
+     * The size of a compressed image, in bytes.
+     */
+    static size_t getCompressedSize(BlockFormat format, int width, int height);
+
+    /**
+     * Compresses the image into getCompressedSize bytes of blocks, on the JobSystem.
+     */
+    static void compressImage(BlockFormat format, const unsigned char *rgba, int width, int height,
+                              unsigned char *blocks);
+
+    /**
+     * Decompresses the blocks back into an RGBA image. BC5 images get zero
+     * blue and opaque alpha.
+     */
+    static void decompressImage(BlockFormat format, const unsigned char *blocks, int width, int height,
+                                unsigned char *rgba);
+};
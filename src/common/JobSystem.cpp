@@ -0,0 +1,194 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Set on the workers, on a thread while it dispatches a parallelFor and on threads that asked to run serially
+    thread_local bool runSerially = false;
+
+    /**
+     * The workers and the work they share. Only one parallelFor is
+     * dispatched at a time, guarded by dispatchMutex, and every worker
+     * takes part in each of them.
+     */
+    class WorkerPool {
+    public:
+        ~WorkerPool() {
+            stop();
+        }
+
+        void start(unsigned int numberOfWorkers) {
+            stopping = false;
+            for (unsigned int i = 0; i < numberOfWorkers; i++) {
+                workers.push_back(std::thread(&WorkerPool::workerLoop, this, generation));
+            }
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            workAvailable.notify_all();
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+            workers.clear();
+        }
+
+        size_t getNumberOfWorkers() const {
+            return workers.size();
+        }
+
+        void run(size_t count, const std::function<void(size_t)> &job, size_t batchSize) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                currentJob = &job;
+                jobCount = count;
+                jobBatchSize = batchSize;
+                nextIndex = 0;
+                pendingWorkers = workers.size();
+                generation++;
+            }
+            workAvailable.notify_all();
+
+            runBatches();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            workDone.wait(lock, [this]() { return pendingWorkers == 0; });
+            currentJob = nullptr;
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+        bool stopping = false;
+
+        const std::function<void(size_t)> *currentJob = nullptr;
+        size_t jobCount = 0;
+        size_t jobBatchSize = 1;
+        std::atomic<size_t> nextIndex;
+        size_t pendingWorkers = 0;
+        unsigned long long generation = 0;
+
+        void runBatches() {
+            while (true) {
+                size_t begin = nextIndex.fetch_add(jobBatchSize);
+                if (begin >= jobCount) {
+                    return;
+                }
+                size_t end = std::min(begin + jobBatchSize, jobCount);
+                for (size_t i = begin; i < end; i++) {
+                    (*currentJob)(i);
+                }
+            }
+        }
+
+        void workerLoop(unsigned long long finishedGeneration) {
+            runSerially = true;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                workAvailable.wait(lock, [&]() { return stopping || generation != finishedGeneration; });
+                if (stopping) {
+                    return;
+                }
+                finishedGeneration = generation;
+
+                lock.unlock();
+                runBatches();
+                lock.lock();
+
+                if (--pendingWorkers == 0) {
+                    workDone.notify_one();
+                }
+            }
+        }
+    };
+
+    WorkerPool pool;
+    // Held for a whole dispatch, so that the pool is neither shared nor reconfigured while it runs
+    std::mutex dispatchMutex;
+    // Held only while reading or changing the configuration
+    std::mutex configurationMutex;
+    unsigned int requestedNumberOfThreads = 0;
+    bool poolStarted = false;
+
+    unsigned int resolveNumberOfThreads() {
+        if (requestedNumberOfThreads != 0) {
+            return requestedNumberOfThreads;
+        }
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads != 0 ? hardwareThreads : 1;
+    }
+}
+
+void JobSystem::setNumberOfThreads(unsigned int numberOfThreads) {
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
+    std::lock_guard<std::mutex> lock(configurationMutex);
+    requestedNumberOfThreads = numberOfThreads;
+    if (poolStarted) {
+        pool.stop();
+        poolStarted = false;
+    }
+}
+
+unsigned int JobSystem::getNumberOfThreads() {
+    std::lock_guard<std::mutex> lock(configurationMutex);
+    return resolveNumberOfThreads();
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)> &job, size_t batchSize) {
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+
+    if (!runSerially && count > batchSize) {
+        std::unique_lock<std::mutex> dispatchLock(dispatchMutex);
+        {
+            std::lock_guard<std::mutex> lock(configurationMutex);
+            if (!poolStarted) {
+                pool.start(resolveNumberOfThreads() - 1);
+                poolStarted = true;
+            }
+        }
+        if (pool.getNumberOfWorkers() > 0) {
+            // Jobs run on this thread too, and their own parallelFor calls must not dispatch again
+            runSerially = true;
+            pool.run(count, job, batchSize);
+            runSerially = false;
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        job(i);
+    }
+}
+
+void JobSystem::setRunSerially(bool serially) {
+    runSerially = serially;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "MappedFile.h"
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string &fileName) {
+    close();
+
+#ifdef _WIN32
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    contents.resize((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read(contents.data(), contents.size())) {
+        contents.clear();
+        return false;
+    }
+    data = contents.empty() ? "" : contents.data();
+    size = contents.size();
+#else
+    int fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+        ::close(fileDescriptor);
+        return false;
+    }
+    // Empty files can not be mapped
+    if (fileStatus.st_size == 0) {
+        ::close(fileDescriptor);
+        data = "";
+        return true;
+    }
+    void *mapping = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    // The mapping keeps the file alive on its own
+    ::close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char *>(mapping);
+    size = (size_t)fileStatus.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (size > 0) {
+        munmap(const_cast<char *>(data), size);
+    }
+#endif
+    contents.clear();
+    data = nullptr;
+    size = 0;
+}
+
+const char *MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+bool MappedFile::getFileStamp(const std::string &fileName, uint64_t &size, int64_t &modificationTime) {
+    struct stat fileStatus;
+    if (stat(fileName.c_str(), &fileStatus) != 0) {
+        return false;
+    }
+    size = (uint64_t)fileStatus.st_size;
+    modificationTime = (int64_t)fileStatus.st_mtime;
+    return true;
+}
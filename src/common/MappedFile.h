@@ -0,0 +1,75 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A read-only view of the contents of a file. The file is memory mapped
+ * where supported, so only the pages that are read are loaded from disk,
+ * and read into memory otherwise.
+ *
+ * \code
+ * MappedFile file;
+ * if (file.open("meshes/cube.obj.bmesh")) {
+ *     const char *data = file.getData();
+ * }
+ * \endcode
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+
+    /**
+     * Maps the file, closing the previously opened one.
+     *
+     * @return If the file could be opened
+     */
+    bool open(const std::string &fileName);
+
+    /**
+     * Unmaps the file, invalidating all pointers to its data.
+     */
+    void close();
+
+    /**
+     * The contents of the file, nullptr if no file is open.
+     */
+    const char *getData() const;
+    size_t getSize() const;
+
+    /**
+     * The size and modification time of a file on disk, which tell files
+     * derived from it when they are stale.
+     *
+     * @return False if the file does not exist
+     */
+    static bool getFileStamp(const std::string &fileName, uint64_t &size, int64_t &modificationTime);
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    // The contents of the file where it can not be mapped
+    std::vector<char> contents;
+};
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "Random.h"
+
+namespace {
+
+thread_local Random *currentRandom = nullptr;
+
+}
+
+Random::Random(uint64_t seed) {
+    this->seed(seed);
+}
+
+void Random::seed(uint64_t seed) {
+    // Expand the seed with splitmix64, which never yields the all zero state
+    for (int i = 0; i < 4; i += 2) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+
+        state[i]     = (uint32_t)z;
+        state[i + 1] = (uint32_t)(z >> 32);
+    }
+}
+
+chag::float3 Random::nextVector(float min, float max) {
+    float x = nextFloat(min, max);
+    float y = nextFloat(min, max);
+    float z = nextFloat(min, max);
+    return chag::make_vector(x, y, z);
+}
+
+void Random::fill(float *values, size_t count, float min, float max) {
+    const float range = max - min;
+    for (size_t i = 0; i < count; i++) {
+        values[i] = min + nextFloat() * range;
+    }
+}
+
+Random* Random::getCurrent() {
+    return currentRandom;
+}
+
+void Random::setCurrent(Random *random) {
+    currentRandom = random;
+}
@@ -19,6 +19,7 @@
 #include "Utils.h"
 #include "ShaderProgram.h"
 #include "GameObject.h"
+#include "Random.h"
 
 
 
@@ -52,6 +53,11 @@ float radToDegree(const float rad) {
 }
 
 float getRand(const float min, const float max) {
+    Random *random = Random::getCurrent();
+    if (random != nullptr) {
+        return random->nextFloat(min, max);
+    }
+
     //srand(time(NULL));
     const float range = max - min;
     return (((float) rand() / (float) RAND_MAX) * range) + min;
@@ -16,15 +16,20 @@
  */
 #include <GameObject.h>
 #include <ShaderProgram.h>
-#include <SFML/System/Clock.hpp>
 #include "StandardRenderer.h"
 #include "Mesh.h"
 #include "ShaderProgram.h"
 #include "objects/Chunk.h"
+#include "constants.h"
+#include "AnimationStage.h"
+#include "ResourceManager.h"
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-#define NORMAL_TEXTURE_LOCATION 3
-#define DIFFUSE_TEXTURE_LOCATION 0
+// Must match MAX_NUM_BONES in simple.vert and emissive.vert
+#define MAX_NUM_BONES_GPU 100
 
 StandardRenderer::StandardRenderer(){
 
@@ -34,22 +39,35 @@ StandardRenderer::StandardRenderer(std::shared_ptr<Mesh> mesh, GameObject* gameO
                                  : mesh(mesh), gameObject(gameObject)
 {
     this->shaderProgram = shaderProgram;
+    if (mesh->hasAnimations()) {
+        animationState = std::unique_ptr<AnimationState>(new AnimationState(mesh->getBoneTransformer()));
+    }
 }
 
 
 void StandardRenderer::update(float dt){
-    ;
+    if (animationState != nullptr) {
+        animationState->update(dt);
+    }
+    poseIsDirty = true;
+    collisionIsDirty = true;
+}
+
+AnimationState* StandardRenderer::getAnimationState() {
+    return animationState.get();
 }
 
 void StandardRenderer::render() {
     shaderProgram->use();
     CHECK_GL_ERROR();
+    resolveUniformHandles(shaderProgram, renderHandles);
 
     chag::float4x4 modelMatrix = gameObject->getModelMatrix();
 
     chag::float4x4 normalMatrix = chag::inverse(chag::transpose(modelMatrix));
-    shaderProgram->setUniformMatrix4fv("modelMatrix", modelMatrix);
-    shaderProgram->setUniformMatrix4fv("normalMatrix", normalMatrix);
+    shaderProgram->setUniformMatrix4fv(renderHandles.modelMatrix, modelMatrix);
+    shaderProgram->setUniformMatrix4fv(renderHandles.normalMatrix, normalMatrix);
+    setBones(shaderProgram, renderHandles);
 
     for (size_t i = 0; i < mesh->getChunks()->size(); i++) {
         CHECK_GL_ERROR();
@@ -57,30 +75,7 @@ void StandardRenderer::render() {
         Chunk &chunk = (*mesh->getChunks())[i];
         Material &material = (*mesh->getMaterials())[chunk.materialIndex];
 
-        if (material.diffuseTexture != NULL) {
-            shaderProgram->setUniform1i("diffuse_texture", DIFFUSE_TEXTURE_LOCATION);
-            material.diffuseTexture->bind(GL_TEXTURE0);
-        }
-        if (material.bumpMapTexture != NULL) {
-            shaderProgram->setUniform1i("normal_texture", NORMAL_TEXTURE_LOCATION);
-            material.bumpMapTexture->bind(GL_TEXTURE3);
-        }
-        if(material.emissiveTexture != NULL) {
-            shaderProgram->setUniform1i("emissive_texture", 4);
-            material.emissiveTexture->bind(GL_TEXTURE4);
-        }
-
-        setBones(shaderProgram);
-
-        shaderProgram->setUniform1i("has_diffuse_texture", material.diffuseTexture != NULL);
-        shaderProgram->setUniform1i("has_emissive_texture", material.emissiveTexture != NULL);
-        shaderProgram->setUniform3f("material_diffuse_color", material.diffuseColor);
-        shaderProgram->setUniform3f("material_diffuse_color", chag::make_vector(0.5f, 0.5f, 0.5f));
-        shaderProgram->setUniform3f("material_specular_color", material.specularColor);
-        shaderProgram->setUniform3f("material_ambient_color", material.ambientColor);
-        shaderProgram->setUniform3f("material_emissive_color", material.emissiveColor);
-        shaderProgram->setUniform1i("has_normal_texture", material.bumpMapTexture != NULL);
-        shaderProgram->setUniform1f("material_shininess", material.specularExponent);
+        material.bind();
         CHECK_GL_ERROR();
 
         glBindVertexArray(chunk.m_vaob);
@@ -92,24 +87,116 @@ void StandardRenderer::render() {
     CHECK_GL_ERROR();
 }
 
-void StandardRenderer::setBones(std::shared_ptr<ShaderProgram> &shaderProgram) const {
-    if(mesh->hasAnimations()) {
-        float currentTimeInSeconds = clock.getElapsedTime().asSeconds();
-        std::vector<chag::float4x4> boneTransforms = mesh->getBoneTransforms(currentTimeInSeconds);
-        shaderProgram->setUniform1i("has_animations", 1);
+void StandardRenderer::initShaderProgram(std::shared_ptr<ShaderProgram> &shaderProgram) {
+    shaderProgram->setUniformBufferObjectBinding(UNIFORM_BUFFER_OBJECT_MATRICES_NAME, UNIFORM_BUFFER_OBJECT_MATRICES_INDEX);
+    shaderProgram->setUniformBufferObjectBinding(UNIFORM_BUFFER_OBJECT_LIGHTS_NAME, UNIFORM_BUFFER_OBJECT_LIGHTS_INDEX);
+    shaderProgram->setUniformBufferObjectBinding(UNIFORM_BUFFER_OBJECT_MATERIAL_NAME, UNIFORM_BUFFER_OBJECT_MATERIAL_INDEX);
+
+    shaderProgram->setUniform1i("diffuse_texture", DIFFUSE_TEXTURE_LOCATION);
+    shaderProgram->setUniform1i("normal_texture", NORMAL_TEXTURE_LOCATION);
+    shaderProgram->setUniform1i("emissive_texture", EMISSIVE_TEXTURE_LOCATION);
+}
+
+void StandardRenderer::resolveUniformHandles(std::shared_ptr<ShaderProgram> &shaderProgram,
+                                             ObjectUniformHandles &handles) {
+    if (handles.shaderProgramGeneration == shaderProgram->getGeneration()) {
+        return;
+    }
+
+    initShaderProgram(shaderProgram);
+
+    handles.shaderProgramGeneration = shaderProgram->getGeneration();
+    handles.modelMatrix = shaderProgram->getUniformHandle("modelMatrix");
+    handles.normalMatrix = shaderProgram->getUniformHandle("normalMatrix");
+    handles.hasAnimations = shaderProgram->getUniformHandle("has_animations");
+    handles.bones = shaderProgram->getUniformHandle("bones");
+}
 
-        for (unsigned int j = 0; j < boneTransforms.size(); j++) {
-            shaderProgram->setUniformMatrix4fv("bones[" + std::to_string(j) + "]", boneTransforms[j]);
+Mesh* StandardRenderer::getInstanceableMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) {
+    if (shaderProgram != this->shaderProgram || mesh->hasAnimations()) {
+        return nullptr;
+    }
+    return mesh.get();
+}
+
+Mesh* StandardRenderer::getInstanceableShadowMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) {
+    if (mesh->hasAnimations()) {
+        return nullptr;
+    }
+    return mesh.get();
+}
+
+void StandardRenderer::addToAnimationStage(AnimationStage &animationStage, SkinnedCollisionMesh *collisionMesh) {
+    if (animationState == nullptr) {
+        return;
+    }
+    bool skinCollision = collisionMesh != nullptr && collisionIsDirty;
+    if (!poseIsDirty && !skinCollision) {
+        return;
+    }
+
+    // The pose may already have been evaluated by getBoneTransforms
+    animationStage.addInstance(animationState.get(), poseIsDirty, skinCollision ? collisionMesh : nullptr);
+    poseIsDirty = false;
+    if (skinCollision) {
+        collisionIsDirty = false;
+    }
+}
+
+const std::vector<chag::float4x4>* StandardRenderer::getBoneTransforms() {
+    if (animationState == nullptr) {
+        return nullptr;
+    }
+    updatePose();
+    return &animationState->getBoneTransforms();
+}
+
+void StandardRenderer::requestTextureSizes(const chag::float3 &cameraPosition, float pixelsPerUnit) {
+    Sphere sphere = gameObject->getTransformedSphere();
+    float distance = chag::length(sphere.getPosition() - cameraPosition);
+    float radius = sphere.getRadius();
+
+    // The projected diameter of the sphere, or as large as possible with the camera inside it
+    float size = std::numeric_limits<float>::max();
+    if (distance > radius) {
+        size = 2.0f * radius * pixelsPerUnit / sqrtf(distance * distance - radius * radius);
+    }
+
+    for (Material &material : *mesh->getMaterials()) {
+        ResourceManager::requestTextureSize(material.diffuseTexture.get(), size);
+        ResourceManager::requestTextureSize(material.bumpMapTexture.get(), size);
+        ResourceManager::requestTextureSize(material.emissiveTexture.get(), size);
+    }
+}
+
+void StandardRenderer::updatePose() {
+    if (!poseIsDirty) {
+        return;
+    }
+    animationState->evaluate();
+    poseIsDirty = false;
+}
+
+void StandardRenderer::setBones(std::shared_ptr<ShaderProgram> &shaderProgram, const ObjectUniformHandles &handles) {
+    if(animationState != nullptr) {
+        updatePose();
+        shaderProgram->setUniform1i(handles.hasAnimations, 1);
+
+        const std::vector<chag::float4x4> &boneTransforms = animationState->getBoneTransforms();
+        int count = std::min((int)boneTransforms.size(), MAX_NUM_BONES_GPU);
+        if (count > 0) {
+            shaderProgram->setUniformMatrix4fv(handles.bones, &boneTransforms[0], count);
         }
     } else {
-        shaderProgram->setUniform1i("has_animations", 0);
+        shaderProgram->setUniform1i(handles.hasAnimations, 0);
     }
 }
 
 void StandardRenderer::renderShadow(std::shared_ptr<ShaderProgram> &shaderProgram) {
+    resolveUniformHandles(shaderProgram, shadowHandles);
 
     chag::float4x4 modelMatrix = gameObject->getModelMatrix();
-    shaderProgram->setUniformMatrix4fv("modelMatrix", modelMatrix);
+    shaderProgram->setUniformMatrix4fv(shadowHandles.modelMatrix, modelMatrix);
 
     for (size_t i = 0; i < mesh->getChunks()->size(); i++) {
         CHECK_GL_ERROR();
@@ -129,10 +216,12 @@ void StandardRenderer::renderShadow(std::shared_ptr<ShaderProgram> &shaderProgra
 void StandardRenderer::renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram) {
     shaderProgram->use();
     CHECK_GL_ERROR();
+    resolveUniformHandles(shaderProgram, emissiveHandles);
 
     chag::float4x4 modelMatrix = gameObject->getModelMatrix();
 
-    shaderProgram->setUniformMatrix4fv("modelMatrix", modelMatrix);
+    shaderProgram->setUniformMatrix4fv(emissiveHandles.modelMatrix, modelMatrix);
+    setBones(shaderProgram, emissiveHandles);
 
     for (size_t i = 0; i < mesh->getChunks()->size(); i++) {
         CHECK_GL_ERROR();
@@ -140,15 +229,7 @@ void StandardRenderer::renderEmissive(std::shared_ptr<ShaderProgram> &shaderProg
         Chunk &chunk = (*mesh->getChunks())[i];
         Material &material = (*mesh->getMaterials())[chunk.materialIndex];
 
-        if (material.emissiveTexture != NULL) {
-            shaderProgram->setUniform1i("emissive_texture", 4);
-            material.emissiveTexture->bind(GL_TEXTURE4);
-        }
-
-        setBones(shaderProgram);
-
-        shaderProgram->setUniform1i("has_emissive_texture", material.emissiveTexture != NULL);
-        shaderProgram->setUniform3f("material_emissive_color", material.emissiveColor);
+        material.bind();
         CHECK_GL_ERROR();
 
         glBindVertexArray(chunk.m_vaob);
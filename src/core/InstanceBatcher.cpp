@@ -0,0 +1,156 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "InstanceBatcher.h"
+#include <cstddef>
+#include "glutil/glutil.h"
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include "objects/Chunk.h"
+
+InstanceBatcher::InstanceBatcher() {
+}
+
+InstanceBatcher::~InstanceBatcher() {
+    if (instanceBufferObject != 0) {
+        glDeleteBuffers(1, &instanceBufferObject);
+    }
+}
+
+void InstanceBatcher::clear() {
+    // Keep the batches, and their allocations, around since the same meshes
+    // are very likely to be drawn next frame as well.
+    for (Batch &batch : batches) {
+        batch.instances.clear();
+    }
+}
+
+void InstanceBatcher::addInstance(Mesh *mesh, float reflectiveness, const chag::float4x4 &modelMatrix) {
+    std::pair<Mesh*, float> key(mesh, reflectiveness);
+    std::map<std::pair<Mesh*, float>, size_t>::iterator it = batchIndices.find(key);
+
+    size_t batchIndex;
+    if (it == batchIndices.end()) {
+        Batch batch;
+        batch.mesh = mesh;
+        batch.reflectiveness = reflectiveness;
+        batchIndex = batches.size();
+        batches.push_back(batch);
+        batchIndices.insert(std::pair<std::pair<Mesh*, float>, size_t>(key, batchIndex));
+    } else {
+        batchIndex = it->second;
+    }
+
+    InstanceData instance;
+    instance.modelMatrix = modelMatrix;
+    instance.normalMatrix = chag::inverse(chag::transpose(modelMatrix));
+    batches[batchIndex].instances.push_back(instance);
+}
+
+void InstanceBatcher::render(std::shared_ptr<ShaderProgram> &shaderProgram, bool setMaterials) {
+    uploadInstances();
+    if (instanceBuffer.empty()) {
+        return;
+    }
+
+    shaderProgram->use();
+    CHECK_GL_ERROR();
+    UniformHandle reflectivenessHandle = shaderProgram->getUniformHandle("object_reflectiveness");
+
+    size_t firstInstance = 0;
+    for (Batch &batch : batches) {
+        if (batch.instances.empty()) {
+            continue;
+        }
+
+        shaderProgram->setUniform1f(reflectivenessHandle, batch.reflectiveness);
+
+        std::vector<Chunk> &chunks = *batch.mesh->getChunks();
+        for (size_t i = 0; i < chunks.size(); i++) {
+            Chunk &chunk = chunks[i];
+
+            if (setMaterials) {
+                (*batch.mesh->getMaterials())[chunk.materialIndex].bind();
+            }
+
+            glBindVertexArray(chunk.m_vaob);
+            bindInstanceAttributes(firstInstance);
+            glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, chunk.m_ind_bo);
+
+            glDrawElementsInstanced(GL_TRIANGLES, chunk.m_indices.size(), GL_UNSIGNED_INT, 0,
+                                    (GLsizei)batch.instances.size());
+            CHECK_GL_ERROR();
+            unbindInstanceAttributes();
+        }
+
+        firstInstance += batch.instances.size();
+    }
+
+    glBindVertexArray(0);
+}
+
+void InstanceBatcher::uploadInstances() {
+    instanceBuffer.clear();
+    for (Batch &batch : batches) {
+        instanceBuffer.insert(instanceBuffer.end(), batch.instances.begin(), batch.instances.end());
+    }
+
+    if (instanceBuffer.empty()) {
+        return;
+    }
+
+    if (instanceBufferObject == 0) {
+        glGenBuffers(1, &instanceBufferObject);
+    }
+
+    // Respecifying the whole store orphans last frames buffer, so the driver
+    // does not have to wait for draws still reading it.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, instanceBuffer.size() * sizeof(InstanceData), &instanceBuffer[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatcher::bindInstanceAttributes(size_t firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+
+    const size_t columnSize = sizeof(chag::float4);
+    size_t instanceOffset = firstInstance * sizeof(InstanceData);
+
+    for (GLuint column = 0; column < 4; column++) {
+        GLuint modelLocation = INSTANCE_MODEL_MATRIX_LOCATION_GPU + column;
+        glEnableVertexAttribArray(modelLocation);
+        glVertexAttribPointer(modelLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const GLvoid*)(instanceOffset + offsetof(InstanceData, modelMatrix) + column * columnSize));
+        glVertexAttribDivisor(modelLocation, 1);
+
+        GLuint normalLocation = INSTANCE_NORMAL_MATRIX_LOCATION_GPU + column;
+        glEnableVertexAttribArray(normalLocation);
+        glVertexAttribPointer(normalLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const GLvoid*)(instanceOffset + offsetof(InstanceData, normalMatrix) + column * columnSize));
+        glVertexAttribDivisor(normalLocation, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatcher::unbindInstanceAttributes() {
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribDivisor(INSTANCE_MODEL_MATRIX_LOCATION_GPU + column, 0);
+        glDisableVertexAttribArray(INSTANCE_MODEL_MATRIX_LOCATION_GPU + column);
+        glVertexAttribDivisor(INSTANCE_NORMAL_MATRIX_LOCATION_GPU + column, 0);
+        glDisableVertexAttribArray(INSTANCE_NORMAL_MATRIX_LOCATION_GPU + column);
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+#include "linmath/float4x4.h"
+
+class Mesh;
+class ShaderProgram;
+
+#define INSTANCE_MODEL_MATRIX_LOCATION_GPU 8
+#define INSTANCE_NORMAL_MATRIX_LOCATION_GPU 12
+
+/**
+ * \brief Draws many GameObjects sharing a Mesh with one draw call per chunk.
+ *
+ * Instances are collected each frame and grouped per mesh (and reflectiveness,
+ * since that is still a per object uniform). On render all matrices are written
+ * into one instance buffer and every chunk of every batch is drawn with
+ * a single glDrawElementsInstanced.
+ *
+ * \code
+ * batcher.clear();
+ * batcher.addInstance(mesh, object->shininess, object->getModelMatrix());
+ * batcher.render(instancedShaderProgram, true);
+ * \endcode
+ */
+class InstanceBatcher {
+public:
+    InstanceBatcher();
+    ~InstanceBatcher();
+
+    /**
+     * Removes all instances added since the last clear.
+     */
+    void clear();
+
+    void addInstance(Mesh *mesh, float reflectiveness, const chag::float4x4 &modelMatrix);
+
+    /**
+     * Uploads the instance buffer and draws all batches.
+     *
+     * @param shaderProgram A shader reading the per instance matrices from
+     *                      INSTANCE_MODEL_MATRIX_LOCATION_GPU and INSTANCE_NORMAL_MATRIX_LOCATION_GPU
+     * @param setMaterials If the material uniforms should be set for each chunk
+     */
+    void render(std::shared_ptr<ShaderProgram> &shaderProgram, bool setMaterials);
+
+private:
+    /**
+     * The per instance attributes, laid out as they are read by the vertex shader.
+     */
+    struct InstanceData {
+        chag::float4x4 modelMatrix;
+        chag::float4x4 normalMatrix;
+    };
+
+    struct Batch {
+        Mesh *mesh;
+        float reflectiveness;
+        std::vector<InstanceData> instances;
+    };
+
+    void uploadInstances();
+    void bindInstanceAttributes(size_t firstInstance);
+    /**
+     * Disables the per instance attributes again. They are state of the
+     * bound vertex array, which the non instanced passes draw with too.
+     */
+    void unbindInstanceAttributes();
+
+    std::vector<Batch> batches;
+    std::map<std::pair<Mesh*, float>, size_t> batchIndices;
+
+    std::vector<InstanceData> instanceBuffer;
+    GLuint instanceBufferObject = 0;
+};
@@ -15,7 +15,7 @@
  * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
  */
 #include "Renderer.h"
-#include <sstream>
+#include <algorithm>
 #include <Globals.h>
 #include "ResourceManager.h"
 #include "constants.h"
@@ -25,17 +25,13 @@
 #include "Camera.h"
 #include "Scene.h"
 #include "ShaderProgram.h"
+#include "InstanceBatcher.h"
+#include "StandardRenderer.h"
+#include "UniformBlocks.h"
+#include "UniformRingBuffer.h"
 
-
-namespace patch
-{
-    template < typename T > std::string to_string( const T& n )
-    {
-        std::ostringstream stm ;
-        stm << n ;
-        return stm.str() ;
-    }
-}
+// Room for all uniform blocks streamed in one frame.
+#define UNIFORM_RING_BUFFER_FRAME_SIZE (16 * 1024)
 
 
 Renderer::Renderer()
@@ -73,11 +69,32 @@ void Renderer::drawModel(IDrawable &model, std::shared_ptr<ShaderProgram> &shade
 void Renderer::drawScene(Camera *camera, Scene *scene, float currentTime)
 {
     Renderer::currentTime = currentTime;
+    uniformRingBuffer->beginFrame();
+
+    animationStage.clear();
+    for (GameObject *object : scene->getGameObjects()) {
+        object->addToAnimationStage(animationStage);
+    }
+    animationStage.evaluate();
 
     chag::float4x4 viewMatrix           = camera->getViewMatrix();
     chag::float4x4 projectionMatrix     = camera->getProjectionMatrix();
     chag::float4x4 viewProjectionMatrix = projectionMatrix * viewMatrix;
 
+    particleStage.clear();
+    for (GameObject *object : scene->getGameObjects()) {
+        object->addToParticleStage(particleStage);
+    }
+    particleStage.simulate(viewProjectionMatrix, camera->getPosition());
+
+    // The projection scales y by the cotangent of half the field of view,
+    // which spans the window height over the [-1, 1] clip range
+    float pixelsPerUnit = projectionMatrix.c2.y * Globals::get(Globals::Key::WINDOW_HEIGHT) / 2.0f;
+    for (GameObject *object : scene->getGameObjects()) {
+        object->requestTextureSizes(camera->getPosition(), pixelsPerUnit);
+    }
+    ResourceManager::updateTextureStreaming();
+
 
 
     // enable back face culling.
@@ -115,90 +132,129 @@ void Renderer::drawScene(Camera *camera, Scene *scene, float currentTime)
     // Use shader and set up uniforms
     shaderProgram->use();
 
-    shaderProgram->setUniformBufferSubData( UNIFORM_BUFFER_OBJECT_MATRICES_NAME, 0 * sizeof(chag::float4x4), sizeof(chag::float4x4), &(viewMatrix.c1.x));
-    shaderProgram->setUniformBufferSubData( UNIFORM_BUFFER_OBJECT_MATRICES_NAME, 1 * sizeof(chag::float4x4), sizeof(chag::float4x4), &(projectionMatrix.c1.x));
-    shaderProgram->setUniformBufferSubData( UNIFORM_BUFFER_OBJECT_MATRICES_NAME, 2 * sizeof(chag::float4x4), sizeof(chag::float4x4), &(viewProjectionMatrix.c1.x));
+    chag::float4x4 matrices[3] = { viewMatrix, projectionMatrix, viewProjectionMatrix };
+    uniformRingBuffer->upload(UNIFORM_BUFFER_OBJECT_MATRICES_INDEX, matrices, sizeof(matrices));
 
-    //Sets matrices
-    shaderProgram->setUniformMatrix4fv("lightMatrix", lightMatrix);
-    shaderProgram->setUniformMatrix4fv("inverseViewNormalMatrix", transpose(viewMatrix));
-    shaderProgram->setUniform3f("viewPosition", camera->getPosition());
-    shaderProgram->setUniformMatrix4fv("viewMatrix", viewMatrix);
+    setLights(scene);
+
+    setSceneUniforms(shaderProgram, sceneUniformHandles, camera, scene, lightMatrix);
+
+    instancedShaderProgram->use();
+    setSceneUniforms(instancedShaderProgram, instancedSceneUniformHandles, camera, scene, lightMatrix);
+
+    shaderProgram->use();
+    drawShadowCasters(shaderProgram, scene);
+
+    drawBloom(emissiveShader, scene, w, h, viewProjectionMatrix);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    drawTransparent(shaderProgram, scene);
+    glDisable(GL_BLEND);
+
+    renderPostProcess();
+
+    //Cleanup
+    glUseProgram(0);
+    uniformRingBuffer->endFrame();
+
+}
+
+Renderer::SceneUniformHandles Renderer::resolveSceneUniformHandles(std::shared_ptr<ShaderProgram> &shaderProgram) {
+    SceneUniformHandles handles;
+    handles.lightMatrix             = shaderProgram->getUniformHandle("lightMatrix");
+    handles.inverseViewNormalMatrix = shaderProgram->getUniformHandle("inverseViewNormalMatrix");
+    handles.viewPosition            = shaderProgram->getUniformHandle("viewPosition");
+    handles.viewMatrix              = shaderProgram->getUniformHandle("viewMatrix");
+    handles.fogEquation             = shaderProgram->getUniformHandle("fog.iEquation");
+    handles.fogDensity              = shaderProgram->getUniformHandle("fog.fDensity");
+    handles.fogEnd                  = shaderProgram->getUniformHandle("fog.fEnd");
+    handles.fogStart                = shaderProgram->getUniformHandle("fog.fStart");
+    handles.fogColor                = shaderProgram->getUniformHandle("fog.vColor");
+    handles.hasShadowMap            = shaderProgram->getUniformHandle("has_shadow_map");
+    handles.hasCubeMap              = shaderProgram->getUniformHandle("hasCubeMap");
+    handles.objectReflectiveness    = shaderProgram->getUniformHandle("object_reflectiveness");
+
+    // The texture units never change, so they are only set once.
+    shaderProgram->use();
+    shaderProgram->setUniform1i("shadowMap", 1);
+    shaderProgram->setUniform1i("cubeMap", 2);
+    StandardRenderer::initShaderProgram(shaderProgram);
+
+    return handles;
+}
+
+void Renderer::setSceneUniforms(std::shared_ptr<ShaderProgram> &shaderProgram, const SceneUniformHandles &handles,
+                                Camera *camera, Scene *scene, chag::float4x4 &lightMatrix) {
+    chag::float4x4 viewMatrix = camera->getViewMatrix();
 
-    setLights(shaderProgram, scene);
+    //Sets matrices
+    shaderProgram->setUniformMatrix4fv(handles.lightMatrix, lightMatrix);
+    shaderProgram->setUniformMatrix4fv(handles.inverseViewNormalMatrix, transpose(viewMatrix));
+    shaderProgram->setUniform3f(handles.viewPosition, camera->getPosition());
+    shaderProgram->setUniformMatrix4fv(handles.viewMatrix, viewMatrix);
 
-    setFog(shaderProgram);
+    setFog(shaderProgram, handles);
 
     //Set shadowmap
     if (scene->shadowMapCamera != NULL) {
-        shaderProgram->setUniform1i("has_shadow_map", 1);
-        shaderProgram->setUniform1i("shadowMap", 1);
+        shaderProgram->setUniform1i(handles.hasShadowMap, 1);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, sbo.texture);
+    } else {
+        shaderProgram->setUniform1i(handles.hasShadowMap, 0);
     }
 
     //Set cube map
     if (scene->cubeMap != nullptr) {
-        shaderProgram->setUniform1i("hasCubeMap", 1);
-        shaderProgram->setUniform1i("cubeMap", 2);
+        shaderProgram->setUniform1i(handles.hasCubeMap, 1);
         glActiveTexture(GL_TEXTURE2);
         scene->cubeMap->bind(GL_TEXTURE2);
     } else {
-        shaderProgram->setUniform1i("hasCubeMap", 0);
-        shaderProgram->setUniform1i("cubeMap", 2);
+        shaderProgram->setUniform1i(handles.hasCubeMap, 0);
     }
+}
 
-    drawShadowCasters(shaderProgram, scene);
-
-    drawBloom(emissiveShader, scene, w, h, viewProjectionMatrix);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    drawTransparent(shaderProgram, scene);
-    glDisable(GL_BLEND);
-
-    renderPostProcess();
-
-    //Cleanup
-    glUseProgram(0);
+static void copyLightColors(LightColorsStd140 &colors, const Light &light) {
+    colors.ambientColor  = light.ambientColor;
+    colors.diffuseColor  = light.diffuseColor;
+    colors.specularColor = light.specularColor;
+}
 
+static void copyAttenuation(AttenuationStd140 &attenuationBlock, const Attenuation &attenuation) {
+    attenuationBlock.constant = attenuation.constant;
+    attenuationBlock.linear   = attenuation.linear;
+    attenuationBlock.exp      = attenuation.exp;
 }
 
-void Renderer::setLights(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene) {
+void Renderer::setLights(Scene *scene) {
+    LightsBlockStd140 lights = {};
+
     //set dirlights
-    shaderProgram->setUniform3f("directionalLight.colors.ambientColor", scene->directionalLight.ambientColor);
-    shaderProgram->setUniform3f("directionalLight.colors.diffuseColor", scene->directionalLight.diffuseColor);
-    shaderProgram->setUniform3f("directionalLight.colors.specularColor", scene->directionalLight.specularColor);
-    shaderProgram->setUniform3f("directionalLight.direction", scene->directionalLight.direction);
+    copyLightColors(lights.directionalLight.colors, scene->directionalLight);
+    lights.directionalLight.direction = scene->directionalLight.direction;
 
     //set pointLights
-
-    shaderProgram->setUniform1i("nrPointLights", (int)scene->pointLights.size());
-    for (int i = 0; i < (int)scene->pointLights.size(); i++) {
-        std::string name = std::string("pointLights[") + patch::to_string(i).c_str() + "]";
-        shaderProgram->setUniform3f((name + ".position").c_str(), scene->pointLights[i].position);
-        shaderProgram->setUniform3f((name + ".colors.ambientColor").c_str(), scene->pointLights[i].ambientColor);
-        shaderProgram->setUniform3f((name + ".colors.diffuseColor").c_str(), scene->pointLights[i].diffuseColor);
-        shaderProgram->setUniform3f((name + ".colors.specularColor").c_str(), scene->pointLights[i].specularColor);
-        shaderProgram->setUniform1f((name + ".attenuation.constant").c_str(), scene->pointLights[i].attenuation.constant);
-        shaderProgram->setUniform1f((name + ".attenuation.linear").c_str(), scene->pointLights[i].attenuation.linear);
-        shaderProgram->setUniform1f((name + ".attenuation.exp").c_str(), scene->pointLights[i].attenuation.exp);
+    lights.nrPointLights = std::min((int)scene->pointLights.size(), UNIFORM_BLOCK_MAX_POINT_LIGHTS);
+    for (int i = 0; i < lights.nrPointLights; i++) {
+        PointLightStd140 &light = lights.pointLights[i];
+        copyLightColors(light.colors, scene->pointLights[i]);
+        light.position = scene->pointLights[i].position;
+        copyAttenuation(light.attenuation, scene->pointLights[i].attenuation);
     }
 
     //set spotLights
-    shaderProgram->setUniform1i("nrSpotLights", (int)scene->spotLights.size());
-    for (int i = 0; i < (int)scene->spotLights.size(); i++) {
-        std::string name = std::string("spotLights[") + patch::to_string(i).c_str() + "]";
-        shaderProgram->setUniform3f((name + ".position").c_str(), scene->spotLights[i].position);
-        shaderProgram->setUniform3f((name + ".colors.ambientColor").c_str(), scene->spotLights[i].ambientColor);
-        shaderProgram->setUniform3f((name + ".colors.diffuseColor").c_str(), scene->spotLights[i].diffuseColor);
-        shaderProgram->setUniform3f((name + ".colors.specularColor").c_str(), scene->spotLights[i].specularColor);
-        shaderProgram->setUniform1f((name + ".attenuation.constant").c_str(), scene->spotLights[i].attenuation.constant);
-        shaderProgram->setUniform1f((name + ".attenuation.linear").c_str(), scene->spotLights[i].attenuation.linear);
-        shaderProgram->setUniform1f((name + ".attenuation.exp").c_str(), scene->spotLights[i].attenuation.exp);
-        shaderProgram->setUniform3f((name + ".direction").c_str(), scene->spotLights[i].direction);
-        shaderProgram->setUniform1f((name + ".cutoff").c_str(), scene->spotLights[i].cutOff);
-        shaderProgram->setUniform1f((name + ".cutoffOuter").c_str(), scene->spotLights[i].outerCutOff);
+    lights.nrSpotLights = std::min((int)scene->spotLights.size(), UNIFORM_BLOCK_MAX_SPOT_LIGHTS);
+    for (int i = 0; i < lights.nrSpotLights; i++) {
+        SpotLightStd140 &light = lights.spotLights[i];
+        copyLightColors(light.colors, scene->spotLights[i]);
+        light.position    = scene->spotLights[i].position;
+        light.direction   = scene->spotLights[i].direction;
+        light.cutoff      = scene->spotLights[i].cutOff;
+        light.cutoffOuter = scene->spotLights[i].outerCutOff;
+        copyAttenuation(light.attenuation, scene->spotLights[i].attenuation);
     }
+
+    uniformRingBuffer->upload(UNIFORM_BUFFER_OBJECT_LIGHTS_INDEX, &lights, sizeof(LightsBlockStd140));
 }
 
 /**
@@ -207,11 +263,23 @@ void Renderer::setLights(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *s
 */
 void Renderer::drawShadowCasters(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene)
 {
+    instanceBatcher->clear();
+
     std::vector<GameObject*> shadowCasters = scene->getShadowCasters();
-    for (unsigned int i = 0; i < scene->getShadowCasters().size(); i++) {
-        shaderProgram->setUniform1f("object_reflectiveness", (*shadowCasters[i]).shininess);
+    for (unsigned int i = 0; i < shadowCasters.size(); i++) {
+        Mesh *instanceableMesh = shadowCasters[i]->getInstanceableMesh(shaderProgram);
+        if (instanceableMesh != nullptr) {
+            instanceBatcher->addInstance(instanceableMesh, shadowCasters[i]->shininess,
+                                         shadowCasters[i]->getModelMatrix());
+            continue;
+        }
+
+        shaderProgram->setUniform1f(sceneUniformHandles.objectReflectiveness, (*shadowCasters[i]).shininess);
         drawModel(*shadowCasters[i], shaderProgram);
     }
+
+    instanceBatcher->render(instancedShaderProgram, true);
+    shaderProgram->use();
 }
 
 void Renderer::drawTransparent(std::shared_ptr<ShaderProgram> &shaderProgram, Scene *scene)
@@ -219,7 +287,7 @@ void Renderer::drawTransparent(std::shared_ptr<ShaderProgram> &shaderProgram, Sc
     shaderProgram->use();
     std::vector<GameObject*> transparentObjects = scene->getTransparentObjects();
     for (unsigned int i = 0; i < transparentObjects.size(); i++) {
-        shaderProgram->setUniform1f("object_reflectiveness", (*transparentObjects[i]).shininess);
+        shaderProgram->setUniform1f(sceneUniformHandles.objectReflectiveness, (*transparentObjects[i]).shininess);
         drawModel(*transparentObjects[i], shaderProgram);
     }
 }
@@ -295,24 +363,37 @@ void Renderer::drawShadowMap(Fbo sbo, chag::float4x4 viewProjectionMatrix, Scene
     sbo.shaderProgram->use();
     sbo.shaderProgram->setUniformMatrix4fv("viewProjectionMatrix", viewProjectionMatrix);
 
+    instanceBatcher->clear();
+
     std::vector<GameObject*> shadowCasters = scene->getShadowCasters();
     for (unsigned int i = 0; i < shadowCasters.size(); i++) {
-        sbo.shaderProgram->setUniform1f("object_reflectiveness", (*shadowCasters[i]).shininess);
+        Mesh *instanceableMesh = shadowCasters[i]->getInstanceableShadowMesh(sbo.shaderProgram);
+        if (instanceableMesh != nullptr) {
+            instanceBatcher->addInstance(instanceableMesh, shadowCasters[i]->shininess,
+                                         shadowCasters[i]->getModelMatrix());
+            continue;
+        }
+
+        sbo.shaderProgram->setUniform1f(shadowReflectivenessHandle, (*shadowCasters[i]).shininess);
         (*shadowCasters[i]).renderShadow(sbo.shaderProgram);
     }
 
+    instancedShadowShaderProgram->use();
+    instancedShadowShaderProgram->setUniformMatrix4fv("viewProjectionMatrix", viewProjectionMatrix);
+    instanceBatcher->render(instancedShadowShaderProgram, false);
+
     //CLEANUP
     glDisable(GL_POLYGON_OFFSET_FILL);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glUseProgram(currentProgram);
 }
 
-void Renderer::setFog(std::shared_ptr<ShaderProgram> &shaderProgram) {
-    shaderProgram->setUniform1i("fog.iEquation",    effects.fog.fEquation);
-    shaderProgram->setUniform1f("fog.fDensity",    effects.fog.fDensity);
-    shaderProgram->setUniform1f("fog.fEnd",        effects.fog.fEnd);
-    shaderProgram->setUniform1f("fog.fStart",    effects.fog.fStart);
-    shaderProgram->setUniform3f("fog.vColor",    effects.fog.vColor);
+void Renderer::setFog(std::shared_ptr<ShaderProgram> &shaderProgram, const SceneUniformHandles &handles) {
+    shaderProgram->setUniform1i(handles.fogEquation, effects.fog.fEquation);
+    shaderProgram->setUniform1f(handles.fogDensity,  effects.fog.fDensity);
+    shaderProgram->setUniform1f(handles.fogEnd,      effects.fog.fEnd);
+    shaderProgram->setUniform1f(handles.fogStart,    effects.fog.fStart);
+    shaderProgram->setUniform3f(handles.fogColor,    effects.fog.vColor);
 }
 
 void Renderer::initGL()
@@ -332,8 +413,22 @@ void Renderer::initGL()
 
     emissiveShader = ResourceManager::loadAndFetchShaderProgram(EMISSIVE_SHADER_NAME,"shaders/emissive.vert","shaders/emissive.frag");
 
-    shaderProgram->setUniformBufferObjectBinding(UNIFORM_BUFFER_OBJECT_MATRICES_NAME, UNIFORM_BUFFER_OBJECT_MATRICES_INDEX);
-    shaderProgram->initUniformBufferObject(UNIFORM_BUFFER_OBJECT_MATRICES_NAME, 3 * sizeof(chag::float4x4), UNIFORM_BUFFER_OBJECT_MATRICES_INDEX);
+    instancedShaderProgram = ResourceManager::loadAndFetchShaderProgram(SIMPLE_INSTANCED_SHADER_NAME,
+                                                                        "shaders/simple_instanced.vert",
+                                                                        "shaders/simple.frag");
+
+    uniformRingBuffer = std::unique_ptr<UniformRingBuffer>(new UniformRingBuffer(UNIFORM_RING_BUFFER_FRAME_SIZE));
+    if (!uniformRingBuffer->isPersistentlyMapped()) {
+        Logger::logInfo("ARB_buffer_storage is not supported, streaming uniforms through unsynchronized maps.");
+    }
+
+    sceneUniformHandles = resolveSceneUniformHandles(shaderProgram);
+    instancedSceneUniformHandles = resolveSceneUniformHandles(instancedShaderProgram);
+    emissiveShader->use();
+    StandardRenderer::initShaderProgram(emissiveShader);
+    glUseProgram(0);
+
+    instanceBatcher = std::unique_ptr<InstanceBatcher>(new InstanceBatcher());
 
     CHECK_GL_ERROR();
 
@@ -345,6 +440,10 @@ void Renderer::initGL()
     Logger::logInfo("Generating OpenGL data.");
 
     sbo.shaderProgram = ResourceManager::loadAndFetchShaderProgram("SHADOW_SHADER", "shaders/shadowMap.vert", "shaders/shadowMap.frag");
+    shadowReflectivenessHandle = sbo.shaderProgram->getUniformHandle("object_reflectiveness");
+    instancedShadowShaderProgram = ResourceManager::loadAndFetchShaderProgram(SHADOW_INSTANCED_SHADER_NAME,
+                                                                              "shaders/shadowMap_instanced.vert",
+                                                                              "shaders/shadowMap.frag");
 
     sbo.width = SHADOW_MAP_RESOLUTION;
     sbo.height = SHADOW_MAP_RESOLUTION;
@@ -0,0 +1,177 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "UniformRingBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "glutil/glutil.h"
+#include "Logger.h"
+
+// How long to wait for a fence before logging that the GPU is behind, in ns.
+#define FENCE_WAIT_TIMEOUT 1000000000
+
+UniformRingBuffer::UniformRingBuffer(GLsizeiptr bytesPerFrame) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    if (offsetAlignment < 1) {
+        offsetAlignment = 1;
+    }
+    regionSize = alignOffset(bytesPerFrame);
+    createBuffer();
+
+    // Start on the last region so that the first beginFrame() uses region 0.
+    currentRegion = UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT - 1;
+}
+
+UniformRingBuffer::~UniformRingBuffer() {
+    if (!overflowBuffers.empty()) {
+        glDeleteBuffers((GLsizei)overflowBuffers.size(), overflowBuffers.data());
+    }
+    deleteBuffer();
+}
+
+void UniformRingBuffer::beginFrame() {
+    if (!overflowBuffers.empty()) {
+        glDeleteBuffers((GLsizei)overflowBuffers.size(), overflowBuffers.data());
+        overflowBuffers.clear();
+    }
+    if (frameSize > regionSize) {
+        grow(frameSize);
+    }
+
+    currentRegion = (currentRegion + 1) % UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT;
+    writeOffset = 0;
+    frameSize = 0;
+
+    GLsync &fence = fences[currentRegion];
+    if (fence != 0) {
+        waitForFence(fence);
+        glDeleteSync(fence);
+        fence = 0;
+    }
+}
+
+void UniformRingBuffer::endFrame() {
+    fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr UniformRingBuffer::upload(GLuint bindingIndex, const void *data, GLsizeiptr size) {
+    frameSize = alignOffset(frameSize + size);
+    if (writeOffset + size > regionSize) {
+        return uploadOverflow(bindingIndex, data, size);
+    }
+
+    GLintptr offset = currentRegion * regionSize + writeOffset;
+
+    if (persistentMapping != nullptr) {
+        memcpy(persistentMapping + offset, data, (size_t)size);
+        glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, bufferObject, offset, size);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferObject);
+        void *mapping = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        memcpy(mapping, data, (size_t)size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, bufferObject, offset, size);
+    }
+
+    writeOffset = alignOffset(writeOffset + size);
+    return offset;
+}
+
+bool UniformRingBuffer::isPersistentlyMapped() const {
+    return persistentMapping != nullptr;
+}
+
+GLintptr UniformRingBuffer::alignOffset(GLintptr offset) const {
+    return ((offset + offsetAlignment - 1) / offsetAlignment) * offsetAlignment;
+}
+
+void UniformRingBuffer::createBuffer() {
+    GLsizeiptr bufferSize = regionSize * UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT;
+
+    glGenBuffers(1, &bufferObject);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferObject);
+
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, bufferSize, NULL, flags);
+        persistentMapping = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, bufferSize, flags);
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECK_GL_ERROR();
+}
+
+void UniformRingBuffer::deleteBuffer() {
+    for (GLsync &fence : fences) {
+        if (fence != 0) {
+            glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+    if (persistentMapping != nullptr) {
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferObject);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        persistentMapping = nullptr;
+    }
+    glDeleteBuffers(1, &bufferObject);
+    bufferObject = 0;
+}
+
+void UniformRingBuffer::grow(GLsizeiptr bytesPerFrame) {
+    // Wait for the GPU to finish every region before the mapping goes away
+    for (GLsync fence : fences) {
+        if (fence != 0) {
+            waitForFence(fence);
+        }
+    }
+    deleteBuffer();
+
+    regionSize = alignOffset(std::max(bytesPerFrame, regionSize * 2));
+    createBuffer();
+    Logger::logInfo("Uniform ring buffer regions grown to " + std::to_string(regionSize) + " bytes.");
+}
+
+GLintptr UniformRingBuffer::uploadOverflow(GLuint bindingIndex, const void *data, GLsizeiptr size) {
+    // A buffer of its own, so that the block stays intact for the draws of
+    // this frame whatever else overflows after it
+    GLuint overflowBuffer;
+    glGenBuffers(1, &overflowBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, overflowBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, overflowBuffer, 0, size);
+
+    overflowBuffers.push_back(overflowBuffer);
+    return 0;
+}
+
+void UniformRingBuffer::waitForFence(GLsync fence) {
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        Logger::logInfo("Waiting for the GPU to release a uniform ring buffer region.");
+        result = glClientWaitSync(fence, 0, FENCE_WAIT_TIMEOUT);
+    }
+    if (result == GL_WAIT_FAILED) {
+        Logger::logError("Failed waiting for a uniform ring buffer fence.");
+    }
+}
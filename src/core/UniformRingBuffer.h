@@ -0,0 +1,101 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#define UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT 3
+
+/**
+ * \brief Streams per frame uniform blocks to the GPU without stalling.
+ *
+ * The buffer is split into one region per frame in flight. Each frame writes
+ * its blocks into its own region and binds them with glBindBufferRange, so the
+ * CPU can fill frame N+1 while the GPU still reads frame N. A fence is placed
+ * at the end of every frame, and a region is only reused once the GPU has
+ * passed the fence of the frame that last used it.
+ *
+ * When ARB_buffer_storage is available the buffer is persistently mapped and
+ * written directly, otherwise each block is written through an unsynchronized
+ * glMapBufferRange, which is safe since the fences guard the region.
+ *
+ * A frame that writes more than a region holds does not fail. The blocks
+ * that no longer fit go to buffers of their own, created with the data and
+ * deleted next frame, and the next beginFrame() grows the regions to fit.
+ *
+ * \code
+ * ringBuffer.beginFrame();
+ * ringBuffer.upload(UNIFORM_BUFFER_OBJECT_MATRICES_INDEX, &matrices, sizeof(matrices));
+ * // ... draw ...
+ * ringBuffer.endFrame();
+ * \endcode
+ */
+class UniformRingBuffer {
+public:
+    /**
+     * @param bytesPerFrame The most uniform data written in a single frame
+     */
+    UniformRingBuffer(GLsizeiptr bytesPerFrame);
+    ~UniformRingBuffer();
+
+    /**
+     * Moves on to the next region, waiting for the GPU if it is still
+     * reading it from UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT frames ago.
+     * Grows the regions first if the last frame did not fit.
+     */
+    void beginFrame();
+
+    /**
+     * Fences the region written this frame.
+     */
+    void endFrame();
+
+    /**
+     * Copies a block into the current region and binds it to the given
+     * uniform buffer binding point. If the region is full, the block gets
+     * an overflow buffer of its own instead.
+     *
+     * @return The offset of the block in the buffer it was bound from
+     */
+    GLintptr upload(GLuint bindingIndex, const void *data, GLsizeiptr size);
+
+    bool isPersistentlyMapped() const;
+
+private:
+    GLuint bufferObject = 0;
+    GLsizeiptr regionSize;
+    GLint offsetAlignment = 1;
+
+    unsigned char *persistentMapping = nullptr;
+    GLsync fences[UNIFORM_RING_BUFFER_FRAMES_IN_FLIGHT] = {};
+
+    int currentRegion = 0;
+    GLintptr writeOffset = 0;
+
+    // The bytes the current frame wanted to write, including what overflowed
+    GLsizeiptr frameSize = 0;
+    // Buffers of the blocks that did not fit, deleted at the next beginFrame()
+    std::vector<GLuint> overflowBuffers;
+
+    GLintptr alignOffset(GLintptr offset) const;
+    void createBuffer();
+    void deleteBuffer();
+    void grow(GLsizeiptr bytesPerFrame);
+    GLintptr uploadOverflow(GLuint bindingIndex, const void *data, GLsizeiptr size);
+    void waitForFence(GLsync fence);
+};
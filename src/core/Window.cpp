@@ -19,6 +19,7 @@
 #include <Globals.h>
 #include "Logger.h"
 #include <JoystickTranslator.h>
+#include <ResourceManager.h>
 
 Window::Window(int width, int height, std::string title) {
 #	if defined(__linux__)
@@ -113,6 +114,9 @@ void Window::start(unsigned int maxFPS) {
 		// end the current frame (internally swaps the front and back buffers)
 		window->display();
 	}
+
+	// The cached resources delete their OpenGL objects, which needs the context
+	ResourceManager::clear();
 }
 
 void Window::setResizeMethod(void(*resize)(int, int)) {
@@ -17,6 +17,7 @@
 #include "Logger.h"
 #include "sstream"
 #include <time.h>
+#include <mutex>
 
 using namespace std;
 
@@ -40,6 +41,10 @@ void Logger::logInfo(string msg) {
 }
 
 void Logger::log(unsigned int level, string msg) {
+	// Resources are loaded on other threads, keep their messages whole
+	static std::mutex logMutex;
+	std::lock_guard<std::mutex> lock(logMutex);
+
 	if (level >= currentLogLevel) {
 		for (auto logHandler : logHandlers) {
 			std::stringstream ss;
@@ -18,220 +18,142 @@
 #include <ResourceManager.h>
 #include <Utils.h>
 #include "BoneTransformer.h"
+#include <algorithm>
 
 
-BoneTransformer::BoneTransformer(aiScene *aiScene){
+/**
+ * The inverse of convertAiMatrixToFloat4x4, used for decomposing matrices with assimp.
+ */
+static aiMatrix4x4 convertFloat4x4ToAiMatrix(const chag::float4x4 &matrix) {
+    return aiMatrix4x4(matrix.c1.x, matrix.c2.x, matrix.c3.x, matrix.c4.x,
+                       matrix.c1.y, matrix.c2.y, matrix.c3.y, matrix.c4.y,
+                       matrix.c1.z, matrix.c2.z, matrix.c3.z, matrix.c4.z,
+                       matrix.c1.w, matrix.c2.w, matrix.c3.w, matrix.c4.w);
+}
+
+BoneTransformer::BoneTransformer(const aiScene *aiScene){
     numberOfBones = 0;
     globalInverseTransform = convertAiMatrixToFloat4x4(aiScene->mRootNode->mTransformation.Inverse());
-    this->assimpScene = aiScene;
-}
 
-void BoneTransformer::readNodeHierarchyAndUpdateBoneTransformations(float currentAnimationTick,
-                                                                    aiNode *currentAssimpNode,
-                                                                    chag::float4x4 parentMatrix) {
-    std::string nodeName(currentAssimpNode->mName.data);
+    flattenNodeHierarchy(aiScene->mRootNode, -1);
 
-    chag::float4x4 nodeTransformationMatrix = getCurrentNodeTransformation(currentAnimationTick, currentAssimpNode, nodeName);
-    chag::float4x4 globalTransformation = parentMatrix * nodeTransformationMatrix;
+    std::vector<std::string> nodeNames;
+    bindPose.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodeNames.push_back(nodes[i].name);
 
-    // If the node isn't a bone we dont need to update any bones (duuuh)
-    if(nodeIsABone(nodeName)) {
-        updateBoneTransformation(nodeName, globalTransformation);
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        convertFloat4x4ToAiMatrix(nodes[i].nodeTransformation).Decompose(scaling, rotation, position);
+        bindPose.setNode(i, chag::make_vector(position.x, position.y, position.z),
+                         chag::make_vector(rotation.x, rotation.y, rotation.z, rotation.w),
+                         chag::make_vector(scaling.x, scaling.y, scaling.z));
     }
 
-    for (unsigned int i = 0; i < currentAssimpNode->mNumChildren; i++) {
-        readNodeHierarchyAndUpdateBoneTransformations(currentAnimationTick, currentAssimpNode->mChildren[i],
-                                                      globalTransformation);
+    for (unsigned int i = 0; i < aiScene->mNumAnimations; i++) {
+        animationClips.push_back(AnimationClip(aiScene->mAnimations[i], nodeNames, bindPose));
+        for (size_t node = 0; node < nodes.size(); node++) {
+            nodes[node].animatedByAnyClip |= animationClips.back().animatesNode(node);
+        }
     }
 }
 
-void BoneTransformer::updateBoneTransformation(const std::string &nodeName, const chag::float4x4 &globalTransformation) {
-    uint boneIndex = boneNameToIndexMapping[nodeName];
-
-    boneInfos[boneIndex]->finalTransformation = globalInverseTransform * globalTransformation * boneInfos[boneIndex]->boneOffset;
-}
-
-bool BoneTransformer::nodeIsABone(const std::string &nodeName) const {
-    return boneNameToIndexMapping.find(nodeName) != boneNameToIndexMapping.end();
-}
+void BoneTransformer::flattenNodeHierarchy(const aiNode *assimpNode, int parentIndex) {
+    SkeletonNode node;
+    node.parentIndex = parentIndex;
+    node.name = std::string(assimpNode->mName.data);
+    node.boneIndex = -1;
+    node.nodeTransformation = convertAiMatrixToFloat4x4(assimpNode->mTransformation);
+    node.animatedByAnyClip = false;
 
-chag::float4x4 BoneTransformer::getCurrentNodeTransformation(float currentAnimationTick,
-                                                             const aiNode *currentAssimpNode,
-                                                             const std::string nodeName) {
-    const aiNodeAnim *nodeAnimation = getAnimationNode(nodeName);
-    if(nodeAnimation == nullptr) {
-        /**
-         * If we can't find a nodeAnimation, there is no corresponding bone.
-         * Then the current node is only used for applying a transformation matrix to
-         * the hierarchy. No interpolation needed.
-         */
-        return convertAiMatrixToFloat4x4(currentAssimpNode->mTransformation);
-    } else {
-        return getInterpolatedAnimationMatrix(currentAnimationTick, nodeAnimation);
+    int nodeIndex = (int)nodes.size();
+    nodes.push_back(node);
 
+    for (unsigned int i = 0; i < assimpNode->mNumChildren; i++) {
+        flattenNodeHierarchy(assimpNode->mChildren[i], nodeIndex);
     }
 }
 
-chag::float4x4 BoneTransformer::getInterpolatedAnimationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    chag::float4x4 scalingMatrix = getInterpolatedScalingMatrix(currentAnimationTick, nodeAnimation);
-    chag::float4x4 rotationMatrix = getInterpolatedRotationMatrix(currentAnimationTick, nodeAnimation);
-    chag::float4x4 translationMatrix = getInterpolatedTranslationMatrix(currentAnimationTick, nodeAnimation);
-
-    chag::float4x4 interpolatedMatrix = translationMatrix * rotationMatrix * scalingMatrix;
-    return interpolatedMatrix;
-}
-
-chag::float4x4 BoneTransformer::getInterpolatedTranslationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    aiVector3D translation = calculateTranslationInterpolation(currentAnimationTick, nodeAnimation);
-    chag::float4x4 translationMatrix =
-                chag::make_translation(chag::make_vector(
-                        translation.x,
-                        translation.y,
-                        translation.z));
-    return translationMatrix;
-}
-
-chag::float4x4 BoneTransformer::getInterpolatedRotationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    aiQuaternion rotationQuaternion = calculateRotationInterpolation(currentAnimationTick, nodeAnimation);
-    chag::float4x4 rotationMatrix = chag::make_matrix(
-                convertAiMatrixToFloat3x3(rotationQuaternion.GetMatrix()),
-                chag::make_vector(0.0f, 0.0f, 0.0f)
-        );
-    return rotationMatrix;
+std::vector<chag::float4x4> BoneTransformer::calculateBoneTransforms(float totalElapsedTimeInSeconds) const {
+    std::vector<chag::float4x4> boneTransformMatrices;
+    BoneTransformScratch scratch;
+    calculateBoneTransforms(totalElapsedTimeInSeconds, boneTransformMatrices, scratch);
+    return boneTransformMatrices;
 }
 
-chag::float4x4 BoneTransformer::getInterpolatedScalingMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    aiVector3D scaling = calculateScalingInterpolation(currentAnimationTick, nodeAnimation);
-    chag::float4x4 scalingMatrix = chag::make_scale<chag::float4x4>(chag::make_vector(scaling.x, scaling.y, scaling.z));
-    return scalingMatrix;
+void BoneTransformer::calculateBoneTransforms(float totalElapsedTimeInSeconds,
+                                              std::vector<chag::float4x4> &boneTransforms,
+                                              BoneTransformScratch &scratch) const {
+    if (animationClips.empty()) {
+        calculateBoneTransforms(bindPose, boneTransforms, scratch.globalTransformations);
+        return;
+    }
+    animationClips[0].sample(totalElapsedTimeInSeconds, true, scratch.pose, scratch.keyframeCache);
+    calculateBoneTransforms(scratch.pose, boneTransforms, scratch.globalTransformations);
 }
 
-const aiNodeAnim *BoneTransformer::getAnimationNode(const std::string &nodeName) {
-    const aiAnimation* animation = assimpScene->mAnimations[0];
-
-    const aiNodeAnim* nodeAnimation = findNodeAnim(animation, nodeName);
-    return nodeAnimation;
-}
+void BoneTransformer::calculateBoneTransforms(const Pose &pose, std::vector<chag::float4x4> &boneTransforms,
+                                              std::vector<chag::float4x4> &globalTransformations) const {
+    globalTransformations.resize(nodes.size());
+    chag::float4x4 rootMatrix = chag::make_identity<chag::float4x4>();
 
-const aiNodeAnim* BoneTransformer::findNodeAnim(const aiAnimation* animation, const std::string nodeName) {
-    for (unsigned int i = 0; i < animation->mNumChannels; i++) {
-        const aiNodeAnim* nodeAnimation = animation->mChannels[i];
-        if(std::string(nodeAnimation->mNodeName.data) == nodeName) {
-            return nodeAnimation;
-        }
+    // Bones missing from the node hierarchy keep the identity transform
+    if ((int)boneTransforms.size() != numberOfBones) {
+        boneTransforms.assign(numberOfBones, rootMatrix);
     }
-    return nullptr;
-}
 
-aiVector3D BoneTransformer::calculateScalingInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    if(nodeAnimation->mNumScalingKeys <= 1) {
-        return nodeAnimation->mScalingKeys[0].mValue;
-    }
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const SkeletonNode &node = nodes[i];
 
-    unsigned int currentScalingIndex = findScalingIndexRightBeforeTick(currentAnimationTick, nodeAnimation);
-    unsigned int nextScalingIndex = currentScalingIndex + 1;
-    assert(nextScalingIndex < nodeAnimation->mNumScalingKeys);
+        chag::float4x4 nodeTransformationMatrix = node.nodeTransformation;
+        if (node.animatedByAnyClip) {
+            chag::float3 translation = pose.getTranslation(i);
+            chag::float4 rotation = pose.getRotation(i);
+            chag::float3 scale = pose.getScale(i);
 
-    double deltaTimeBetweenAnimations = nodeAnimation->mScalingKeys[nextScalingIndex].mTime -
-                                       nodeAnimation->mScalingKeys[currentScalingIndex].mTime;
-    double deltaFactor = (currentAnimationTick - nodeAnimation->mScalingKeys[currentScalingIndex].mTime) /
-                         deltaTimeBetweenAnimations;
-    assert(deltaFactor >= 0.0f && deltaFactor <= 1.0f);
-    const aiVector3D &currentScalingVector = nodeAnimation->mScalingKeys[currentScalingIndex].mValue;
-    const aiVector3D &nextScalingVector = nodeAnimation->mScalingKeys[nextScalingIndex].mValue;
-    aiVector3D deltaScalingVector = (nextScalingVector - currentScalingVector) * (float)deltaFactor;
+            aiQuaternion rotationQuaternion(rotation.w, rotation.x, rotation.y, rotation.z);
+            chag::float4x4 rotationMatrix = chag::make_matrix(convertAiMatrixToFloat3x3(rotationQuaternion.GetMatrix()),
+                                                              chag::make_vector(0.0f, 0.0f, 0.0f));
+            nodeTransformationMatrix = chag::make_translation(translation) * rotationMatrix
+                                     * chag::make_scale<chag::float4x4>(scale);
+        }
 
-    return currentScalingVector + deltaScalingVector;
-}
+        const chag::float4x4 &parentMatrix = node.parentIndex < 0 ? rootMatrix : globalTransformations[node.parentIndex];
+        globalTransformations[i] = parentMatrix * nodeTransformationMatrix;
 
-aiQuaternion BoneTransformer::calculateRotationInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    if(nodeAnimation->mNumRotationKeys <= 1) {
-        return nodeAnimation->mRotationKeys[0].mValue;
+        if (node.boneIndex >= 0) {
+            boneTransforms[node.boneIndex] = globalInverseTransform * globalTransformations[i] * boneInfos[node.boneIndex]->boneOffset;
+        }
     }
-
-    unsigned int currentRotationIndex = findRotationIndexRightBeforeTick(currentAnimationTick, nodeAnimation);
-    unsigned int nextRotationIndex = currentRotationIndex + 1;
-    assert(nextRotationIndex < nodeAnimation->mNumRotationKeys);
-
-    double deltaTimeBetweenAnimations = nodeAnimation->mRotationKeys[nextRotationIndex].mTime -
-                                       nodeAnimation->mRotationKeys[currentRotationIndex].mTime;
-    double deltaFactor = (currentAnimationTick - nodeAnimation->mRotationKeys[currentRotationIndex].mTime) /
-                         deltaTimeBetweenAnimations;
-    assert(deltaFactor >= 0.0f && deltaFactor <= 1.0f);
-    const aiQuaternion &currentRotationQuaternion = nodeAnimation->mRotationKeys[currentRotationIndex].mValue;
-    const aiQuaternion &nextRotationQuaternion = nodeAnimation->mRotationKeys[nextRotationIndex].mValue;
-    aiQuaternion interpolatedQuaternion;
-    aiQuaterniont<float>::Interpolate(interpolatedQuaternion, currentRotationQuaternion, nextRotationQuaternion, deltaFactor);
-
-    return interpolatedQuaternion;
 }
 
-aiVector3D BoneTransformer::calculateTranslationInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    if(nodeAnimation->mNumPositionKeys <= 1) {
-        return nodeAnimation->mPositionKeys[0].mValue;
-    }
-
-    unsigned int currentTranslationIndex = findTranslationIndexRightBeforeTick(currentAnimationTick, nodeAnimation);
-    unsigned int nextTranslationIndex = currentTranslationIndex + 1;
-    assert(nextTranslationIndex < nodeAnimation->mNumPositionKeys);
-
-    double deltaTimeBetweenAnimations = nodeAnimation->mPositionKeys[nextTranslationIndex].mTime -
-                                       nodeAnimation->mPositionKeys[currentTranslationIndex].mTime;
-    double deltaFactor = (currentAnimationTick - nodeAnimation->mPositionKeys[currentTranslationIndex].mTime) /
-                         deltaTimeBetweenAnimations;
-    assert(deltaFactor >= 0.0f && deltaFactor <= 1.0f);
-    const aiVector3D &currentTranslationVector = nodeAnimation->mPositionKeys[currentTranslationIndex].mValue;
-    const aiVector3D &nextTranslationVector = nodeAnimation->mPositionKeys[nextTranslationIndex].mValue;
-    const aiVector3D deltaTranslationVector = ((nextTranslationVector - currentTranslationVector) * (float)deltaFactor);
-
-    return currentTranslationVector + deltaTranslationVector;
-
+size_t BoneTransformer::getNumberOfNodes() const {
+    return nodes.size();
 }
 
-unsigned int BoneTransformer::findScalingIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    for (unsigned int i = 0; i < nodeAnimation->mNumScalingKeys - 1; i++) {
-        if(currentAnimationTick < nodeAnimation->mScalingKeys[i + 1].mTime) {
-            return i;
-        }
-    }
-
-    throw std::invalid_argument("Tried to find a scaling index in an animation, but couldn't find it");
+const Pose &BoneTransformer::getBindPose() const {
+    return bindPose;
 }
 
-unsigned int BoneTransformer::findRotationIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    for (unsigned int i = 0; i < nodeAnimation->mNumRotationKeys - 1; i++) {
-        if(currentAnimationTick < nodeAnimation->mRotationKeys[i + 1].mTime) {
-            return i;
-        }
-    }
+size_t BoneTransformer::getNumberOfAnimationClips() const {
+    return animationClips.size();
+}
 
-    throw std::invalid_argument("Tried to find a rotation index in an animation, but couldn't find it");
+const AnimationClip &BoneTransformer::getAnimationClip(size_t index) const {
+    return animationClips[index];
 }
 
-unsigned int BoneTransformer::findTranslationIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation) {
-    for (unsigned int i = 0; i < nodeAnimation->mNumPositionKeys - 1; i++) {
-        if(currentAnimationTick < nodeAnimation->mPositionKeys[i + 1].mTime) {
-            return i;
+int BoneTransformer::getAnimationClipIndex(const std::string &name) const {
+    for (size_t i = 0; i < animationClips.size(); i++) {
+        if (animationClips[i].getName() == name) {
+            return (int)i;
         }
     }
-
-    throw std::invalid_argument("Tried to find a translation index in an animation, but couldn't find it");
+    return -1;
 }
 
-std::vector<chag::float4x4> BoneTransformer::calculateBoneTransforms(float totalElapsedTimeInSeconds) {
-
-    chag::float4x4 rootMatrix = chag::make_identity<chag::float4x4>();
-
-    double currentAnimationTick = getCurrentAnimationTick(totalElapsedTimeInSeconds);
-
-    readNodeHierarchyAndUpdateBoneTransformations((float)currentAnimationTick, assimpScene->mRootNode, rootMatrix);
-
-    std::vector<chag::float4x4> boneTransformMatrices;
-    boneTransformMatrices.resize(numberOfBones);
-    for (int bone = 0; bone < numberOfBones; bone++) {
-        boneTransformMatrices[bone] = boneInfos[bone]->finalTransformation;
-    }
-    return boneTransformMatrices;
+PoseCache &BoneTransformer::getPoseCache() {
+    return poseCache;
 }
 
 int BoneTransformer::createBoneIndexIfAbsent(const aiBone *bone) {
@@ -248,19 +170,14 @@ int BoneTransformer::createBoneIndexIfAbsent(const aiBone *bone) {
 
             boneIndex = numberOfBones;
             numberOfBones++;
+
+            for (SkeletonNode &node : nodes) {
+                if (node.name == boneName) {
+                    node.boneIndex = boneIndex;
+                }
+            }
         } else {
             boneIndex = boneNameToIndexMapping[boneName];
         }
     return boneIndex;
 }
-
-double BoneTransformer::getCurrentAnimationTick(float totalElapsedTimeInSeconds) const {
-    double ticksPerSecond = assimpScene->mAnimations[0]->mTicksPerSecond;
-    ticksPerSecond = ticksPerSecond == 0 ? 25 : ticksPerSecond;
-
-    double elapsedTimeInTicks = totalElapsedTimeInSeconds * ticksPerSecond;
-    double animationDurationInTicks = assimpScene->mAnimations[0]->mDuration;
-    double currentAnimationTick = fmod(elapsedTimeInTicks, animationDurationInTicks);
-    return currentAnimationTick;
-}
-
@@ -22,7 +22,11 @@
 #include <assimp/scene.h>
 #include <map>
 #include <BoneMatrices.h>
-#include <assimp/Importer.hpp>
+#include <BoneTransformScratch.h>
+#include <Pose.h>
+#include <memory>
+#include "animation/AnimationClip.h"
+#include "animation/PoseCache.h"
 #include "linmath/float3.h"
 #include "AABB2.h"
 #include "assimp/material.h"
@@ -47,117 +51,109 @@ class BoneTransformer {
 
 public:
     BoneTransformer() = default;
-    BoneTransformer(aiScene *aiScene);
+    /**
+     * Converts the node hierarchy and animations of the scene. Nothing in the
+     * scene is referenced afterwards, so it can be freed once the bones of
+     * its meshes have been added with createBoneIndexIfAbsent.
+     */
+    BoneTransformer(const aiScene *aiScene);
 
     /**
-    * Calculates the transform to be applied to each bone at the current time.
+    * Calculates the transform to be applied to each bone at the current time,
+    * playing the first animation clip on a loop.
     *
     * @param totalElapsedTimeInSeconds The time since the application was started
     * @return A vector containing the transforms of each bone. The index in the vector corresponds to the bones index. The index of a bone can be found in boneNameToIndexMapping.
     *
     */
-    std::vector<chag::float4x4> calculateBoneTransforms(float totalElapsedTimeInSeconds);
+    std::vector<chag::float4x4> calculateBoneTransforms(float totalElapsedTimeInSeconds) const;
 
     /**
-     * Updates the bonetransformer to include the bone if not already present.
-     *
-     * @param bone The bone to add
-     * @return The index of the bone
+     * Same as above, but writes into an existing vector and works in the
+     * scratch of the animated instance, so that evaluating a pose every frame
+     * does not allocate and instances can be evaluated in parallel.
      */
-    int createBoneIndexIfAbsent(const aiBone *bone);
+    void calculateBoneTransforms(float totalElapsedTimeInSeconds, std::vector<chag::float4x4> &boneTransforms,
+                                 BoneTransformScratch &scratch) const;
 
-
-private:
     /**
-     * Gives the number of ticks that have passed since the animations start
+     * Calculates the transform of each bone from a pose of the skeleton,
+     * e.g. one blended by an AnimationState.
+     *
+     * @param pose The local transformation of each node, in flattened order
+     * @param globalTransformations Scratch space for the global transformation
+     *                              of each node, owned by the caller
      */
-    double getCurrentAnimationTick(float totalElapsedTimeInSeconds) const;
+    void calculateBoneTransforms(const Pose &pose, std::vector<chag::float4x4> &boneTransforms,
+                                 std::vector<chag::float4x4> &globalTransformations) const;
 
     /**
-     * Reads the entire (animation) node hierarchy and updates
-     * the bone transformations in {@code boneInfos} accordingly.
+     * The number of nodes in the skeleton, which is also the size of its poses.
      */
-    void readNodeHierarchyAndUpdateBoneTransformations(float currentAnimationTick, aiNode *currentAssimpNode,
-                                                       chag::float4x4 parentMatrix);
+    size_t getNumberOfNodes() const;
 
     /**
-     * Updates the transformation of the bone corresponding to @{code nodeName}
+     * The local transformation of each node when it is not animated.
      */
-    void updateBoneTransformation(const std::string &nodeName, const chag::float4x4 &globalTransformation);
+    const Pose &getBindPose() const;
 
+    //@{
     /**
-     * A node is a bone if there is a bone named exactly the same as the node
+     * Accesses the animation clips of the mesh, one per animation in the file.
      */
-    bool nodeIsABone(const std::string &nodeName) const;
-
-    chag::float4x4 getCurrentNodeTransformation(float currentAnimationTick, const aiNode *currentAssimpNode,
-                                                const std::string nodeName);
-
-
+    size_t getNumberOfAnimationClips() const;
+    const AnimationClip &getAnimationClip(size_t index) const;
     /**
-     * Interpolates the two animation matrices nearest the current tick
-     *
-     * @param currentAnimationTick The ticks that have passed since animation started
-     * @param nodeAnimation The animation node that is currently 'playing'
-     * @return A matrix in bone space that has interpolated translation, rotation and scaling between the two nearest animations matrices.
+     * @return The index of the clip, -1 if there is no clip with that name
      */
-    chag::float4x4 getInterpolatedAnimationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-
-    //@{
-    /**
-     * Retrieves the interpolation of the two animation matrices nearest the current tick
-     *
-     * @param currentAnimationTick The ticks that have passed since animation started
-     * @param nodeAnimation The animation node that is currently 'playing'
-     * @return A matrix in bone space that has interpolated the two nearest animations matrices.
-     */
-    chag::float4x4 getInterpolatedTranslationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    chag::float4x4 getInterpolatedRotationMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    chag::float4x4 getInterpolatedScalingMatrix(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
+    int getAnimationClipIndex(const std::string &name) const;
     //@}
 
     /**
-     * Given the name of a node, fetches the corresponding animation node.
+     * The poses shared by every instance playing a single clip of this skeleton.
      */
-    const aiNodeAnim *getAnimationNode(const std::string &nodeName);
+    PoseCache &getPoseCache();
 
     /**
-     * Searches through an animations channels for the animation node
+     * Updates the bonetransformer to include the bone if not already present.
+     *
+     * @param bone The bone to add
+     * @return The index of the bone
      */
-    const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string nodeName);
+    int createBoneIndexIfAbsent(const aiBone *bone);
 
-    //@{
+
+private:
     /**
-     * Calculates the interpolation of the two animations nearest the current tick
-     *
-     * @param currentAnimationTick The ticks that have passed since animation started
-     * @param nodeAnimation The animation node that is currently 'playing'
-     * @return An interpolated assimp object
+     * A node of the assimp hierarchy, converted at load so that a pose can
+     * be evaluated with a single loop. Nodes are stored in depth first order,
+     * so a parent is always evaluated before its children.
      */
-    aiVector3D calculateScalingInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    aiQuaternion calculateRotationInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    aiVector3D calculateTranslationInterpolation(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    //@}
+    struct SkeletonNode {
+        // Index of the parent in nodes, -1 for the root node
+        int parentIndex;
+        // Index of the bone named as the node, -1 if the node isn't a bone
+        int boneIndex;
+        // The transformation used when the node isn't animated
+        chag::float4x4 nodeTransformation;
+        // If any of the animation clips animates the node
+        bool animatedByAnyClip;
+        // Only used for matching bones with nodes while loading
+        std::string name;
+    };
 
-    //@{
     /**
-     * Gets the index of the nearest previous key in the animation node
-     *
-     * @param currentAnimationTick The ticks that have passed since animation started
-     * @param nodeAnimation The animation node that is currently 'playing'
-     * @return The index of the nearest previous key
+     * Appends @{code assimpNode} and all of its descendants to nodes
      */
-    unsigned int findScalingIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    unsigned int findRotationIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    unsigned int findTranslationIndexRightBeforeTick(float currentAnimationTick, const aiNodeAnim *nodeAnimation);
-    //@}
+    void flattenNodeHierarchy(const aiNode *assimpNode, int parentIndex);
 
     //Matrix for transforming FROM bone space TO world space
     chag::float4x4 globalInverseTransform;
     std::map<std::string, int> boneNameToIndexMapping;
     std::vector<BoneMatrices*> boneInfos;
-    const aiScene *assimpScene;
+    std::vector<SkeletonNode> nodes;
+    Pose bindPose;
+    std::vector<AnimationClip> animationClips;
+    PoseCache poseCache;
     int numberOfBones;
 };
-
-
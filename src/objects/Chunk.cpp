@@ -18,4 +18,8 @@
 
 
 Chunk::Chunk() {
-}
\ No newline at end of file
+}
+
+unsigned int Chunk::getVertexSize() const {
+    return (hasTangents ? CHUNK_TANGENT_VERTEX_FLOATS : CHUNK_VERTEX_FLOATS) * sizeof(float);
+}
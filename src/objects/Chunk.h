@@ -24,6 +24,13 @@
 #include <BoneMatrices.h>
 #include "BoneInfluenceOnVertex.h"
 
+/**
+ * The number of floats of a vertex, made up of its position, normal and uv.
+ * Chunks with tangents follow them with the tangent and bitangent.
+ */
+#define CHUNK_VERTEX_FLOATS 8
+#define CHUNK_TANGENT_VERTEX_FLOATS 14
+
 class Chunk {
 public:
     Chunk();
@@ -31,25 +38,25 @@ public:
     ~Chunk() {
     }
 
+    /**
+     * The size in bytes of each vertex in m_vertices.
+     */
+    unsigned int getVertexSize() const;
+
     // Data on host
     std::vector<chag::float3> m_positions;
-    std::vector<chag::float3> m_normals;
-    std::vector<chag::float2> m_uvs;
+    // The interleaved vertices, only kept until they are buffered
+    std::vector<float> m_vertices;
     std::vector<unsigned int> m_indices;
-    std::vector<chag::float3> m_tangents;
-    std::vector<chag::float3> m_bittangents;
     std::vector<BoneInfluenceOnVertex> bones;
+    bool hasTangents = false;
 
     // Data on GPU
-    GLuint m_positions_bo;
-    GLuint m_normals_bo;
-    GLuint m_uvs_bo;
-    GLuint m_ind_bo;
-    GLuint m_tangents_bo;
-    GLuint m_bittangents_bo;
-    GLuint bonesBufferObject;
+    GLuint m_vertices_bo = 0;
+    GLuint m_ind_bo = 0;
+    GLuint bonesBufferObject = 0;
     // Vertex Array Object
-    GLuint m_vaob;
+    GLuint m_vaob = 0;
 
     unsigned int materialIndex;
 };
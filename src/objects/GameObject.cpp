@@ -41,6 +41,7 @@
 #include "IComponent.h"
 #include "IRenderComponent.h"
 #include "Octree.h"
+#include "collision/SkinnedCollisionMesh.h"
 
 #define NORMAL_TEXTURE_LOCATION 3
 #define DIFFUSE_TEXTURE_LOCATION 0
@@ -159,6 +160,47 @@ void GameObject::renderEmissive(std::shared_ptr<ShaderProgram> &shaderProgram){
     }
 }
 
+Mesh* GameObject::getInstanceableMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) {
+    if (renderComponent == nullptr || !children.empty()) {
+        return nullptr;
+    }
+    return renderComponent->getInstanceableMesh(shaderProgram);
+}
+
+Mesh* GameObject::getInstanceableShadowMesh(const std::shared_ptr<ShaderProgram> &shaderProgram) {
+    if (renderComponent == nullptr || !children.empty()) {
+        return nullptr;
+    }
+    return renderComponent->getInstanceableShadowMesh(shaderProgram);
+}
+
+void GameObject::addToAnimationStage(AnimationStage &animationStage) {
+    if (renderComponent != nullptr) {
+        renderComponent->addToAnimationStage(animationStage, skinnedCollisionMesh.get());
+    }
+    for (GameObject *child : children) {
+        child->addToAnimationStage(animationStage);
+    }
+}
+
+void GameObject::addToParticleStage(ParticleStage &particleStage) {
+    if (renderComponent != nullptr) {
+        renderComponent->addToParticleStage(particleStage);
+    }
+    for (GameObject *child : children) {
+        child->addToParticleStage(particleStage);
+    }
+}
+
+void GameObject::requestTextureSizes(const chag::float3 &cameraPosition, float pixelsPerUnit) {
+    if (renderComponent != nullptr) {
+        renderComponent->requestTextureSizes(cameraPosition, pixelsPerUnit);
+    }
+    for (GameObject *child : children) {
+        child->requestTextureSizes(cameraPosition, pixelsPerUnit);
+    }
+}
+
 void GameObject::renderShadow(std::shared_ptr<ShaderProgram> &shaderProgram) {
     renderComponent->renderShadow(shaderProgram);
     for (GameObject *child : children) {
@@ -276,7 +318,18 @@ void GameObject::setDynamic(bool isDynamic) {
     dynamicObject = isDynamic;
 }
 
+void GameObject::setAnimatedCollision(bool animated) {
+    if (!animated) {
+        skinnedCollisionMesh = nullptr;
+    } else if (skinnedCollisionMesh == nullptr && collisionMesh->hasAnimations()) {
+        skinnedCollisionMesh = std::unique_ptr<SkinnedCollisionMesh>(new SkinnedCollisionMesh(collisionMesh.get()));
+    }
+}
+
 Octree* GameObject::getOctree() {
+    if (skinnedCollisionMesh != nullptr) {
+        return skinnedCollisionMesh->getOctree();
+    }
     return octree;
 }
 
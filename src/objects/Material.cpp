@@ -0,0 +1,55 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "Material.h"
+#include "glutil/glutil.h"
+#include "constants.h"
+#include "UniformBlocks.h"
+
+void Material::updateUniformBlock() {
+    MaterialBlockStd140 block = {};
+    block.diffuseColor = diffuseColor;
+    block.specularColor = specularColor;
+    block.ambientColor = ambientColor;
+    block.emissiveColor = emissiveColor;
+    block.shininess = specularExponent;
+    block.hasDiffuseTexture = diffuseTexture != NULL;
+    block.hasNormalTexture = bumpMapTexture != NULL;
+    block.hasEmissiveTexture = emissiveTexture != NULL;
+    block.hasTwoChannelNormalTexture = bumpMapTexture != NULL && bumpMapTexture->isTwoChannelNormalMap();
+
+    if (uniformBufferObject == 0) {
+        glGenBuffers(1, &uniformBufferObject);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBufferObject);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialBlockStd140), &block, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    CHECK_GL_ERROR();
+}
+
+void Material::bind() {
+    if (diffuseTexture != NULL) {
+        diffuseTexture->bind(GL_TEXTURE0 + DIFFUSE_TEXTURE_LOCATION);
+    }
+    if (bumpMapTexture != NULL) {
+        bumpMapTexture->bind(GL_TEXTURE0 + NORMAL_TEXTURE_LOCATION);
+    }
+    if (emissiveTexture != NULL) {
+        emissiveTexture->bind(GL_TEXTURE0 + EMISSIVE_TEXTURE_LOCATION);
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BUFFER_OBJECT_MATERIAL_INDEX, uniformBufferObject);
+}
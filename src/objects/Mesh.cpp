@@ -32,6 +32,7 @@
 #include "linmath/float3x3.h"
 #include "BoneTransformer.h"
 #include "Texture.h"
+#include "VirtualIOSystem.h"
 
 using namespace chag;
 
@@ -42,18 +43,91 @@ Mesh::Mesh() {
     numAnimations = 0;
 }
 
+Mesh::~Mesh() {
+    for (Chunk &chunk : m_chunks) {
+        // Imported but never uploaded, e.g. by a headless benchmark
+        if (chunk.m_vaob == 0) {
+            continue;
+        }
+        GLuint buffers[] = { chunk.m_vertices_bo, chunk.m_ind_bo, chunk.bonesBufferObject };
+        glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+        glDeleteVertexArrays(1, &chunk.m_vaob);
+    }
+    for (Material &material : materials) {
+        if (material.uniformBufferObject != 0) {
+            glDeleteBuffers(1, &material.uniformBufferObject);
+        }
+    }
+    for (Triangle *triangle : triangles) {
+        delete triangle;
+    }
+}
+
 void Mesh::loadMesh(const std::string &fileName) {
+    importMesh(fileName);
+    uploadMesh();
+}
+
+void Mesh::importMesh(const std::string &fileName) {
+    bool useCache = ResourceManager::isAssetCacheEnabled();
+    if (useCache && readMeshFile(fileName)) {
+        return;
+    }
+
     Logger::logInfo("Loading mesh " + fileName);
 
+    // Everything is converted while loading, the scene is freed along with the importer
+    Assimp::Importer importer;
+    importer.SetIOHandler(new VirtualIOSystem());
     const aiScene* aiScene = importer.ReadFile(
             fileName.c_str(), aiProcess_GenSmoothNormals | aiProcess_Triangulate | aiProcess_CalcTangentSpace);
 
     if (!aiScene) {
         Logger::logError("Error loading mesh for " + fileName + ". Error message: " + importer.GetErrorString());
     } else {
-        boneTransformer = std::make_shared<BoneTransformer>(BoneTransformer(importer.GetOrphanedScene()));
+        boneTransformer = std::make_shared<BoneTransformer>(aiScene);
         initMesh(aiScene, fileName);
+        if (useCache) {
+            writeMeshFile(fileName);
+        }
+    }
+}
+
+std::vector<std::string> Mesh::getTextureFileNames(TextureRole role) {
+    std::vector<std::string> fileNames;
+    for (MaterialTextureFiles &files : materialTextureFiles) {
+        std::vector<const std::string *> roleFileNames;
+        if (role == TextureRole::NORMAL_MAP) {
+            roleFileNames = { &files.bumpMap };
+        } else {
+            roleFileNames = { &files.diffuse, &files.emissive };
+        }
+        for (const std::string *fileName : roleFileNames) {
+            if (!fileName->empty()) {
+                fileNames.push_back(*fileName);
+            }
+        }
+    }
+    return fileNames;
+}
+
+void Mesh::uploadMesh() {
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        Chunk &chunk = m_chunks[i];
+        setupChunkForRendering(chunk, meshFile.isOpen() ? mappedVertices[i] : chunk.m_vertices.data());
+        std::vector<float>().swap(chunk.m_vertices);
+    }
+    meshFile = VirtualFile();
+    mappedVertices.clear();
+
+    for (size_t i = 0; i < materials.size(); i++) {
+        Material &material = materials[i];
+        material.diffuseTexture = fetchTexture(materialTextureFiles[i].diffuse, TextureRole::COLOR);
+        material.bumpMapTexture = fetchTexture(materialTextureFiles[i].bumpMap, TextureRole::NORMAL_MAP);
+        material.emissiveTexture = fetchTexture(materialTextureFiles[i].emissive, TextureRole::COLOR);
+        material.updateUniformBlock();
     }
+    materialTextureFiles.clear();
 }
 
 void Mesh::initMesh(const aiScene *assimpScene, const std::string &fileNameOfMesh) {
@@ -85,7 +159,6 @@ void Mesh::initChunkFromAiMesh(const aiMesh *paiMesh, Chunk &chunk) {
 
     chunk.materialIndex = paiMesh->mMaterialIndex;
 
-    setupChunkForRendering(chunk);
     m_chunks.push_back(chunk);
 }
 
@@ -106,20 +179,24 @@ void Mesh::assertAllVertexWeightsSumToOne(Chunk &chunk) {
 void Mesh::initVerticesFromAiMesh(const aiMesh *paiMesh, Chunk &chunk) {
     const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
 
+    chunk.hasTangents = paiMesh->HasTangentsAndBitangents();
+    chunk.m_positions.reserve(paiMesh->mNumVertices);
+    chunk.m_vertices.reserve(paiMesh->mNumVertices * chunk.getVertexSize() / sizeof(float));
     for (unsigned int i = 0; i < paiMesh->mNumVertices; i++) {
         const aiVector3D pPos = paiMesh->mVertices[i];
         const aiVector3D pNormal = paiMesh->mNormals[i];
         const aiVector3D pTexCoord = paiMesh->HasTextureCoords(0) ? paiMesh->mTextureCoords[0][i] : Zero3D;
 
         chunk.m_positions.push_back(make_vector(pPos.x, pPos.y, pPos.z));
-        chunk.m_normals.push_back(make_vector(pNormal.x, pNormal.y, pNormal.z));
-        chunk.m_uvs.push_back(make_vector(pTexCoord.x, pTexCoord.y));
+        chunk.m_vertices.insert(chunk.m_vertices.end(), { pPos.x, pPos.y, pPos.z,
+                                                          pNormal.x, pNormal.y, pNormal.z,
+                                                          pTexCoord.x, pTexCoord.y });
 
-        if (paiMesh->HasTangentsAndBitangents()) {
+        if (chunk.hasTangents) {
             const aiVector3D pBitTangents = paiMesh->mBitangents[i];
             const aiVector3D pTangents = paiMesh->mTangents[i];
-            chunk.m_bittangents.push_back(make_vector(pBitTangents.x, pBitTangents.y, pBitTangents.z));
-            chunk.m_tangents.push_back(make_vector(pTangents.x, pTangents.y, pTangents.z));
+            chunk.m_vertices.insert(chunk.m_vertices.end(), { pTangents.x, pTangents.y, pTangents.z,
+                                                              pBitTangents.x, pBitTangents.y, pBitTangents.z });
         }
 
         updateMinAndMax(pPos.x, pPos.y, pPos.z, &m_aabb.minV, &m_aabb.maxV);
@@ -160,11 +237,12 @@ void Mesh::initBonesFromAiMesh(const aiMesh *paiMesh, Chunk &chunk) {
 }
 
 void Mesh::initMaterials(const aiScene *pScene, const std::string &fileNameOfMesh) {
+    materialTextureFiles.resize(pScene->mNumMaterials);
     for (unsigned int i = 0; i < pScene->mNumMaterials; i++) {
         const aiMaterial *material = pScene->mMaterials[i];
         Material m;
 
-        initMaterialTextures(&m, fileNameOfMesh, material);
+        initMaterialTextures(i, fileNameOfMesh, material);
         initMaterialColors(&m, material);
         initMaterialShininess(&m, material);
 
@@ -172,15 +250,17 @@ void Mesh::initMaterials(const aiScene *pScene, const std::string &fileNameOfMes
     }
 }
 
-void Mesh::initMaterialTextures(Material *material, std::string fileNameOfMesh, const aiMaterial *loadedMaterial) {
+void Mesh::initMaterialTextures(unsigned int materialIndex, std::string fileNameOfMesh,
+                                const aiMaterial *loadedMaterial) {
+    MaterialTextureFiles &files = materialTextureFiles[materialIndex];
     if (loadedMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
-        material->diffuseTexture = getTexture(loadedMaterial, fileNameOfMesh, aiTextureType_DIFFUSE);
+        files.diffuse = getTextureFileName(loadedMaterial, fileNameOfMesh, aiTextureType_DIFFUSE);
     }
     if (loadedMaterial->GetTextureCount(aiTextureType_HEIGHT) > 0) {
-        material->bumpMapTexture = getTexture(loadedMaterial, fileNameOfMesh, aiTextureType_HEIGHT);
+        files.bumpMap = getTextureFileName(loadedMaterial, fileNameOfMesh, aiTextureType_HEIGHT);
     }
     if(loadedMaterial->GetTextureCount(aiTextureType_EMISSIVE) > 0){
-        material->emissiveTexture = getTexture(loadedMaterial, fileNameOfMesh, aiTextureType_EMISSIVE);
+        files.emissive = getTextureFileName(loadedMaterial, fileNameOfMesh, aiTextureType_EMISSIVE);
     }
 }
 
@@ -203,17 +283,23 @@ float3 Mesh::getColorFromMaterial(const char* colorTypeString, unsigned int type
     return make_vector(color.r, color.g, color.b);
 }
 
-std::shared_ptr<Texture> Mesh::getTexture(const aiMaterial *material,
-                                          const std::string &fileNameOfMesh,
-                                          aiTextureType type)
+std::string Mesh::getTextureFileName(const aiMaterial *material,
+                                     const std::string &fileNameOfMesh,
+                                     aiTextureType type)
 {
     aiString texturePath;
     if (material->GetTexture(type, 0, &texturePath, NULL, NULL, NULL, NULL, NULL) != AI_SUCCESS) {
-        return NULL;
+        return "";
     }
 
-    std::string absolutePath = getPathOfTexture(fileNameOfMesh, std::string(texturePath.data));
-    return ResourceManager::loadAndFetchTexture(absolutePath);
+    return getPathOfTexture(fileNameOfMesh, std::string(texturePath.data));
+}
+
+std::shared_ptr<Texture> Mesh::fetchTexture(const std::string &fileName, TextureRole role) {
+    if (fileName.empty()) {
+        return NULL;
+    }
+    return ResourceManager::loadAndFetchTexture(fileName, role);
 }
 
 std::string Mesh::getPathOfTexture(const std::string &fileName, std::string textureName) {
@@ -258,34 +344,32 @@ void Mesh::setupSphere(std::vector<float3> *positions) {
 
 
 // TODO(Bubbad) Remove all GL dependencies directly in mesh
-template <typename T>
-void setupGlBuffer(std::vector<T> buffer, GLuint *bufferGLObject, GLuint vertexAttibute, int numbersPerObject,
-                   const void* firstObject, GLenum bufferType, GLuint dataType) {
-    glGenBuffers(1, bufferGLObject);
-    glBindBuffer(bufferType, *bufferGLObject);
-    glBufferData(bufferType, buffer.size() * sizeof(buffer[0]), firstObject, GL_STATIC_DRAW);
-    glVertexAttribPointer(vertexAttibute, numbersPerObject, dataType, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(vertexAttibute);
+void setupVertexAttribute(GLuint vertexAttribute, int numbersPerObject, GLsizei stride, size_t offset) {
+    glVertexAttribPointer(vertexAttribute, numbersPerObject, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offset);
+    glEnableVertexAttribArray(vertexAttribute);
 }
 
-void Mesh::setupChunkForRendering(Chunk &chunk) {
+void Mesh::setupChunkForRendering(Chunk &chunk, const float *vertices) {
     glGenVertexArrays(1, &chunk.m_vaob);
     glBindVertexArray(chunk.m_vaob);
 
-    setupGlBuffer(chunk.m_positions, &chunk.m_positions_bo, 0, 3 , &chunk.m_positions[0].x, GL_ARRAY_BUFFER_ARB, GL_FLOAT);
-    setupGlBuffer(chunk.m_normals, &chunk.m_normals_bo, 1, 3, &chunk.m_normals[0].x, GL_ARRAY_BUFFER_ARB, GL_FLOAT);
-
-    if (chunk.m_uvs.size() > 0) {
-        setupGlBuffer(chunk.m_uvs, &chunk.m_uvs_bo, 2, 2, &chunk.m_uvs[0].x, GL_ARRAY_BUFFER_ARB, GL_FLOAT);
+    GLsizei stride = chunk.getVertexSize();
+    glGenBuffers(1, &chunk.m_vertices_bo);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.m_vertices_bo);
+    glBufferData(GL_ARRAY_BUFFER, chunk.m_positions.size() * stride, vertices, GL_STATIC_DRAW);
+
+    setupVertexAttribute(0, 3, stride, 0);
+    setupVertexAttribute(1, 3, stride, 3 * sizeof(float));
+    setupVertexAttribute(2, 2, stride, 6 * sizeof(float));
+    if (chunk.hasTangents) {
+        setupVertexAttribute(4, 3, stride, 8 * sizeof(float));
+        setupVertexAttribute(5, 3, stride, 11 * sizeof(float));
     }
 
-    setupGlBuffer(chunk.m_indices, &chunk.m_ind_bo, 3, 3, &chunk.m_indices[0], GL_ELEMENT_ARRAY_BUFFER_ARB, GL_FLOAT);
-
-    if (chunk.m_bittangents.size() > 0) {
-        setupGlBuffer(chunk.m_tangents, &chunk.m_tangents_bo, 4, 3, &chunk.m_tangents[0].x, GL_ARRAY_BUFFER_ARB, GL_FLOAT);
-        setupGlBuffer(chunk.m_bittangents, &chunk.m_bittangents_bo, 5, 3,
-                      &chunk.m_bittangents[0].x, GL_ARRAY_BUFFER_ARB, GL_FLOAT);
-    }
+    glGenBuffers(1, &chunk.m_ind_bo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.m_ind_bo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, chunk.m_indices.size() * sizeof(chunk.m_indices[0]),
+                 chunk.m_indices.data(), GL_STATIC_DRAW);
 
     if(chunk.bones.size() > 0 ) {
         glGenBuffers(1, &chunk.bonesBufferObject);
@@ -302,6 +386,19 @@ void Mesh::setupChunkForRendering(Chunk &chunk) {
     }
 }
 
+size_t Mesh::getMemorySize() {
+    size_t memorySize = triangles.size() * sizeof(Triangle);
+    for (Chunk &chunk : m_chunks) {
+        size_t indexData = chunk.m_indices.size() * sizeof(chunk.m_indices[0]);
+        size_t boneData = chunk.bones.size() * sizeof(chunk.bones[0]);
+        // The positions, indices and bones are kept on the host after being buffered
+        memorySize += chunk.m_positions.size() * (sizeof(chunk.m_positions[0]) + chunk.getVertexSize())
+                    + chunk.m_vertices.size() * sizeof(chunk.m_vertices[0])
+                    + (indexData + boneData) * 2;
+    }
+    return memorySize;
+}
+
 AABB* Mesh::getAABB() {
     return &m_aabb;
 }
@@ -315,7 +412,8 @@ void Mesh::createTriangles() {
     }
 }
 
-Triangle* Mesh::createTriangleFromPositions(std::vector<chag::float3> positionBuffer, std::vector<unsigned int> indices, unsigned int startIndex) {
+Triangle* Mesh::createTriangleFromPositions(const std::vector<chag::float3> &positionBuffer,
+                                           const std::vector<unsigned int> &indices, unsigned int startIndex) {
 
     return new Triangle(make_vector(positionBuffer[indices[startIndex + 0]].x,
                                     positionBuffer[indices[startIndex + 0]].y,
@@ -344,6 +442,21 @@ bool Mesh::hasAnimations() {
     return numAnimations != 0;
 }
 
+std::shared_ptr<BoneTransformer> Mesh::getBoneTransformer() {
+    return boneTransformer;
+}
+
+void Mesh::setAnimationTimeQuantisation(float seconds) {
+    if (boneTransformer) {
+        boneTransformer->getPoseCache().setTimeQuantisation(seconds);
+    }
+}
+
 std::vector<float4x4> Mesh::getBoneTransforms(float totalElapsedTimeInSeconds) {
     return boneTransformer->calculateBoneTransforms(totalElapsedTimeInSeconds);
 }
+
+void Mesh::getBoneTransforms(float totalElapsedTimeInSeconds, std::vector<float4x4> &boneTransforms,
+                             BoneTransformScratch &scratch) {
+    boneTransformer->calculateBoneTransforms(totalElapsedTimeInSeconds, boneTransforms, scratch);
+}
@@ -0,0 +1,301 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "Chunk.h"
+#include "Logger.h"
+#include "BoneTransformer.h"
+#include "VirtualIOSystem.h"
+#include "common/MappedFile.h"
+
+#include <assimp/Importer.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace chag;
+
+namespace {
+
+size_t alignOffset(size_t offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+/**
+ * Appends the bytes to the file at the next aligned offset.
+ *
+ * @return The offset of the bytes
+ */
+uint64_t appendToFile(std::vector<char> &file, const void *bytes, size_t size) {
+    file.resize(alignOffset(file.size()));
+    uint64_t offset = file.size();
+    const char *begin = static_cast<const char *>(bytes);
+    file.insert(file.end(), begin, begin + size);
+    return offset;
+}
+
+uint64_t appendFileName(std::vector<char> &file, const std::string &fileName) {
+    if (fileName.empty()) {
+        return 0;
+    }
+    return appendToFile(file, fileName.c_str(), fileName.size() + 1);
+}
+
+bool isInFile(const VirtualFile &file, uint64_t offset, uint64_t size) {
+    return offset % MESH_FILE_ALIGNMENT == 0 && offset <= file.getSize() && size <= file.getSize() - offset;
+}
+
+bool isFileNameInFile(const VirtualFile &file, uint64_t offset) {
+    return offset == 0 || (isInFile(file, offset, 1) &&
+                           memchr(file.getData() + offset, '\0', file.getSize() - offset) != nullptr);
+}
+
+std::string readFileName(const VirtualFile &file, uint64_t offset) {
+    return offset == 0 ? "" : std::string(file.getData() + offset);
+}
+
+void copyVector(const float3 &vector, float (&destination)[3]) {
+    destination[0] = vector.x;
+    destination[1] = vector.y;
+    destination[2] = vector.z;
+}
+
+float3 readVector(const float (&source)[3]) {
+    return make_vector(source[0], source[1], source[2]);
+}
+
+}
+
+bool Mesh::readMeshFile(const std::string &fileName) {
+    VirtualFile file = VirtualFileSystem::openFile(fileName + MESH_FILE_EXTENSION);
+    if (!file.isOpen()) {
+        return false;
+    }
+
+    if (!isInFile(file, 0, sizeof(MeshFileHeader))) {
+        return false;
+    }
+    const MeshFileHeader *header = reinterpret_cast<const MeshFileHeader *>(file.getData());
+    if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION) {
+        return false;
+    }
+
+    // Without the imported file on disk, e.g. when both are in a pack, the binary mesh is all there is to load
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    if (MappedFile::getFileStamp(fileName, sourceSize, sourceModificationTime) &&
+        (sourceSize != header->sourceSize || sourceModificationTime != header->sourceModificationTime)) {
+        Logger::logInfo("Binary mesh of " + fileName + " is out of date");
+        return false;
+    }
+
+    // Validate everything before converting anything, so that a broken file falls back to importing
+    if (!isInFile(file, header->chunksOffset, (uint64_t)header->numChunks * sizeof(MeshFileChunk)) ||
+        !isInFile(file, header->materialsOffset, (uint64_t)header->numMaterials * sizeof(MeshFileMaterial))) {
+        Logger::logWarning("Binary mesh of " + fileName + " is corrupt");
+        return false;
+    }
+    const MeshFileChunk *fileChunks =
+            reinterpret_cast<const MeshFileChunk *>(file.getData() + header->chunksOffset);
+    const MeshFileMaterial *fileMaterials =
+            reinterpret_cast<const MeshFileMaterial *>(file.getData() + header->materialsOffset);
+    for (uint32_t i = 0; i < header->numChunks; i++) {
+        const MeshFileChunk &fileChunk = fileChunks[i];
+        uint64_t vertexSize = (fileChunk.hasTangents ? CHUNK_TANGENT_VERTEX_FLOATS : CHUNK_VERTEX_FLOATS) * sizeof(float);
+        bool valid = fileChunk.materialIndex < header->numMaterials &&
+                     isInFile(file, fileChunk.verticesOffset, fileChunk.numVertices * vertexSize) &&
+                     isInFile(file, fileChunk.indicesOffset, fileChunk.numIndices * (uint64_t)sizeof(unsigned int)) &&
+                     (fileChunk.bonesOffset == 0 ||
+                      isInFile(file, fileChunk.bonesOffset,
+                               fileChunk.numVertices * (uint64_t)sizeof(BoneInfluenceOnVertex)));
+        if (valid) {
+            const unsigned int *indices =
+                    reinterpret_cast<const unsigned int *>(file.getData() + fileChunk.indicesOffset);
+            for (uint32_t j = 0; j < fileChunk.numIndices; j++) {
+                valid = valid && indices[j] < fileChunk.numVertices;
+            }
+        }
+        if (!valid) {
+            Logger::logWarning("Binary mesh of " + fileName + " is corrupt");
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->numMaterials; i++) {
+        for (uint64_t offset : fileMaterials[i].textureFileNameOffsets) {
+            if (!isFileNameInFile(file, offset)) {
+                Logger::logWarning("Binary mesh of " + fileName + " is corrupt");
+                return false;
+            }
+        }
+    }
+
+    Logger::logInfo("Loading binary mesh " + fileName + MESH_FILE_EXTENSION);
+
+    m_aabb.minV = readVector(header->aabbMin);
+    m_aabb.maxV = readVector(header->aabbMax);
+    sphere = Sphere(readVector(header->sphereCenter), header->sphereRadius);
+    numAnimations = header->numAnimations;
+
+    // Only the positions, indices and bones are needed on the host, the vertices are buffered from the file
+    m_chunks.resize(header->numChunks);
+    for (uint32_t i = 0; i < header->numChunks; i++) {
+        const MeshFileChunk &fileChunk = fileChunks[i];
+        Chunk &chunk = m_chunks[i];
+        chunk.materialIndex = fileChunk.materialIndex;
+        chunk.hasTangents = fileChunk.hasTangents != 0;
+
+        const float *vertices = reinterpret_cast<const float *>(file.getData() + fileChunk.verticesOffset);
+        size_t floatsPerVertex = chunk.getVertexSize() / sizeof(float);
+        chunk.m_positions.resize(fileChunk.numVertices);
+        for (uint32_t j = 0; j < fileChunk.numVertices; j++) {
+            const float *position = vertices + j * floatsPerVertex;
+            chunk.m_positions[j] = make_vector(position[0], position[1], position[2]);
+        }
+        mappedVertices.push_back(vertices);
+
+        const unsigned int *indices = reinterpret_cast<const unsigned int *>(file.getData() + fileChunk.indicesOffset);
+        chunk.m_indices.assign(indices, indices + fileChunk.numIndices);
+
+        if (fileChunk.bonesOffset != 0) {
+            const BoneInfluenceOnVertex *bones =
+                    reinterpret_cast<const BoneInfluenceOnVertex *>(file.getData() + fileChunk.bonesOffset);
+            chunk.bones.assign(bones, bones + fileChunk.numVertices);
+        }
+    }
+
+    materialTextureFiles.resize(header->numMaterials);
+    for (uint32_t i = 0; i < header->numMaterials; i++) {
+        const MeshFileMaterial &fileMaterial = fileMaterials[i];
+        Material material;
+        material.diffuseColor = readVector(fileMaterial.diffuseColor);
+        material.ambientColor = readVector(fileMaterial.ambientColor);
+        material.specularColor = readVector(fileMaterial.specularColor);
+        material.emissiveColor = readVector(fileMaterial.emissiveColor);
+        material.specularExponent = fileMaterial.specularExponent;
+        materials.push_back(material);
+
+        materialTextureFiles[i].diffuse = readFileName(file, fileMaterial.textureFileNameOffsets[0]);
+        materialTextureFiles[i].bumpMap = readFileName(file, fileMaterial.textureFileNameOffsets[1]);
+        materialTextureFiles[i].emissive = readFileName(file, fileMaterial.textureFileNameOffsets[2]);
+    }
+
+    createTriangles();
+    meshFile = file;
+
+    if (numAnimations > 0) {
+        importSkeleton(fileName);
+    }
+    return true;
+}
+
+void Mesh::writeMeshFile(const std::string &fileName) {
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    MappedFile::getFileStamp(fileName, header.sourceSize, header.sourceModificationTime);
+    header.numChunks = (uint32_t)m_chunks.size();
+    header.numMaterials = (uint32_t)materials.size();
+    header.numAnimations = numAnimations;
+    copyVector(m_aabb.minV, header.aabbMin);
+    copyVector(m_aabb.maxV, header.aabbMax);
+    copyVector(sphere.getPosition(), header.sphereCenter);
+    header.sphereRadius = sphere.getRadius();
+
+    // The tables are filled in once the offsets of what they point to are known
+    std::vector<char> contents(sizeof(MeshFileHeader));
+    std::vector<MeshFileChunk> fileChunks(m_chunks.size());
+    std::vector<MeshFileMaterial> fileMaterials(materials.size());
+    header.chunksOffset = appendToFile(contents, fileChunks.data(), fileChunks.size() * sizeof(MeshFileChunk));
+    header.materialsOffset = appendToFile(contents, fileMaterials.data(),
+                                          fileMaterials.size() * sizeof(MeshFileMaterial));
+
+    for (size_t i = 0; i < materials.size(); i++) {
+        MeshFileMaterial &fileMaterial = fileMaterials[i];
+        memset(&fileMaterial, 0, sizeof(fileMaterial));
+        copyVector(materials[i].diffuseColor, fileMaterial.diffuseColor);
+        copyVector(materials[i].ambientColor, fileMaterial.ambientColor);
+        copyVector(materials[i].specularColor, fileMaterial.specularColor);
+        copyVector(materials[i].emissiveColor, fileMaterial.emissiveColor);
+        fileMaterial.specularExponent = materials[i].specularExponent;
+        fileMaterial.textureFileNameOffsets[0] = appendFileName(contents, materialTextureFiles[i].diffuse);
+        fileMaterial.textureFileNameOffsets[1] = appendFileName(contents, materialTextureFiles[i].bumpMap);
+        fileMaterial.textureFileNameOffsets[2] = appendFileName(contents, materialTextureFiles[i].emissive);
+    }
+
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        Chunk &chunk = m_chunks[i];
+        MeshFileChunk &fileChunk = fileChunks[i];
+        memset(&fileChunk, 0, sizeof(fileChunk));
+        fileChunk.materialIndex = chunk.materialIndex;
+        fileChunk.hasTangents = chunk.hasTangents ? 1 : 0;
+        fileChunk.numVertices = (uint32_t)chunk.m_positions.size();
+        fileChunk.numIndices = (uint32_t)chunk.m_indices.size();
+        fileChunk.verticesOffset = appendToFile(contents, chunk.m_vertices.data(),
+                                                chunk.m_vertices.size() * sizeof(float));
+        fileChunk.indicesOffset = appendToFile(contents, chunk.m_indices.data(),
+                                               chunk.m_indices.size() * sizeof(unsigned int));
+        if (!chunk.bones.empty()) {
+            fileChunk.bonesOffset = appendToFile(contents, chunk.bones.data(),
+                                                 chunk.bones.size() * sizeof(BoneInfluenceOnVertex));
+        }
+    }
+
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + header.chunksOffset, fileChunks.data(), fileChunks.size() * sizeof(MeshFileChunk));
+    memcpy(contents.data() + header.materialsOffset, fileMaterials.data(),
+           fileMaterials.size() * sizeof(MeshFileMaterial));
+
+    // Written under another name first, so that a crash never leaves a partial binary mesh behind
+    std::string meshFileName = fileName + MESH_FILE_EXTENSION;
+    std::string temporaryFileName = meshFileName + ".tmp";
+    std::ofstream out(temporaryFileName, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+    out.close();
+    if (!out) {
+        Logger::logWarning("Could not write the binary mesh " + meshFileName);
+        std::remove(temporaryFileName.c_str());
+        return;
+    }
+    // Renaming does not replace existing files on all platforms
+    std::remove(meshFileName.c_str());
+    if (std::rename(temporaryFileName.c_str(), meshFileName.c_str()) != 0) {
+        Logger::logWarning("Could not write the binary mesh " + meshFileName);
+        std::remove(temporaryFileName.c_str());
+    }
+}
+
+void Mesh::importSkeleton(const std::string &fileName) {
+    // The vertices are already converted, so none of the post processing is needed
+    Assimp::Importer importer;
+    importer.SetIOHandler(new VirtualIOSystem());
+    const aiScene *aiScene = importer.ReadFile(fileName.c_str(), 0);
+    if (!aiScene) {
+        Logger::logError("Error loading the skeleton of " + fileName + ". Error message: " + importer.GetErrorString());
+        numAnimations = 0;
+        return;
+    }
+
+    // Bones are indexed in the same order as when the mesh was imported
+    boneTransformer = std::make_shared<BoneTransformer>(aiScene);
+    for (unsigned int i = 0; i < aiScene->mNumMeshes; i++) {
+        const aiMesh *paiMesh = aiScene->mMeshes[i];
+        for (unsigned int j = 0; j < paiMesh->mNumBones; j++) {
+            boneTransformer->createBoneIndexIfAbsent(paiMesh->mBones[j]);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * The layout of the binary meshes written next to imported mesh files when
+ * the asset cache is enabled, see Mesh::importMesh. A file starts with a
+ * MeshFileHeader, followed by a MeshFileChunk per chunk, a MeshFileMaterial
+ * per material, the texture file names and finally the vertex data of the
+ * chunks. All offsets are in
+ * bytes from the start of the file and aligned to MESH_FILE_ALIGNMENT, so
+ * the data can be used straight from a memory mapping of the file.
+ *
+ * The file is written with the byte order of the machine that imported the
+ * mesh and is discarded if it was written by another version of the format.
+ */
+
+#define MESH_FILE_EXTENSION ".bmesh"
+// "BMSH" in a little endian file
+#define MESH_FILE_MAGIC 0x48534d42
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 16
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    // The size and modification time of the imported file, to tell if the binary mesh is stale
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint32_t numChunks;
+    uint32_t numMaterials;
+    uint32_t numAnimations;
+    float aabbMin[3];
+    float aabbMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+    uint32_t padding;
+    uint64_t chunksOffset;
+    uint64_t materialsOffset;
+};
+
+struct MeshFileChunk {
+    uint32_t materialIndex;
+    uint32_t hasTangents;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    // The vertices interleaved as in Chunk::m_vertices
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    // A BoneInfluenceOnVertex per vertex, zero if the chunk has no bones
+    uint64_t bonesOffset;
+};
+
+struct MeshFileMaterial {
+    float diffuseColor[3];
+    float ambientColor[3];
+    float specularColor[3];
+    float emissiveColor[3];
+    float specularExponent;
+    uint32_t padding;
+    // The null terminated file names of the diffuse, bump map and emissive textures, zero for none
+    uint64_t textureFileNameOffsets[3];
+};
@@ -18,12 +18,26 @@
 #include <Logger.h>
 #include <StdOutLogHandler.h>
 #include "Texture.h"
+#include <ResourceManager.h>
+#include "VirtualFileSystem.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <mutex>
 
 #define STB_IMAGE_IMPLEMENTATION
 
 #include "stb_image.h"
 
 
+Texture::~Texture() {
+    if (ownsTexture) {
+        glDeleteTextures(1, &textureID);
+    }
+    if (image != nullptr) {
+        stbi_image_free(image);
+    }
+}
+
 void Texture::bind(GLenum textureUnit){
     glActiveTexture(textureUnit);
     glBindTexture(GL_TEXTURE_2D, textureID);
@@ -31,15 +45,81 @@ void Texture::bind(GLenum textureUnit){
 
 void Texture::loadTexture(std::string fileName)
 {
-    stbi_set_flip_vertically_on_load(true);
+    decodeTexture(fileName);
+    uploadTexture();
+}
+
+void Texture::setupImageDecoder()
+{
+    // The flag is global in stb_image, set it once rather than from every loading thread
+    static std::once_flag flipFlag;
+    std::call_once(flipFlag, []() { stbi_set_flip_vertically_on_load(true); });
+}
+
+bool Texture::decodeTexture(const std::string &fileName, int maxSize, TextureRole role)
+{
+    setupImageDecoder();
 
-    int comp;
-    unsigned char* image = stbi_load(fileName.c_str(), &width, &height, &comp, 0);
+    this->fileName = fileName;
+    this->role = role;
+    if (ResourceManager::isAssetCacheEnabled() && readTextureFile(fileName, maxSize)) {
+        return true;
+    }
+
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (file.isOpen()) {
+        image = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.getData()), (int)file.getSize(),
+                                      &width, &height, &components, 0);
+    }
 
     if(image == nullptr) {
         Logger::logError("Couldnt load image "+ fileName);
+        return false;
+    }
+
+    // Compressed the first time it is loaded, the uncompressed image is used if the cache can not be written
+    if (ResourceManager::isAssetCacheEnabled() && writeTextureFile(fileName, hashSource(file), role, image, width, height, components) &&
+        readTextureFile(fileName, maxSize)) {
+        stbi_image_free(image);
+        image = nullptr;
+        return true;
     }
 
+    // Grey images can not hold normals, they are uploaded as they are
+    twoChannelNormalMap = role == TextureRole::NORMAL_MAP && components >= 3;
+    imageLevel = 0;
+    while (maxSize > 0 && std::max(width >> imageLevel, height >> imageLevel) > maxSize) {
+        halveImage(image, std::max(1, width >> imageLevel), std::max(1, height >> imageLevel), components);
+        imageLevel++;
+    }
+    return true;
+}
+
+void Texture::halveImage(unsigned char *image, int width, int height, int components)
+{
+    int halfWidth = std::max(1, width / 2);
+    int halfHeight = std::max(1, height / 2);
+
+    // Box filtered in place, every texel is written after the ones it is averaged from are read
+    for (int y = 0; y < halfHeight; y++) {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < halfWidth; x++) {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < components; c++) {
+                int sum = image[(y0 * width + x0) * components + c] +
+                          image[(y0 * width + x1) * components + c] +
+                          image[(y1 * width + x0) * components + c] +
+                          image[(y1 * width + x1) * components + c];
+                image[(y * halfWidth + x) * components + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+void Texture::uploadTexture()
+{
     GLuint texid;
     glGenTextures(1, &texid);
     glActiveTexture(GL_TEXTURE0);
@@ -47,14 +127,27 @@ void Texture::loadTexture(std::string fileName)
     glBindTexture(GL_TEXTURE_2D, texid);
     CHECK_GL_ERROR();
 
-
-    GLenum format = comp == 3 ? GL_RGB : GL_RGBA;
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA_EXT,
-                 width, height, 0, format, GL_UNSIGNED_BYTE, image);
-
-    CHECK_GL_ERROR();
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (compressedFile.isOpen()) {
+        uploadCompressedLevels();
+    } else {
+        GLenum format = components == 3 ? GL_RGB : GL_RGBA;
+        GLint internalFormat = GL_SRGB_ALPHA_EXT;
+        bitsPerTexel = 32;
+        if (role == TextureRole::NORMAL_MAP) {
+            internalFormat = twoChannelNormalMap ? GL_RG8 : GL_RGBA8;
+            bitsPerTexel = twoChannelNormalMap ? 16 : 32;
+        }
+
+        // Halved images of odd widths have rows that are not four byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
+                     std::max(1, width >> imageLevel), std::max(1, height >> imageLevel), 0,
+                     format, GL_UNSIGNED_BYTE, image);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        CHECK_GL_ERROR();
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
     CHECK_GL_ERROR();
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -65,12 +158,37 @@ void Texture::loadTexture(std::string fileName)
 
     glBindTexture(GL_TEXTURE_2D, 0);
     CHECK_GL_ERROR();
+    if (ownsTexture) {
+        glDeleteTextures(1, &textureID);
+    }
     textureID = texid;
+    ownsTexture = true;
+    residentLevel = imageLevel;
 
     stbi_image_free(image);
+    image = nullptr;
+    compressedFile = VirtualFile();
     Logger::logInfo("Loaded image: " + fileName);
 }
 
+void Texture::swap(Texture &other)
+{
+    std::swap(textureID, other.textureID);
+    std::swap(ownsTexture, other.ownsTexture);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    std::swap(residentLevel, other.residentLevel);
+    std::swap(fileName, other.fileName);
+    std::swap(role, other.role);
+    std::swap(twoChannelNormalMap, other.twoChannelNormalMap);
+    std::swap(bitsPerTexel, other.bitsPerTexel);
+    std::swap(image, other.image);
+    std::swap(components, other.components);
+    std::swap(imageLevel, other.imageLevel);
+    std::swap(compressedFile, other.compressedFile);
+    std::swap(compressedFormat, other.compressedFormat);
+}
+
 int Texture::getHeight() {
     return height;
 }
@@ -79,6 +197,33 @@ int Texture::getWidth() {
     return width;
 }
 
+int Texture::getResidentLevel() {
+    return residentLevel;
+}
+
+int Texture::getBitsPerTexel() {
+    return bitsPerTexel;
+}
+
+const std::string& Texture::getFileName() {
+    return fileName;
+}
+
+TextureRole Texture::getRole() {
+    return role;
+}
+
+bool Texture::isTwoChannelNormalMap() {
+    return twoChannelNormalMap;
+}
+
+size_t Texture::getMemorySize() {
+    if (!ownsTexture) {
+        return 0;
+    }
+    return TextureResidency::getMemorySize(width, height, residentLevel, bitsPerTexel);
+}
+
 GLuint Texture::getID() {
     return textureID;
 };
@@ -0,0 +1,280 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "glutil/glutil.h"
+#include "Texture.h"
+#include "TextureFile.h"
+#include "TextureResidency.h"
+#include "common/BlockCompression.h"
+#include "common/MappedFile.h"
+#include "Logger.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+size_t alignOffset(size_t offset) {
+    return (offset + TEXTURE_FILE_ALIGNMENT - 1) / TEXTURE_FILE_ALIGNMENT * TEXTURE_FILE_ALIGNMENT;
+}
+
+bool isInFile(const VirtualFile &file, uint64_t offset, uint64_t size) {
+    return offset % TEXTURE_FILE_ALIGNMENT == 0 && offset <= file.getSize() && size <= file.getSize() - offset;
+}
+
+bool isValidFormat(uint32_t format) {
+    return format == (uint32_t)BlockFormat::BC1 || format == (uint32_t)BlockFormat::BC3 ||
+           format == (uint32_t)BlockFormat::BC5;
+}
+
+std::vector<unsigned char> expandToRGBA(const unsigned char *image, int width, int height, int components) {
+    size_t numTexels = (size_t)width * height;
+    std::vector<unsigned char> rgba(numTexels * 4);
+    for (size_t i = 0; i < numTexels; i++) {
+        const unsigned char *texel = image + i * components;
+        unsigned char *destination = &rgba[i * 4];
+        // Grey images are one channel, with alpha two
+        bool grey = components < 3;
+        destination[0] = texel[0];
+        destination[1] = grey ? texel[0] : texel[1];
+        destination[2] = grey ? texel[0] : texel[2];
+        destination[3] = components == 2 ? texel[1] : components == 4 ? texel[3] : 255;
+    }
+    return rgba;
+}
+
+BlockFormat chooseFormat(const std::vector<unsigned char> &rgba, int components, TextureRole role) {
+    // Grey images can not hold normals, they are compressed as they are
+    if (role == TextureRole::NORMAL_MAP && components >= 3) {
+        return BlockFormat::BC5;
+    }
+    for (size_t i = 3; i < rgba.size(); i += 4) {
+        if (rgba[i] != 255) {
+            return BlockFormat::BC3;
+        }
+    }
+    return BlockFormat::BC1;
+}
+
+}
+
+uint64_t Texture::hashSource(const VirtualFile &source) {
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(source.getData());
+    for (size_t i = 0; i < source.getSize(); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool Texture::readTextureFile(const std::string &fileName, int maxSize) {
+    std::string textureFileName = fileName + TEXTURE_FILE_EXTENSION;
+    VirtualFile file = VirtualFileSystem::openFile(textureFileName);
+    if (!file.isOpen() || !isInFile(file, 0, sizeof(TextureFileHeader))) {
+        return false;
+    }
+    const TextureFileHeader *header = reinterpret_cast<const TextureFileHeader *>(file.getData());
+    if (header->magic != TEXTURE_FILE_MAGIC || header->version != TEXTURE_FILE_VERSION ||
+        header->role != (uint32_t)role) {
+        return false;
+    }
+
+    // The stamp saves reading the image. Without one, e.g. for an image in a pack, or when
+    // it changed, e.g. by a checkout, the contents decide. Without the image only the compressed texture is left.
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    if (!MappedFile::getFileStamp(fileName, sourceSize, sourceModificationTime) ||
+        sourceSize != header->sourceSize || sourceModificationTime != header->sourceModificationTime) {
+        VirtualFile source = VirtualFileSystem::openFile(fileName);
+        if (source.isOpen() && hashSource(source) != header->sourceHash) {
+            Logger::logInfo("Compressed texture of " + fileName + " is out of date");
+            return false;
+        }
+    }
+
+    // Validate everything before using anything, so that a broken file falls back to compressing the image again
+    bool valid = isValidFormat(header->format) && header->width > 0 && header->height > 0 &&
+                 header->numLevels == (uint32_t)TextureResidency::getNumberOfLevels(header->width, header->height) &&
+                 isInFile(file, alignOffset(sizeof(TextureFileHeader)),
+                          (uint64_t)header->numLevels * sizeof(TextureFileLevel));
+    const TextureFileLevel *levels =
+            reinterpret_cast<const TextureFileLevel *>(file.getData() + alignOffset(sizeof(TextureFileHeader)));
+    for (uint32_t i = 0; valid && i < header->numLevels; i++) {
+        uint32_t levelWidth = std::max(1u, header->width >> i);
+        uint32_t levelHeight = std::max(1u, header->height >> i);
+        valid = levels[i].width == levelWidth && levels[i].height == levelHeight &&
+                levels[i].size == BlockCompression::getCompressedSize((BlockFormat)header->format,
+                                                                      levelWidth, levelHeight) &&
+                isInFile(file, levels[i].offset, levels[i].size);
+    }
+    if (!valid) {
+        Logger::logWarning("Compressed texture " + textureFileName + " is corrupt");
+        return false;
+    }
+
+    width = header->width;
+    height = header->height;
+    components = 4;
+    compressedFormat = header->format;
+    twoChannelNormalMap = header->format == (uint32_t)BlockFormat::BC5;
+    imageLevel = 0;
+    while (maxSize > 0 && imageLevel + 1 < (int)header->numLevels &&
+           std::max(levels[imageLevel].width, levels[imageLevel].height) > (uint32_t)maxSize) {
+        imageLevel++;
+    }
+    compressedFile = file;
+    return true;
+}
+
+bool Texture::writeTextureFile(const std::string &fileName, uint64_t sourceHash, TextureRole role,
+                               const unsigned char *image, int width, int height, int components) {
+    std::vector<unsigned char> rgba = expandToRGBA(image, width, height, components);
+    BlockFormat format = chooseFormat(rgba, components, role);
+
+    TextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    MappedFile::getFileStamp(fileName, header.sourceSize, header.sourceModificationTime);
+    header.sourceHash = sourceHash;
+    header.role = (uint32_t)role;
+    header.format = (uint32_t)format;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.numLevels = (uint32_t)TextureResidency::getNumberOfLevels(width, height);
+
+    // The table is filled in once the offsets of the levels are known
+    std::vector<TextureFileLevel> levels(header.numLevels);
+    size_t levelsOffset = alignOffset(sizeof(TextureFileHeader));
+    size_t offset = alignOffset(levelsOffset + levels.size() * sizeof(TextureFileLevel));
+    for (uint32_t i = 0; i < header.numLevels; i++) {
+        levels[i].width = std::max(1, width >> i);
+        levels[i].height = std::max(1, height >> i);
+        levels[i].offset = offset;
+        levels[i].size = BlockCompression::getCompressedSize(format, levels[i].width, levels[i].height);
+        offset = alignOffset(offset + (size_t)levels[i].size);
+    }
+
+    std::vector<char> contents(offset, 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + levelsOffset, levels.data(), levels.size() * sizeof(TextureFileLevel));
+    for (uint32_t i = 0; i < header.numLevels; i++) {
+        if (i > 0) {
+            halveImage(rgba.data(), levels[i - 1].width, levels[i - 1].height, 4);
+        }
+        BlockCompression::compressImage(format, rgba.data(), levels[i].width, levels[i].height,
+                                        reinterpret_cast<unsigned char *>(contents.data() + levels[i].offset));
+    }
+
+    // Written under another name first, so that a crash never leaves a partial compressed texture behind
+    std::string textureFileName = fileName + TEXTURE_FILE_EXTENSION;
+    std::string temporaryFileName = textureFileName + ".tmp";
+    std::ofstream out(temporaryFileName, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+    out.close();
+    if (!out) {
+        Logger::logWarning("Could not write the compressed texture " + textureFileName);
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+    // Renaming does not replace existing files on all platforms
+    std::remove(textureFileName.c_str());
+    if (std::rename(temporaryFileName.c_str(), textureFileName.c_str()) != 0) {
+        Logger::logWarning("Could not write the compressed texture " + textureFileName);
+        std::remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Texture::transcodeTexture(const std::string &fileName, TextureRole role) {
+    Texture cached;
+    cached.role = role;
+    if (cached.readTextureFile(fileName, 0)) {
+        return true;
+    }
+
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (!file.isOpen()) {
+        return false;
+    }
+    setupImageDecoder();
+    int width, height, components;
+    unsigned char *image = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.getData()),
+                                                 (int)file.getSize(), &width, &height, &components, 0);
+    if (image == nullptr) {
+        Logger::logError("Couldnt load image " + fileName);
+        return false;
+    }
+    bool written = writeTextureFile(fileName, hashSource(file), role, image, width, height, components);
+    stbi_image_free(image);
+    return written;
+}
+
+void Texture::uploadCompressedLevels() {
+    const TextureFileHeader *header = reinterpret_cast<const TextureFileHeader *>(compressedFile.getData());
+    const TextureFileLevel *levels = reinterpret_cast<const TextureFileLevel *>(
+            compressedFile.getData() + alignOffset(sizeof(TextureFileHeader)));
+    BlockFormat format = (BlockFormat)compressedFormat;
+
+    // Colors are sampled in sRGB and everything else linearly, like the uncompressed textures
+    bool linear = role != TextureRole::COLOR;
+    GLenum internalFormat = 0;
+    if (format == BlockFormat::BC5) {
+        if (GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc) {
+            internalFormat = GL_COMPRESSED_RG_RGTC2;
+        }
+    } else if (linear && GLEW_EXT_texture_compression_s3tc) {
+        internalFormat = format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                    : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    } else if (!linear && GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB) {
+        internalFormat = format == BlockFormat::BC1 ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                                                    : GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    }
+    GLint uncompressedFormat = format == BlockFormat::BC5 ? GL_RG8 : linear ? GL_RGBA8 : GL_SRGB_ALPHA_EXT;
+
+    // The whole chain is in the file, so it is uploaded rather than generated
+    std::vector<unsigned char> rgba;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = imageLevel; i < header->numLevels; i++) {
+        const TextureFileLevel &level = levels[i];
+        const unsigned char *blocks = reinterpret_cast<const unsigned char *>(compressedFile.getData() + level.offset);
+        GLint glLevel = (GLint)(i - imageLevel);
+        if (internalFormat != 0) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, glLevel, internalFormat, level.width, level.height, 0,
+                                   (GLsizei)level.size, blocks);
+        } else {
+            // Without the formats the blocks are decompressed, which still saves decoding and filtering the image
+            rgba.resize((size_t)level.width * level.height * 4);
+            BlockCompression::decompressImage(format, blocks, level.width, level.height, rgba.data());
+            glTexImage2D(GL_TEXTURE_2D, glLevel, uncompressedFormat, level.width, level.height, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)(header->numLevels - 1 - imageLevel));
+    CHECK_GL_ERROR();
+
+    if (internalFormat != 0) {
+        bitsPerTexel = (int)(BlockCompression::getBlockSize(format) * 8 / 16);
+    } else {
+        bitsPerTexel = format == BlockFormat::BC5 ? 16 : 32;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * The layout of the compressed textures written next to their images when
+ * the asset cache is enabled, see Texture::decodeTexture. A file starts
+ * with a TextureFileHeader, followed by a TextureFileLevel per mip level,
+ * largest first, and then the blocks of the levels. All offsets are in
+ * bytes from the start of the file and aligned to TEXTURE_FILE_ALIGNMENT,
+ * so the blocks can be uploaded straight from a memory mapping of the file.
+ *
+ * A compressed texture is current while its image has the size and
+ * modification time stored in the header. When the stamp differs, or the
+ * image is only in a pack and has none, the contents of the image are hashed
+ * and compared instead. Without the image at all, the compressed texture is used.
+ *
+ * The file is written with the byte order of the machine that compressed the
+ * image and is discarded if it was written by another version of the format.
+ */
+
+#define TEXTURE_FILE_EXTENSION ".btex"
+// "BTEX" in a little endian file
+#define TEXTURE_FILE_MAGIC 0x58455442
+#define TEXTURE_FILE_VERSION 4
+#define TEXTURE_FILE_ALIGNMENT 16
+
+struct TextureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    // The size and modification time of the image, a quick way to tell that the compressed texture is current
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    // The hash of the contents of the image, which decides when the stamp can not
+    uint64_t sourceHash;
+    // The TextureRole the image was compressed for, which picks the format
+    uint32_t role;
+    // A BlockFormat
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    // Down to one by one texels
+    uint32_t numLevels;
+    uint32_t padding;
+};
+
+struct TextureFileLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
@@ -28,6 +28,13 @@ Triangle::~Triangle(void) {
 
 }
 
+void Triangle::setPoints(float3 p1, float3 p2, float3 p3) {
+	this->p1 = p1;
+	this->p2 = p2;
+	this->p3 = p3;
+	box = calculateBoundingBox();
+}
+
 BoundingBox* Triangle::getBoundingBox(){
 	return &box;
 }
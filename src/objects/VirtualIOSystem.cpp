@@ -0,0 +1,97 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "VirtualIOSystem.h"
+#include <algorithm>
+#include <cstring>
+
+bool VirtualIOSystem::Exists(const char *fileName) const {
+    return VirtualFileSystem::exists(fileName);
+}
+
+char VirtualIOSystem::getOsSeparator() const {
+    return '/';
+}
+
+Assimp::IOStream *VirtualIOSystem::Open(const char *fileName, const char *mode) {
+    // Only reading is supported
+    if (strchr(mode, 'w') != nullptr || strchr(mode, 'a') != nullptr) {
+        return nullptr;
+    }
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (!file.isOpen()) {
+        return nullptr;
+    }
+    return new VirtualIOStream(file);
+}
+
+void VirtualIOSystem::Close(Assimp::IOStream *stream) {
+    delete stream;
+}
+
+VirtualIOStream::VirtualIOStream(const VirtualFile &file) : file(file) {
+}
+
+size_t VirtualIOStream::Read(void *buffer, size_t size, size_t count) {
+    if (size == 0) {
+        return 0;
+    }
+    size_t readCount = std::min(count, (file.getSize() - position) / size);
+    memcpy(buffer, file.getData() + position, readCount * size);
+    position += readCount * size;
+    return readCount;
+}
+
+size_t VirtualIOStream::Write(const void *buffer, size_t size, size_t count) {
+    return 0;
+}
+
+aiReturn VirtualIOStream::Seek(size_t offset, aiOrigin origin) {
+    size_t newPosition;
+    switch (origin) {
+        case aiOrigin_SET:
+            newPosition = offset;
+            break;
+        case aiOrigin_CUR:
+            newPosition = position + offset;
+            break;
+        case aiOrigin_END:
+            // Like assimp's own streams, the offset counts backwards from the end
+            if (offset > file.getSize()) {
+                return aiReturn_FAILURE;
+            }
+            newPosition = file.getSize() - offset;
+            break;
+        default:
+            return aiReturn_FAILURE;
+    }
+    if (newPosition > file.getSize()) {
+        return aiReturn_FAILURE;
+    }
+    position = newPosition;
+    return aiReturn_SUCCESS;
+}
+
+size_t VirtualIOStream::Tell() const {
+    return position;
+}
+
+size_t VirtualIOStream::FileSize() const {
+    return file.getSize();
+}
+
+void VirtualIOStream::Flush() {
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
+#include "VirtualFileSystem.h"
+
+/**
+ * Lets assimp read meshes, and the files they refer to such as material
+ * libraries, through the VirtualFileSystem.
+ *
+ * \code
+ * Assimp::Importer importer;
+ * importer.SetIOHandler(new VirtualIOSystem()); // The importer deletes it
+ * \endcode
+ */
+class VirtualIOSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char *fileName) const override;
+    char getOsSeparator() const override;
+    Assimp::IOStream *Open(const char *fileName, const char *mode = "rb") override;
+    void Close(Assimp::IOStream *stream) override;
+};
+
+/**
+ * A read-only stream over a VirtualFile.
+ */
+class VirtualIOStream : public Assimp::IOStream {
+public:
+    VirtualIOStream(const VirtualFile &file);
+
+    size_t Read(void *buffer, size_t size, size_t count) override;
+    size_t Write(const void *buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t Tell() const override;
+    size_t FileSize() const override;
+    void Flush() override;
+
+private:
+    VirtualFile file;
+    size_t position = 0;
+};
@@ -15,14 +15,22 @@
  * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
  */
 #include <ResourceManager.h>
+#include <algorithm>
+#include <atomic>
 #include "ParticleGenerator.h"
 #include "ParticleRenderer.h"
 #include "constants.h"
 #include "linmath/float3x3.h"
 #include "Camera.h"
-#include "Particle.h"
+#include "ParticlePool.h"
 #include "ParticleConf.h"
+#include "ParticleStage.h"
+#include "GameObject.h"
+#include "Logger.h"
+#include <string>
 
+// The seed of the next ParticleGenerator created
+static std::atomic<uint64_t> nextSeed(0);
 
 ParticleGenerator::ParticleGenerator(int maxParticles,
                                      std::shared_ptr<ParticleRenderer> renderer,
@@ -31,8 +39,10 @@ ParticleGenerator::ParticleGenerator(int maxParticles,
                                    : maxParticles(maxParticles),
                                      renderer(renderer),
                                      conf(conf),
-                                     camera(camera)
+                                     camera(camera),
+                                     random(nextSeed++)
 {
+    particles = std::unique_ptr<ParticlePool>(new ParticlePool((size_t)std::max(maxParticles, 0)));
 }
 
 
@@ -41,25 +51,102 @@ ParticleGenerator::~ParticleGenerator()
 }
 
 void ParticleGenerator::render() {
-    renderer->render(particles, owner->getAbsoluteLocation(), conf);
+    renderer->render(*particles, owner->getAbsoluteLocation(), conf);
+}
+
+void ParticleGenerator::setSeed(uint64_t seed) {
+    random.seed(seed);
+}
+
+const ParticlePool& ParticleGenerator::getParticles() const {
+    return *particles;
+}
+
+void ParticleGenerator::spawnParticle() {
+    chag::float3 position = conf->initialPosition(random);
+    chag::float4 transformed = owner->getModelMatrix() * chag::make_vector(position.x, position.y, position.z, 1.0f);
+    chag::float3 velocity = conf->initialVelocity(random);
+    float lifetime = conf->calcLifetime(random);
+
+    // Such particles die before they are ever drawn, warned about once rather than for every spawn
+    if (lifetime <= 0.0f && !warnedAboutLifetime) {
+        Logger::logWarning("ParticleConf::calcLifetime returned " + std::to_string(lifetime) +
+                           ", particles without a positive lifetime are never drawn");
+        warnedAboutLifetime = true;
+    }
+
+    particles->spawn(chag::make_vector(transformed.x, transformed.y, transformed.z), velocity, lifetime,
+                     conf->initialSize(random));
 }
 
 void ParticleGenerator::update(float dt) {
-    if (particles.empty() && owner != nullptr) {
+    pendingTime += dt;
+    pendingUpdates++;
+}
+
+void ParticleGenerator::addToParticleStage(ParticleStage &particleStage) {
+    particleStage.addGenerator(this);
+}
+
+void ParticleGenerator::simulate(bool throttled) {
+    if (owner == nullptr || pendingUpdates == 0) {
+        return;
+    }
+    if (throttled && pendingUpdates < PARTICLE_THROTTLED_UPDATE_FRAMES) {
+        return;
+    }
+
+    step(pendingTime, pendingUpdates);
+    pendingTime = 0.0f;
+    pendingUpdates = 0;
+}
+
+chag::float3 ParticleGenerator::getEmitterPosition() {
+    return owner->getAbsoluteLocation();
+}
+
+const ParticleConf* ParticleGenerator::getConf() const {
+    return conf.get();
+}
+
+void ParticleGenerator::setBoundingRadius(float boundingRadius) {
+    this->boundingRadius = boundingRadius;
+}
+
+float ParticleGenerator::getBoundingRadius() const {
+    return boundingRadius;
+}
+
+void ParticleGenerator::step(float dt, int updates) {
+    // Configurations overriding the overloads without a Random use getRand, which
+    // must not touch the global rand() state from the worker threads
+    Random *previousRandom = Random::getCurrent();
+    Random::setCurrent(&random);
+
+    if (!spawnedInitialParticles) {
         for (int i = 0; i < maxParticles; i++) {
-            std::unique_ptr<Particle> part(new Particle(*conf, owner->getModelMatrix()));
-            particles.push_back(std::move(part));
+            spawnParticle();
         }
+        spawnedInitialParticles = true;
     }
 
     float distance = length(camera->getPosition() - owner->getAbsoluteLocation());
 
-    for (std::unique_ptr<Particle> &particle : particles) {
-        if (particle->isAlive()){
-            particle->update(dt, distance, *conf);
-        }
-        else if(conf->loop(dt)){
-            particle->reset(*conf, owner->getModelMatrix());
+    // Throttled generators cover several updates at once, which must age and accelerate the particles as much
+    for (int i = 0; i < updates; i++) {
+        conf->accelerateAll(particles->getVelocitiesX(), particles->getVelocitiesY(), particles->getVelocitiesZ(),
+                            particles->getNumberOfParticles(), random);
+    }
+    particles->integrate(dt, dt + (distance * 2) * updates);
+    particles->removeDead();
+
+    // Dead particles are respawned for as long as the configuration loops
+    size_t freeSlots = particles->getCapacity() - particles->getNumberOfParticles();
+    for (size_t i = 0; i < freeSlots; i++) {
+        if (conf->loop(dt)) {
+            spawnParticle();
         }
     }
+
+    Random::setCurrent(previousRandom);
 }
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "ParticleInstanceBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include "ParticlePool.h"
+
+/**
+ * Maps a non negative float to an integer that sorts in the opposite order.
+ */
+static inline uint32_t descendingKey(float key) {
+    uint32_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return ~bits;
+}
+
+void ParticleInstanceBuffer::sortDescending(const float *keys, size_t count,
+                                            std::vector<uint32_t> &order, std::vector<uint32_t> &scratch) {
+    order.resize(count);
+    scratch.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        order[i] = (uint32_t)i;
+    }
+
+    // Least significant digit first, one byte per pass
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; i++) {
+            offsets[(descendingKey(keys[i]) >> shift) & 0xFF]++;
+        }
+
+        // Every key has the same digit, so this pass would not move anything
+        if (count == 0 || offsets[(descendingKey(keys[0]) >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t total = 0;
+        for (size_t &offset : offsets) {
+            size_t digitCount = offset;
+            offset = total;
+            total += digitCount;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = order[i];
+            scratch[offsets[(descendingKey(keys[index]) >> shift) & 0xFF]++] = index;
+        }
+        order.swap(scratch);
+    }
+}
+
+void ParticleInstanceBuffer::build(const ParticlePool &particles, const chag::float3 &cameraPosition,
+                                   size_t maxInstances) {
+    size_t count = particles.getNumberOfParticles();
+    const float *positionsX = particles.getPositionsX();
+    const float *positionsY = particles.getPositionsY();
+    const float *positionsZ = particles.getPositionsZ();
+    const float *sizes = particles.getSizes();
+
+    // The squared distance sorts the same as the distance, without the square root
+    depths.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        float dx = positionsX[i] - cameraPosition.x;
+        float dy = positionsY[i] - cameraPosition.y;
+        float dz = positionsZ[i] - cameraPosition.z;
+        depths[i] = dx * dx + dy * dy + dz * dz;
+    }
+
+    sortDescending(depths.data(), count, order, scratch);
+
+    // The closest particles are last, so skip the ones furthest away
+    size_t first = count - std::min(count, maxInstances);
+
+    instances.resize(count - first);
+    for (size_t i = first; i < count; i++) {
+        uint32_t particle = order[i];
+        instances[i - first] = chag::make_vector(positionsX[particle], positionsY[particle],
+                                                 positionsZ[particle], sizes[particle]);
+    }
+}
+
+const std::vector<chag::float4>& ParticleInstanceBuffer::getInstances() const {
+    return instances;
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "linmath/float3.h"
+#include "linmath/float4.h"
+
+class ParticlePool;
+
+/**
+ * \brief Builds the per instance data for drawing a ParticlePool in one call.
+ *
+ * Every particle gets its squared distance to the camera computed once,
+ * the particles are radix sorted back to front on it and then written
+ * into one float4 per instance: the position in xyz and the size in w.
+ *
+ * Does not touch OpenGL, the ParticleRenderer uploads the instances.
+ */
+class ParticleInstanceBuffer {
+public:
+    /**
+     * Sorts and writes the particles closest to the camera.
+     *
+     * @param maxInstances The number of particles to draw at most. The ones
+     *                     furthest away from the camera are left out.
+     */
+    void build(const ParticlePool &particles, const chag::float3 &cameraPosition, size_t maxInstances);
+
+    /**
+     * The instances written by the last build, the furthest away first.
+     */
+    const std::vector<chag::float4>& getInstances() const;
+
+    /**
+     * Orders [0, count) so that the keys are in descending order.
+     * The keys must not be negative. Particles with equal keys keep their
+     * order since the sort is stable.
+     *
+     * @param scratch Temporary storage, kept by the caller to avoid allocating
+     */
+    static void sortDescending(const float *keys, size_t count,
+                               std::vector<uint32_t> &order, std::vector<uint32_t> &scratch);
+
+private:
+    std::vector<float> depths;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> scratch;
+    std::vector<chag::float4> instances;
+};
@@ -0,0 +1,187 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "ParticlePool.h"
+
+#if defined(__AVX__)
+#define PARTICLE_POOL_USE_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define PARTICLE_POOL_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#define PARTICLE_POOL_PADDING 8
+
+ParticlePool::ParticlePool(size_t capacity) : capacity(capacity) {
+    size_t paddedCapacity = (capacity + PARTICLE_POOL_PADDING - 1) / PARTICLE_POOL_PADDING * PARTICLE_POOL_PADDING;
+    positionX.assign(paddedCapacity, 0.0f);
+    positionY.assign(paddedCapacity, 0.0f);
+    positionZ.assign(paddedCapacity, 0.0f);
+    velocityX.assign(paddedCapacity, 0.0f);
+    velocityY.assign(paddedCapacity, 0.0f);
+    velocityZ.assign(paddedCapacity, 0.0f);
+    life.assign(paddedCapacity, 0.0f);
+    size.assign(paddedCapacity, 0.0f);
+}
+
+size_t ParticlePool::getCapacity() const {
+    return capacity;
+}
+
+size_t ParticlePool::getNumberOfParticles() const {
+    return numberOfParticles;
+}
+
+bool ParticlePool::spawn(const chag::float3 &position, const chag::float3 &velocity, float life, float size) {
+    if (numberOfParticles == capacity) {
+        return false;
+    }
+
+    size_t particle = numberOfParticles++;
+    positionX[particle] = position.x;
+    positionY[particle] = position.y;
+    positionZ[particle] = position.z;
+    velocityX[particle] = velocity.x;
+    velocityY[particle] = velocity.y;
+    velocityZ[particle] = velocity.z;
+    this->life[particle] = life;
+    this->size[particle] = size;
+    return true;
+}
+
+void ParticlePool::integrate(float deltaTime, float lifeLoss) {
+    float velocityScale = deltaTime / 1000.0f;
+    size_t particle = 0;
+
+    // The arrays are padded, so the last batch may run past the live particles
+#if defined(PARTICLE_POOL_USE_AVX)
+    __m256 scale = _mm256_set1_ps(velocityScale);
+    __m256 loss = _mm256_set1_ps(lifeLoss);
+    for (; particle < numberOfParticles; particle += 8) {
+        _mm256_storeu_ps(&positionX[particle], _mm256_add_ps(_mm256_loadu_ps(&positionX[particle]),
+                                                             _mm256_mul_ps(_mm256_loadu_ps(&velocityX[particle]), scale)));
+        _mm256_storeu_ps(&positionY[particle], _mm256_add_ps(_mm256_loadu_ps(&positionY[particle]),
+                                                             _mm256_mul_ps(_mm256_loadu_ps(&velocityY[particle]), scale)));
+        _mm256_storeu_ps(&positionZ[particle], _mm256_add_ps(_mm256_loadu_ps(&positionZ[particle]),
+                                                             _mm256_mul_ps(_mm256_loadu_ps(&velocityZ[particle]), scale)));
+        _mm256_storeu_ps(&life[particle], _mm256_sub_ps(_mm256_loadu_ps(&life[particle]), loss));
+    }
+#elif defined(PARTICLE_POOL_USE_SSE)
+    __m128 scale = _mm_set1_ps(velocityScale);
+    __m128 loss = _mm_set1_ps(lifeLoss);
+    for (; particle < numberOfParticles; particle += 4) {
+        _mm_storeu_ps(&positionX[particle], _mm_add_ps(_mm_loadu_ps(&positionX[particle]),
+                                                       _mm_mul_ps(_mm_loadu_ps(&velocityX[particle]), scale)));
+        _mm_storeu_ps(&positionY[particle], _mm_add_ps(_mm_loadu_ps(&positionY[particle]),
+                                                       _mm_mul_ps(_mm_loadu_ps(&velocityY[particle]), scale)));
+        _mm_storeu_ps(&positionZ[particle], _mm_add_ps(_mm_loadu_ps(&positionZ[particle]),
+                                                       _mm_mul_ps(_mm_loadu_ps(&velocityZ[particle]), scale)));
+        _mm_storeu_ps(&life[particle], _mm_sub_ps(_mm_loadu_ps(&life[particle]), loss));
+    }
+#else
+    for (; particle < numberOfParticles; particle++) {
+        positionX[particle] += velocityX[particle] * velocityScale;
+        positionY[particle] += velocityY[particle] * velocityScale;
+        positionZ[particle] += velocityZ[particle] * velocityScale;
+        life[particle] -= lifeLoss;
+    }
+#endif
+}
+
+size_t ParticlePool::removeDead() {
+    size_t removed = 0;
+    size_t particle = 0;
+    while (particle < numberOfParticles) {
+        if (life[particle] > 0.0f) {
+            particle++;
+            continue;
+        }
+
+        // Move the last particle here and check it next
+        size_t last = --numberOfParticles;
+        positionX[particle] = positionX[last];
+        positionY[particle] = positionY[last];
+        positionZ[particle] = positionZ[last];
+        velocityX[particle] = velocityX[last];
+        velocityY[particle] = velocityY[last];
+        velocityZ[particle] = velocityZ[last];
+        life[particle] = life[last];
+        size[particle] = size[last];
+        removed++;
+    }
+    return removed;
+}
+
+float* ParticlePool::getPositionsX() {
+    return positionX.data();
+}
+
+float* ParticlePool::getPositionsY() {
+    return positionY.data();
+}
+
+float* ParticlePool::getPositionsZ() {
+    return positionZ.data();
+}
+
+float* ParticlePool::getVelocitiesX() {
+    return velocityX.data();
+}
+
+float* ParticlePool::getVelocitiesY() {
+    return velocityY.data();
+}
+
+float* ParticlePool::getVelocitiesZ() {
+    return velocityZ.data();
+}
+
+const float* ParticlePool::getPositionsX() const {
+    return positionX.data();
+}
+
+const float* ParticlePool::getPositionsY() const {
+    return positionY.data();
+}
+
+const float* ParticlePool::getPositionsZ() const {
+    return positionZ.data();
+}
+
+const float* ParticlePool::getVelocitiesX() const {
+    return velocityX.data();
+}
+
+const float* ParticlePool::getVelocitiesY() const {
+    return velocityY.data();
+}
+
+const float* ParticlePool::getVelocitiesZ() const {
+    return velocityZ.data();
+}
+
+const float* ParticlePool::getLives() const {
+    return life.data();
+}
+
+const float* ParticlePool::getSizes() const {
+    return size.data();
+}
+
+chag::float3 ParticlePool::getPosition(size_t particle) const {
+    return chag::make_vector(positionX[particle], positionY[particle], positionZ[particle]);
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "linmath/float3.h"
+
+/**
+ * \brief The particles of a ParticleGenerator, stored as a structure of arrays.
+ *
+ * The pool has a fixed capacity and keeps its live particles packed at
+ * the front. A dead particle is removed by moving the last live particle
+ * into its slot, so the order of the particles changes as they die.
+ *
+ * Each attribute is a separate array padded to a multiple of eight, so
+ * integrate can work on four (SSE) or eight (AVX) particles at a time.
+ */
+class ParticlePool {
+public:
+    ParticlePool(size_t capacity);
+
+    size_t getCapacity() const;
+    size_t getNumberOfParticles() const;
+
+    /**
+     * Adds a particle after the live ones.
+     *
+     * @param life The lifetime of the particle in milliseconds
+     * @param size How much the particle is scaled, on top of ParticleConf::calcParticleScale
+     * @return False if the pool is full
+     */
+    bool spawn(const chag::float3 &position, const chag::float3 &velocity, float life, float size);
+
+    /**
+     * Moves every particle by its velocity and shortens its life.
+     *
+     * @param deltaTime Time since last update in milliseconds
+     * @param lifeLoss How many milliseconds of life every particle loses
+     */
+    void integrate(float deltaTime, float lifeLoss);
+
+    /**
+     * Swap removes all particles whose life has run out.
+     *
+     * @return The number of particles removed
+     */
+    size_t removeDead();
+
+    //@{
+    /**
+     * The attributes of the live particles, getNumberOfParticles() long.
+     */
+    float* getPositionsX();
+    float* getPositionsY();
+    float* getPositionsZ();
+    float* getVelocitiesX();
+    float* getVelocitiesY();
+    float* getVelocitiesZ();
+    const float* getPositionsX() const;
+    const float* getPositionsY() const;
+    const float* getPositionsZ() const;
+    const float* getVelocitiesX() const;
+    const float* getVelocitiesY() const;
+    const float* getVelocitiesZ() const;
+    const float* getLives() const;
+    const float* getSizes() const;
+    //@}
+
+    chag::float3 getPosition(size_t particle) const;
+
+private:
+    size_t capacity;
+    size_t numberOfParticles = 0;
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> life;
+    std::vector<float> size;
+};
@@ -22,10 +22,12 @@
 
 #include "Camera.h"
 #include "ShaderProgram.h"
-#include "Particle.h"
+#include "ParticlePool.h"
+#include "ParticleInstanceBuffer.h"
 #include "ParticleRenderer.h"
 #include "ParticleConf.h"
 #include "Texture.h"
+#include <algorithm>
 
 
 ParticleRenderer::ParticleRenderer(std::shared_ptr<Texture> texture,
@@ -33,7 +35,8 @@ ParticleRenderer::ParticleRenderer(std::shared_ptr<Texture> texture,
                                    std::shared_ptr<ShaderProgram> shaderProgram)
                                  : texture(texture),
                                    camera(camera),
-                                   shaderProgram(shaderProgram)
+                                   shaderProgram(shaderProgram),
+                                   instanceBuffer(new ParticleInstanceBuffer())
 {
     GLfloat quad[] = { //POSITION3 TEXCOORD2
         0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
@@ -57,6 +60,13 @@ ParticleRenderer::ParticleRenderer(std::shared_ptr<Texture> texture,
     
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+    // Position and size of each particle, filled every render
+    glGenBuffers(1, &instanceBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+    glEnableVertexAttribArray(PARTICLE_INSTANCE_LOCATION_GPU);
+    glVertexAttribPointer(PARTICLE_INSTANCE_LOCATION_GPU, 4, GL_FLOAT, GL_FALSE, sizeof(chag::float4), 0);
+    glVertexAttribDivisor(PARTICLE_INSTANCE_LOCATION_GPU, 1);
     
     /* CLEANUP */
     glBindVertexArray(0);
@@ -65,6 +75,7 @@ ParticleRenderer::ParticleRenderer(std::shared_ptr<Texture> texture,
 
 ParticleRenderer::~ParticleRenderer()
 {
+    glDeleteBuffers(1, &instanceBufferObject);
 
 }
 
@@ -78,7 +89,7 @@ std::shared_ptr<ShaderProgram> ParticleRenderer::defaultShader()
     return shaderProgram;
 }
 
-void ParticleRenderer::render(std::vector<std::unique_ptr<Particle>> &particles,
+void ParticleRenderer::render(const ParticlePool &particles,
                               const chag::float3 &position,
                               const std::shared_ptr<ParticleConf> &conf) {
     glDisable(GL_CULL_FACE);
@@ -88,6 +99,8 @@ void ParticleRenderer::render(std::vector<std::unique_ptr<Particle>> &particles,
     shaderProgram->backupCurrentShaderProgram();
     shaderProgram->use();
     
+    // Particles are small but many overlap, keep their texture whole
+    ResourceManager::requestTextureSize(texture.get(), (float)std::max(texture->getWidth(), texture->getHeight()));
     texture->bind(GL_TEXTURE0);
     
     shaderProgram->setUniform3f("color", chag::make_vector(1.0f, 1.0f, 1.0f));
@@ -102,36 +115,25 @@ void ParticleRenderer::render(std::vector<std::unique_ptr<Particle>> &particles,
     chag::float3x3 modelMatrix3x3 = make_matrix(r, uprim, n);
     
     float distance = length(camera->getPosition() - position);
-    int maxParticles = (int)(particles.size() * LOD_FACTOR / distance );
-    glBindVertexArray(vaob);
-    
+    float maxParticles = particles.getCapacity() * LOD_FACTOR / distance;
 
-    // Sort the particles
-    std::sort(particles.begin(), particles.end(), [this] (const std::unique_ptr<Particle> &p1,
-                                                              const std::unique_ptr<Particle> &p2)
-    {
-        float l1 = length(camera->getPosition() - p1->getPosition());
-        float l2 = length(camera->getPosition() - p2->getPosition());
-    
-        return l1 > l2;
-    });
+    instanceBuffer->build(particles, camera->getPosition(),
+                          maxParticles < particles.getCapacity() ? (size_t)maxParticles : particles.getCapacity());
+    const std::vector<chag::float4> &instances = instanceBuffer->getInstances();
 
-    // Render the particles
-    int iterations = 0;
+    if (!instances.empty()) {
+        // Respecifying the whole store orphans the buffer drawn from last frame
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(chag::float4), instances.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    chag::float3 scale = conf->calcParticleScale() * (1.0 + distance / LINEAR_SCALE_FACTOR);
-    chag::float4x4 scaleMatrix = chag::make_scale<chag::float4x4>(scale);
-    for (std::unique_ptr<Particle> &particle : particles) {
-        if (iterations > maxParticles) { break; }
-        iterations++;
-    
-        if (particle->isAlive()) {
-            chag::float4x4 modelMatrix4x4 = make_matrix(modelMatrix3x3, particle->getPosition())
-                                          * scaleMatrix;
-             
-            shaderProgram->setUniformMatrix4fv("modelMatrix", modelMatrix4x4);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
+        chag::float3 scale = conf->calcParticleScale() * (1.0 + distance / LINEAR_SCALE_FACTOR);
+        shaderProgram->setUniformMatrix4fv("billboardMatrix",
+                                           make_matrix(modelMatrix3x3, chag::make_vector(0.0f, 0.0f, 0.0f)));
+        shaderProgram->setUniform3f("particleScale", scale);
+
+        glBindVertexArray(vaob);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)instances.size());
     }
     
     /* CLEANUP */
@@ -0,0 +1,83 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#include "ParticleStage.h"
+#include <algorithm>
+#include <cmath>
+#include "JobSystem.h"
+#include "ParticleGenerator.h"
+
+void ParticleStage::clear() {
+    generators.clear();
+}
+
+void ParticleStage::addGenerator(ParticleGenerator *generator) {
+    generators.push_back(generator);
+}
+
+size_t ParticleStage::getNumberOfGenerators() const {
+    return generators.size();
+}
+
+void ParticleStage::simulate(const chag::float4x4 &viewProjectionMatrix, const chag::float3 &cameraPosition) {
+    sortedGenerators = generators;
+    std::stable_sort(sortedGenerators.begin(), sortedGenerators.end(),
+                     [](ParticleGenerator *g1, ParticleGenerator *g2) {
+        return g1->getConf() < g2->getConf();
+    });
+
+    groupStarts.clear();
+    for (size_t i = 0; i < sortedGenerators.size(); i++) {
+        if (i == 0 || sortedGenerators[i]->getConf() != sortedGenerators[i - 1]->getConf()) {
+            groupStarts.push_back(i);
+        }
+    }
+    groupStarts.push_back(sortedGenerators.size());
+
+    JobSystem::parallelFor(groupStarts.size() - 1, [&](size_t group) {
+        for (size_t i = groupStarts[group]; i < groupStarts[group + 1]; i++) {
+            ParticleGenerator *generator = sortedGenerators[i];
+            chag::float3 emitterPosition = generator->getEmitterPosition();
+
+            bool throttled = length(emitterPosition - cameraPosition) > PARTICLE_THROTTLE_DISTANCE
+                          || !isSphereInFrustum(viewProjectionMatrix, emitterPosition,
+                                                generator->getBoundingRadius());
+            generator->simulate(throttled);
+        }
+    });
+}
+
+bool ParticleStage::isSphereInFrustum(const chag::float4x4 &viewProjectionMatrix,
+                                      const chag::float3 &center, float radius) {
+    const chag::float4x4 &m = viewProjectionMatrix;
+
+    // The planes are sums and differences of the rows of the matrix, with
+    // the normals pointing into the frustum
+    for (int row = 0; row < 3; row++) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            float a = m.c1.w + sign * m.c1[row];
+            float b = m.c2.w + sign * m.c2[row];
+            float c = m.c3.w + sign * m.c3[row];
+            float d = m.c4.w + sign * m.c4[row];
+
+            float normalLength = std::sqrt(a * a + b * b + c * c);
+            if (a * center.x + b * center.y + c * center.z + d < -radius * normalLength) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -28,6 +28,13 @@ FragmentShader::FragmentShader(std::string shaderName) {
     checkErrors();
 }
 
+FragmentShader* FragmentShader::fromSource(const std::string &source) {
+    FragmentShader *shader = new FragmentShader();
+    shader->shaderString = source;
+    shader->compile();
+    return shader;
+}
+
 void FragmentShader::compile() {
     fragmentShader = compileShader(GL_FRAGMENT_SHADER, shaderString.c_str());
     checkErrors();
@@ -35,6 +35,11 @@ public:
     FragmentShader() {};
     FragmentShader(std::string shaderName);
 
+    /**
+     * Compiles a shader from source that has already been read, e.g. on a loading thread.
+     */
+    static FragmentShader* fromSource(const std::string &source);
+
     virtual void compile();
     virtual void checkErrors();
     virtual GLuint getGLId();
@@ -17,9 +17,14 @@
 #include "ShaderProgram.h"
 #include "Logger.h"
 #include "VertexShader.h"
+#include "VirtualFileSystem.h"
+#include <atomic>
+#include <cstring>
 
 #define MAX_LOG_SIZE 1024
 
+static std::atomic<unsigned int> nextGeneration(1);
+
 ShaderProgram::ShaderProgram() {
 
 }
@@ -29,6 +34,12 @@ void ShaderProgram::loadShader(IShader *vertexShader, IShader *fragmentShader) {
     this->fragmentShader = fragmentShader;
     createProgram(vertexShader->getGLId(), fragmentShader->getGLId());
     linkProgram();
+    uniformLocations.clear();
+    generation = nextGeneration++;
+}
+
+unsigned int ShaderProgram::getGeneration() const {
+    return generation;
 }
 
 void ShaderProgram::createProgram(GLuint vertexShader, GLuint fragmentShader) {
@@ -71,7 +82,7 @@ void ShaderProgram::restorePreviousShaderProgram() {
     glUseProgram(previousShaderProgram);
 }
 
-GLint ShaderProgram::getUniformLocation(const std::string name) {
+GLint ShaderProgram::getUniformLocation(const std::string &name) {
     std::map<std::string, GLint>::iterator it = uniformLocations.find(name);
     if(it != uniformLocations.end()) {
         return it->second;
@@ -82,36 +93,72 @@ GLint ShaderProgram::getUniformLocation(const std::string name) {
     }
 }
 
-void ShaderProgram::setUniform1i(std::string name, int value) {
-    glUniform1i(getUniformLocation(name), value);
+UniformHandle ShaderProgram::getUniformHandle(const std::string &name) {
+    return getUniformLocation(name);
+}
+
+void ShaderProgram::setUniform1i(const std::string &name, int value) {
+    setUniform1i(getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform1f(const std::string &name, float value) {
+    setUniform1f(getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform2f(const std::string &name, const chag::float2 &value) {
+    setUniform2f(getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform3f(const std::string &name, const chag::float3 &value){
+    setUniform3f(getUniformLocation(name), value);
 }
 
-void ShaderProgram::setUniform1f(std::string name, float value) {
-    glUniform1f(getUniformLocation(name), value);
+void ShaderProgram::setUniform4f(const std::string &name, const chag::float4 &value) {
+    setUniform4f(getUniformLocation(name), value);
 }
 
-void ShaderProgram::setUniform3f(std::string name, chag::float3 value){
-    glUniform3fv(getUniformLocation(name),1, &value.x);
+void ShaderProgram::setUniformMatrix4fv(const std::string &name, const chag::float4x4 &matrix) {
+    setUniformMatrix4fv(getUniformLocation(name), matrix);
 }
 
-void ShaderProgram::setUniform4f(std::string name, chag::float4 value) {
-    glUniform4fv(getUniformLocation(name),1,&value.x);
+void ShaderProgram::setUniform1i(UniformHandle handle, int value) {
+    glUniform1i(handle, value);
 }
 
-void ShaderProgram::setUniformMatrix4fv(std::string name, chag::float4x4 matrix) {
-    glUniformMatrix4fv(getUniformLocation(name), 1, false, &matrix.c1.x);
+void ShaderProgram::setUniform1f(UniformHandle handle, float value) {
+    glUniform1f(handle, value);
 }
 
-void ShaderProgram::setUniform2f(std::string name, chag::float2 value) {
-    glUniform2fv(getUniformLocation(name),1,&value.x);
+void ShaderProgram::setUniform2f(UniformHandle handle, const chag::float2 &value) {
+    glUniform2fv(handle, 1, &value.x);
 }
 
-void ShaderProgram::setUniformBufferObjectBinding(std::string bufferName, int index) {
-    GLuint matricesUniform = glGetUniformBlockIndex(shaderID, bufferName.c_str());
-    glUniformBlockBinding(shaderID, matricesUniform, index);
+void ShaderProgram::setUniform3f(UniformHandle handle, const chag::float3 &value) {
+    glUniform3fv(handle, 1, &value.x);
 }
 
-void ShaderProgram::initUniformBufferObject(std::string bufferName, int size, int index) {
+void ShaderProgram::setUniform4f(UniformHandle handle, const chag::float4 &value) {
+    glUniform4fv(handle, 1, &value.x);
+}
+
+void ShaderProgram::setUniformMatrix4fv(UniformHandle handle, const chag::float4x4 &matrix) {
+    glUniformMatrix4fv(handle, 1, false, &matrix.c1.x);
+}
+
+void ShaderProgram::setUniformMatrix4fv(UniformHandle handle, const chag::float4x4 *matrices, int count) {
+    glUniformMatrix4fv(handle, count, false, &matrices->c1.x);
+}
+
+void ShaderProgram::setUniformBufferObjectBinding(const std::string &bufferName, int index) {
+    GLuint blockIndex = glGetUniformBlockIndex(shaderID, bufferName.c_str());
+    if (blockIndex == GL_INVALID_INDEX) {
+        // The block is not used by this program, nothing to bind.
+        return;
+    }
+    glUniformBlockBinding(shaderID, blockIndex, index);
+}
+
+void ShaderProgram::initUniformBufferObject(const std::string &bufferName, int size, int index) {
     GLuint uniformBufferObject;
     glGenBuffers(1, &uniformBufferObject);
     glBindBuffer(GL_UNIFORM_BUFFER, uniformBufferObject);
@@ -124,30 +171,23 @@ void ShaderProgram::initUniformBufferObject(std::string bufferName, int size, in
     uniformLocations.insert(std::pair<std::string, GLint>(bufferName, uniformBufferObject));
 }
 
-void ShaderProgram::setUniformBufferSubData(std::string bufferName, int offset, int size, const GLvoid *data) {
+void ShaderProgram::setUniformBufferSubData(const std::string &bufferName, int offset, int size, const GLvoid *data) {
     glBindBuffer(GL_UNIFORM_BUFFER, getUniformLocation(bufferName));
-    glFinish();
     glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 const char *textFileRead(const char *fn, bool fatalError) {
 
-    FILE *fp;
     char *content = NULL;
-    int count = 0;
 
     if (fn != NULL) {
-        fp = fopen(fn, "rt");
-        if (fp != NULL) {
-            fseek(fp, 0, SEEK_END);
-            count = ftell(fp);
-            fseek(fp, 0, SEEK_SET);
-
-            if (count > 0) {
-                content = new char[count+1];
-                count = fread( content, sizeof(char), count, fp);
-                content[count] = '\0';
+        VirtualFile file = VirtualFileSystem::openFile(fn);
+        if (file.isOpen()) {
+            if (file.getSize() > 0) {
+                content = new char[file.getSize() + 1];
+                memcpy(content, file.getData(), file.getSize());
+                content[file.getSize()] = '\0';
             } else {
                 if (fatalError) {
                     char buffer[256];
@@ -155,8 +195,6 @@ const char *textFileRead(const char *fn, bool fatalError) {
                     fatal_error(buffer);
                 }
             }
-
-            fclose(fp);
         } else {
             if (fatalError) {
                 char buffer[256];
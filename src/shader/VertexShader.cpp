@@ -30,6 +30,13 @@ VertexShader::VertexShader(std::string shaderName) {
     checkErrors();
 }
 
+VertexShader* VertexShader::fromSource(const std::string &source) {
+    VertexShader *shader = new VertexShader();
+    shader->shaderString = source;
+    shader->compile();
+    return shader;
+}
+
 void VertexShader::compile() {
     vertexShader = compileShader(GL_VERTEX_SHADER, shaderString.c_str());
     checkErrors();
@@ -39,6 +39,11 @@ public:
     VertexShader() {};
     VertexShader(std::string shaderName);
 
+    /**
+     * Compiles a shader from source that has already been read, e.g. on a loading thread.
+     */
+    static VertexShader* fromSource(const std::string &source);
+
     virtual void compile();
     virtual void checkErrors();
     virtual GLuint getGLId();
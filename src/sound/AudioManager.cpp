@@ -22,26 +22,39 @@
 #include "AudioManager.h"
 #include <sstream>
 #include <Logger.h>
+#include <VirtualFileSystem.h>
 
 
 std::map<std::string, sf::Music*> AudioManager::musics;
 std::map<std::string, sf::SoundBuffer> AudioManager::soundBuffers;
+std::map<std::string, VirtualFile> AudioManager::musicFiles;
 
 
 sf::Sound* AudioManager::loadAndFetchSound(const std::string &fileName){
     try {
         return getSoundBuffer(fileName);
     } catch (std::invalid_argument exception) {
-        loadSoundBuffer(fileName);
+        if (!loadSoundBuffer(fileName)) {
+            return nullptr;
+        }
         return getSoundBuffer(fileName);
     }
 }
 
-void AudioManager::loadSoundBuffer(const std::string &fileName) {
+bool AudioManager::loadSoundBuffer(const std::string &fileName) {
     sf::SoundBuffer soundBuffer;
-    soundBuffer.loadFromFile(fileName);
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (!file.isOpen()) {
+        Logger::logError("Could not open the sound " + fileName);
+        return false;
+    }
+    if (!soundBuffer.loadFromMemory(file.getData(), file.getSize())) {
+        Logger::logError("Could not load the sound " + fileName);
+        return false;
+    }
 
     soundBuffers.insert(std::pair<std::string, sf::SoundBuffer>(fileName, soundBuffer));
+    return true;
 }
 
 sf::Sound* AudioManager::getSoundBuffer(std::string fileName){
@@ -56,16 +69,30 @@ sf::Music* AudioManager::loadAndFetchMusic(const std::string &fileName) {
     try {
         return getMusic(fileName);
     } catch (std::invalid_argument exception) {
-        loadMusic(fileName);
+        if (!loadMusic(fileName)) {
+            return nullptr;
+        }
         return getMusic(fileName);
     }
 }
 
-void AudioManager::loadMusic(const std::string &fileName) {
+bool AudioManager::loadMusic(const std::string &fileName) {
+    // Music is streamed from the file while it plays, so the file is kept open
+    VirtualFile file = VirtualFileSystem::openFile(fileName);
+    if (!file.isOpen()) {
+        Logger::logError("Could not open the music " + fileName);
+        return false;
+    }
     sf::Music *music = new sf::Music();
-    music->openFromFile(fileName);
+    if (!music->openFromMemory(file.getData(), file.getSize())) {
+        Logger::logError("Could not load the music " + fileName);
+        delete music;
+        return false;
+    }
+    musicFiles[fileName] = file;
 
     musics.insert(std::pair<std::string, sf::Music*>(fileName, music));
+    return true;
 }
 
 sf::Music* AudioManager::getMusic(std::string fileName) {
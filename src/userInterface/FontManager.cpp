@@ -121,14 +121,27 @@ void FontManager::initTexture() {
     glTexStorage2D(GL_TEXTURE_2D,1,GL_R8,atlasWidth,atlasHeight);
 }
 
-void FontManager::iterateGlyphs(FontDefinition def, unsigned int* width, unsigned int* height) {
+FT_Face FontManager::openFace(const std::string &path) {
+    auto it = loadedFaces.find(path);
+    if(it != loadedFaces.end())
+        return it->second.face;
+
+    LoadedFace loaded;
+    loaded.file = VirtualFileSystem::openFile(path);
+    if(int error = FT_New_Memory_Face(*ft_library,reinterpret_cast<const FT_Byte*>(loaded.file.getData()),
+                                      loaded.file.getSize(),0,&loaded.face)){
+        Logger::logError("Failed loading face '" + path + "'. Error code: " + std::to_string(error));
+        return nullptr;
+    }
+    // Moving the file keeps its mapping, so the face still reads valid memory
+    return loadedFaces.insert(std::make_pair(path,std::move(loaded))).first->second.face;
+}
 
-    FT_Face face = (FT_Face)malloc(sizeof(FT_Face));
+void FontManager::iterateGlyphs(FontDefinition def, unsigned int* width, unsigned int* height) {
 
-    if(int error = FT_New_Face(*ft_library,def.face.c_str(),0,&face)){
-        Logger::logError("Failed loading face '" + def.face + "'. Error code: " + std::to_string(error));
+    FT_Face face = openFace(def.face);
+    if(face == nullptr)
         return;
-    }
     FT_Set_Pixel_Sizes(face,0,def.pixelSize);
     FT_GlyphSlot glyph = face->glyph;
 
@@ -147,17 +160,14 @@ void FontManager::iterateGlyphs(FontDefinition def, unsigned int* width, unsigne
 
 void FontManager::drawGlyphs() {
 
-    FT_Face face;
     int x = 0;
     for(auto fontIt : loadedFonts){
 
         Font* font = fontIt.second;
         FontDefinition fDef = fontIt.first;
-        if(int error = FT_New_Face(*ft_library,fDef.face.c_str(),0,&face)){
-            Logger::logError("Failed loading face '" + fDef.face
-                             + "'. Error code: " + std::to_string(error));
+        FT_Face face = openFace(fDef.face);
+        if(face == nullptr)
             continue;
-        }
         FT_Set_Pixel_Sizes(face,0,fDef.pixelSize);
         FT_GlyphSlot glyph = face->glyph;
 
@@ -192,7 +202,12 @@ FontManager::FontManager() {
 }
 
 FontManager::~FontManager() {
+    for(auto &faceIt : loadedFaces)
+        FT_Done_Face(faceIt.second.face);
+    loadedFaces.clear();
+
     if (ft_library != nullptr) {
+        FT_Done_FreeType(*ft_library);
         free(ft_library);
     }
 }
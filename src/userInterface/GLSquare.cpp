@@ -24,6 +24,7 @@
 #include <IHudDrawable.h>
 #include <ResourceManager.h>
 #include <Globals.h>
+#include <algorithm>
 
 void GLSquare::render(std::shared_ptr<ShaderProgram> shaderProgram, chag::float4x4* projectionMatrix) {
 
@@ -75,6 +76,7 @@ void GLSquare::bindTextureAndDraw(std::shared_ptr<ShaderProgram> shaderProgram,
     shaderProgram->setUniform4f("borderColor",graphic->getBorderColor());
 
     if(graphic->isTextureElseColor()) {
+        ResourceManager::requestTextureSize(graphic->getTexture(), std::max(width * scale.x, height * scale.y));
         graphic->getTexture()->bind(GL_TEXTURE0);
         shaderProgram->setUniform1i("isTexture",true);
         shaderProgram->setUniform1i("isColor",false);
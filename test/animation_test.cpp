@@ -0,0 +1,404 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <assimp/anim.h>
+#include <assimp/scene.h>
+#include "catch.hpp"
+#include "Pose.h"
+#include "AnimationState.h"
+#include "animation/AnimationClip.h"
+#include "animation/PoseCache.h"
+#include "animation/CompressedTrack.h"
+#include "objects/BoneTransformer.h"
+
+using namespace chag;
+
+static const float HALF_SQRT2 = 0.70710678f;
+
+static float4 rotationAroundZ(float radians) {
+    return make_vector(0.0f, 0.0f, std::sin(radians / 2.0f), std::cos(radians / 2.0f));
+}
+
+static void requireRotation(const float4 &actual, const float4 &expected) {
+    REQUIRE(actual.x == Approx(expected.x).epsilon(0.0001));
+    REQUIRE(actual.y == Approx(expected.y).epsilon(0.0001));
+    REQUIRE(actual.z == Approx(expected.z).epsilon(0.0001));
+    REQUIRE(actual.w == Approx(expected.w).epsilon(0.0001));
+}
+
+TEST_CASE("NewPoseNodesAreIdentity", "[Animation]") {
+    Pose pose(3);
+    REQUIRE(pose.size() == 3);
+    for (size_t node = 0; node < pose.size(); node++) {
+        REQUIRE(pose.getTranslation(node).x == 0.0f);
+        REQUIRE(pose.getRotation(node).w == 1.0f);
+        REQUIRE(pose.getScale(node).y == 1.0f);
+    }
+}
+
+TEST_CASE("BlendInterpolatesEveryNode", "[Animation]") {
+    // Six nodes, so both a full batch of four and a padded batch are blended
+    Pose from(6), to(6), result;
+    for (size_t node = 0; node < 6; node++) {
+        from.setNode(node, make_vector((float)node, 0.0f, 0.0f), rotationAroundZ(0.0f), make_vector(1.0f, 1.0f, 1.0f));
+        to.setNode(node, make_vector((float)node, 2.0f, 0.0f), rotationAroundZ((float)M_PI / 2.0f), make_vector(3.0f, 1.0f, 1.0f));
+    }
+
+    Pose::blend(from, to, 0.5f, result);
+
+    REQUIRE(result.size() == 6);
+    for (size_t node = 0; node < 6; node++) {
+        REQUIRE(result.getTranslation(node).x == Approx((float)node));
+        REQUIRE(result.getTranslation(node).y == Approx(1.0f));
+        REQUIRE(result.getScale(node).x == Approx(2.0f));
+        requireRotation(result.getRotation(node), rotationAroundZ((float)M_PI / 4.0f));
+    }
+}
+
+TEST_CASE("BlendTakesTheShortestPath", "[Animation]") {
+    Pose from(1), to(1), result;
+    float4 rotation = rotationAroundZ(1.0f);
+    from.setNode(0, make_vector(0.0f, 0.0f, 0.0f), rotation, make_vector(1.0f, 1.0f, 1.0f));
+    // The same rotation, but on the other side of the hypersphere
+    to.setNode(0, make_vector(0.0f, 0.0f, 0.0f), make_vector(-rotation.x, -rotation.y, -rotation.z, -rotation.w),
+               make_vector(1.0f, 1.0f, 1.0f));
+
+    Pose::blend(from, to, 0.5f, result);
+
+    requireRotation(result.getRotation(0), rotation);
+}
+
+TEST_CASE("AdditiveLayerAppliesDifferenceFromReference", "[Animation]") {
+    Pose base(1), additive(1), reference(1), result;
+    base.setNode(0, make_vector(1.0f, 0.0f, 0.0f), rotationAroundZ(0.0f), make_vector(2.0f, 2.0f, 2.0f));
+    reference.setNode(0, make_vector(0.0f, 1.0f, 0.0f), rotationAroundZ((float)M_PI / 2.0f), make_vector(1.0f, 1.0f, 1.0f));
+    additive.setNode(0, make_vector(0.0f, 3.0f, 0.0f), rotationAroundZ((float)M_PI), make_vector(2.0f, 1.0f, 1.0f));
+
+    Pose::addAdditive(base, additive, reference, 1.0f, result);
+    REQUIRE(result.getTranslation(0).x == Approx(1.0f));
+    REQUIRE(result.getTranslation(0).y == Approx(2.0f));
+    REQUIRE(result.getScale(0).x == Approx(4.0f));
+    REQUIRE(result.getScale(0).y == Approx(2.0f));
+    requireRotation(result.getRotation(0), rotationAroundZ((float)M_PI / 2.0f));
+
+    Pose::addAdditive(base, additive, reference, 0.5f, result);
+    REQUIRE(result.getTranslation(0).y == Approx(1.0f));
+    REQUIRE(result.getScale(0).x == Approx(3.0f));
+    requireRotation(result.getRotation(0), rotationAroundZ((float)M_PI / 4.0f));
+}
+
+static void requireSamePose(const Pose &actual, const Pose &expected) {
+    REQUIRE(actual.size() == expected.size());
+    for (size_t node = 0; node < expected.size(); node++) {
+        REQUIRE(actual.getTranslation(node).x == Approx(expected.getTranslation(node).x));
+        REQUIRE(actual.getTranslation(node).y == Approx(expected.getTranslation(node).y));
+        REQUIRE(actual.getTranslation(node).z == Approx(expected.getTranslation(node).z));
+        REQUIRE(actual.getScale(node).x == Approx(expected.getScale(node).x));
+        REQUIRE(actual.getScale(node).y == Approx(expected.getScale(node).y));
+        REQUIRE(actual.getScale(node).z == Approx(expected.getScale(node).z));
+        requireRotation(actual.getRotation(node), expected.getRotation(node));
+    }
+}
+
+TEST_CASE("ScalarBlendingMatchesTheDefaultPath", "[Animation]") {
+    // Seven nodes, some on the far side of the hypersphere, some with zero reference scales
+    Pose base(7), additive(7), reference(7);
+    for (size_t node = 0; node < 7; node++) {
+        float angle = (float)node * 0.9f;
+        float4 rotation = rotationAroundZ(angle);
+        if (node % 2 == 1) {
+            rotation = make_vector(-rotation.x, -rotation.y, -rotation.z, -rotation.w);
+        }
+        base.setNode(node, make_vector((float)node, 1.0f, -2.0f), rotationAroundZ(-angle),
+                     make_vector(1.0f, 2.0f, 0.5f));
+        additive.setNode(node, make_vector(3.0f, (float)node, 0.5f), rotation,
+                         make_vector(2.0f, 1.0f, (float)node));
+        reference.setNode(node, make_vector(0.0f, 1.0f, 0.0f), rotationAroundZ(angle / 2.0f),
+                          make_vector(node % 3 == 0 ? 0.0f : 1.0f, 2.0f, 1.0f));
+    }
+
+    Pose result, scalarResult;
+    Pose::blend(base, additive, 0.3f, result);
+    Pose::blendScalar(base, additive, 0.3f, scalarResult);
+    requireSamePose(result, scalarResult);
+
+    Pose::addAdditive(base, additive, reference, 0.7f, result);
+    Pose::addAdditiveScalar(base, additive, reference, 0.7f, scalarResult);
+    requireSamePose(result, scalarResult);
+}
+
+TEST_CASE("BlendingRejectsPosesOfDifferentSizes", "[Animation]") {
+    Pose small(3), large(5), result;
+    REQUIRE_THROWS_AS(Pose::blend(small, large, 0.5f, result), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(Pose::blendScalar(small, large, 0.5f, result), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(Pose::addAdditive(small, small, large, 0.5f, result), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(Pose::addAdditiveScalar(large, small, large, 0.5f, result), const std::invalid_argument&);
+}
+
+TEST_CASE("AnimationClipSamplesBetweenKeys", "[Animation]") {
+    aiAnimation animation;
+    animation.mName = aiString("move");
+    animation.mDuration = 10.0;
+    animation.mTicksPerSecond = 10.0;
+    animation.mNumChannels = 1;
+    animation.mChannels = new aiNodeAnim*[1];
+
+    aiNodeAnim *channel = new aiNodeAnim();
+    channel->mNodeName = aiString("moved");
+    channel->mNumPositionKeys = 2;
+    channel->mPositionKeys = new aiVectorKey[2];
+    channel->mPositionKeys[0] = aiVectorKey(0.0, aiVector3D(0.0f, 0.0f, 0.0f));
+    channel->mPositionKeys[1] = aiVectorKey(10.0, aiVector3D(10.0f, 0.0f, 0.0f));
+    channel->mNumRotationKeys = 2;
+    channel->mRotationKeys = new aiQuatKey[2];
+    channel->mRotationKeys[0] = aiQuatKey(0.0, aiQuaternion(1.0f, 0.0f, 0.0f, 0.0f));
+    channel->mRotationKeys[1] = aiQuatKey(10.0, aiQuaternion(HALF_SQRT2, 0.0f, 0.0f, HALF_SQRT2));
+    channel->mNumScalingKeys = 1;
+    channel->mScalingKeys = new aiVectorKey[1];
+    channel->mScalingKeys[0] = aiVectorKey(0.0, aiVector3D(1.0f, 1.0f, 1.0f));
+    animation.mChannels[0] = channel;
+
+    std::vector<std::string> nodeNames;
+    nodeNames.push_back("root");
+    nodeNames.push_back("moved");
+    Pose bindPose(2);
+    bindPose.setNode(0, make_vector(0.0f, 5.0f, 0.0f), rotationAroundZ(0.0f), make_vector(1.0f, 1.0f, 1.0f));
+
+    AnimationClip clip(&animation, nodeNames, bindPose);
+    REQUIRE(clip.getName() == "move");
+    REQUIRE(clip.getDurationInSeconds() == Approx(1.0f));
+    REQUIRE(!clip.animatesNode(0));
+    REQUIRE(clip.animatesNode(1));
+
+    Pose pose;
+    KeyframeCache keyframeCache;
+    clip.sample(0.5f, true, pose, keyframeCache);
+    REQUIRE(pose.getTranslation(0).y == Approx(5.0f));
+    REQUIRE(pose.getTranslation(1).x == Approx(5.0f));
+    requireRotation(pose.getRotation(1), rotationAroundZ((float)M_PI / 4.0f));
+
+    // Looping wraps around, and the cached keys must not be reused blindly
+    clip.sample(1.25f, true, pose, keyframeCache);
+    REQUIRE(pose.getTranslation(1).x == Approx(2.5f));
+
+    clip.sample(1.25f, false, pose, keyframeCache);
+    REQUIRE(pose.getTranslation(1).x == Approx(10.0f));
+}
+
+TEST_CASE("PoseCacheSharesQuantisedTimes", "[Animation]") {
+    PoseCache cache;
+    long long step, otherStep;
+
+    // Times are only snapped once asked to
+    REQUIRE(cache.getTimeQuantisation() == 0.0f);
+    REQUIRE(cache.quantise(0.52f, 1.0f, step) == 0.52f);
+
+    cache.setTimeQuantisation(0.1f);
+    REQUIRE(cache.quantise(0.52f, 1.0f, step) == Approx(0.5f));
+    cache.quantise(0.48f, 1.0f, otherStep);
+    REQUIRE(step == otherStep);
+
+    // Never rounded past the end of the clip
+    long long lastStep;
+    REQUIRE(cache.quantise(0.99f, 0.97f, lastStep) == Approx(0.9f));
+
+    // Every instance at the pose gets the palette inserted first
+    std::shared_ptr<const std::vector<float4x4>> boneTransforms =
+            std::make_shared<const std::vector<float4x4>>(1, make_translation(make_vector(1.0f, 2.0f, 3.0f)));
+    std::shared_ptr<const std::vector<float4x4>> later =
+            std::make_shared<const std::vector<float4x4>>(1, make_identity<float4x4>());
+    REQUIRE(cache.find(0, true, step) == nullptr);
+    REQUIRE(cache.insert(0, true, step, boneTransforms) == boneTransforms);
+    REQUIRE(cache.insert(0, true, step, later) == boneTransforms);
+    REQUIRE(cache.find(0, true, step) == boneTransforms);
+    REQUIRE(cache.find(1, true, step) == nullptr);
+    REQUIRE(cache.find(0, false, step) == nullptr);
+
+    // Cleared every frame, while the palettes handed out stay valid
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.find(0, true, step) == nullptr);
+    REQUIRE(boneTransforms->at(0) == make_translation(make_vector(1.0f, 2.0f, 3.0f)));
+}
+
+TEST_CASE("CompressedTracksDropRedundantKeys", "[Animation]") {
+    std::vector<float> times;
+    std::vector<float3> positions;
+    std::vector<float4> rotations;
+    for (int key = 0; key <= 10; key++) {
+        times.push_back((float)key);
+        // Linear up to key 5, then back again
+        positions.push_back(make_vector((float)std::min(key, 10 - key), 1.0f, -2.0f));
+        rotations.push_back(rotationAroundZ((float)M_PI * key / 20.0f));
+    }
+
+    CompressedVectorTrack positionTrack(times, positions, ANIMATION_COMPRESSION_POSITION_TOLERANCE);
+    REQUIRE(positionTrack.getNumberOfKeys() == 3);
+    unsigned int cachedIndex = 0;
+    for (int key = 0; key <= 10; key++) {
+        float3 position = positionTrack.sample((float)key, cachedIndex, make_vector(0.0f, 0.0f, 0.0f));
+        REQUIRE(position.x == Approx(positions[key].x).epsilon(0.001));
+        REQUIRE(position.y == Approx(1.0f).epsilon(0.001));
+        REQUIRE(position.z == Approx(-2.0f).epsilon(0.001));
+    }
+
+    CompressedRotationTrack rotationTrack(times, rotations, ANIMATION_COMPRESSION_ROTATION_TOLERANCE);
+    REQUIRE(rotationTrack.getNumberOfKeys() == 2);
+    cachedIndex = 0;
+    requireRotation(rotationTrack.sample(3.0f, cachedIndex, rotations[0]), rotations[3]);
+
+    std::vector<float> constantTimes(3, 0.0f);
+    std::vector<float3> constant(3, make_vector(1.0f, 1.0f, 1.0f));
+    constantTimes[1] = 1.0f;
+    constantTimes[2] = 2.0f;
+    REQUIRE(CompressedVectorTrack(constantTimes, constant, ANIMATION_COMPRESSION_SCALE_TOLERANCE).getNumberOfKeys() == 1);
+}
+
+TEST_CASE("SmallestThreeRoundTrips", "[Animation]") {
+    float4 rotations[] = {
+        make_vector(0.0f, 0.0f, 0.0f, 1.0f),
+        make_vector(0.0f, 0.0f, 0.0f, -1.0f),
+        make_vector(0.5f, -0.5f, 0.5f, -0.5f),
+        make_vector(0.1825742f, 0.3651484f, 0.5477226f, 0.7302967f),
+        make_vector(-0.9f, 0.3f, 0.3f, 0.0f)
+    };
+    for (float4 rotation : rotations) {
+        float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y +
+                                 rotation.z * rotation.z + rotation.w * rotation.w);
+        rotation = rotation * (1.0f / length);
+
+        uint16_t packed[3];
+        CompressedRotationTrack::encode(rotation, packed);
+        float4 decoded = CompressedRotationTrack::decode(packed);
+        float dot = rotation.x * decoded.x + rotation.y * decoded.y + rotation.z * decoded.z + rotation.w * decoded.w;
+        REQUIRE(std::fabs(dot) == Approx(1.0f).epsilon(0.00001));
+    }
+}
+
+/**
+ * A root with a single bone, which sways and bobs with a key every tick.
+ */
+static aiScene* createSwayingScene() {
+    aiScene *scene = new aiScene();
+    scene->mRootNode = new aiNode("root");
+    aiNode *bone = new aiNode("bone");
+    bone->mParent = scene->mRootNode;
+    scene->mRootNode->mNumChildren = 1;
+    scene->mRootNode->mChildren = new aiNode*[1];
+    scene->mRootNode->mChildren[0] = bone;
+
+    const unsigned int numberOfKeys = 40;
+    aiAnimation *animation = new aiAnimation();
+    animation->mName = aiString("sway");
+    animation->mDuration = numberOfKeys - 1;
+    animation->mTicksPerSecond = 30.0;
+    animation->mNumChannels = 1;
+    animation->mChannels = new aiNodeAnim*[1];
+
+    aiNodeAnim *channel = new aiNodeAnim();
+    channel->mNodeName = aiString("bone");
+    channel->mNumPositionKeys = numberOfKeys;
+    channel->mPositionKeys = new aiVectorKey[numberOfKeys];
+    channel->mNumRotationKeys = numberOfKeys;
+    channel->mRotationKeys = new aiQuatKey[numberOfKeys];
+    for (unsigned int key = 0; key < numberOfKeys; key++) {
+        channel->mPositionKeys[key] = aiVectorKey(key, aiVector3D(0.0f, 1.0f + 0.5f * std::sin(key * 0.3f), 0.0f));
+        channel->mRotationKeys[key] = aiQuatKey(key, aiQuaternion(aiVector3D(0.0f, 0.0f, 1.0f), std::sin(key * 0.4f)));
+    }
+    channel->mNumScalingKeys = 1;
+    channel->mScalingKeys = new aiVectorKey[1];
+    channel->mScalingKeys[0] = aiVectorKey(0.0, aiVector3D(1.0f, 1.0f, 1.0f));
+    animation->mChannels[0] = channel;
+
+    scene->mNumAnimations = 1;
+    scene->mAnimations = new aiAnimation*[1];
+    scene->mAnimations[0] = animation;
+    return scene;
+}
+
+TEST_CASE("LegacyBoneTransformsPlayTheFirstClip", "[Animation]") {
+    std::unique_ptr<aiScene> scene(createSwayingScene());
+    BoneTransformer skeleton(scene.get());
+    aiBone bone;
+    bone.mName = aiString("bone");
+    skeleton.createBoneIndexIfAbsent(&bone);
+    REQUIRE(skeleton.getAnimationClip(0).isCompressed());
+
+    std::vector<std::string> nodeNames;
+    nodeNames.push_back("root");
+    nodeNames.push_back("bone");
+    AnimationClip uncompressedClip(scene->mAnimations[0], nodeNames, skeleton.getBindPose(), false);
+    REQUIRE(!uncompressedClip.isCompressed());
+
+    Pose pose;
+    KeyframeCache keyframeCache, compressedKeyframeCache;
+    BoneTransformScratch scratch;
+    std::vector<float4x4> expected, legacy, compressed, globalTransformations;
+    for (int frame = 0; frame < 80; frame++) {
+        float time = frame / 60.0f;
+        uncompressedClip.sample(time, true, pose, keyframeCache);
+        skeleton.calculateBoneTransforms(pose, expected, globalTransformations);
+
+        // The legacy path plays the same compressed clip as an AnimationState
+        skeleton.getAnimationClip(0).sample(time, true, pose, compressedKeyframeCache);
+        skeleton.calculateBoneTransforms(pose, compressed, globalTransformations);
+        skeleton.calculateBoneTransforms(time, legacy, scratch);
+        REQUIRE(legacy.size() == 1);
+        REQUIRE(legacy[0] == compressed[0]);
+
+        // Which stays within the compression tolerance of the full precision keys
+        for (size_t column = 1; column <= 4; column++) {
+            for (size_t row = 1; row <= 4; row++) {
+                REQUIRE(std::fabs(compressed[0](row, column) - expected[0](row, column)) < 0.001f);
+            }
+        }
+    }
+}
+
+TEST_CASE("AnimationStatesShareQuantisedPoses", "[Animation]") {
+    std::unique_ptr<aiScene> scene(createSwayingScene());
+    std::shared_ptr<BoneTransformer> skeleton = std::make_shared<BoneTransformer>(scene.get());
+    aiBone bone;
+    bone.mName = aiString("bone");
+    skeleton->createBoneIndexIfAbsent(&bone);
+
+    AnimationState first(skeleton), second(skeleton);
+    first.update(0.51f);
+    second.update(0.52f);
+
+    // Without a quantisation every state evaluates its own pose
+    first.evaluate();
+    second.evaluate();
+    REQUIRE(&first.getBoneTransforms() != &second.getBoneTransforms());
+    REQUIRE(skeleton->getPoseCache().size() == 0);
+
+    skeleton->getPoseCache().setTimeQuantisation(0.1f);
+    first.evaluate();
+    second.evaluate();
+    REQUIRE(&first.getBoneTransforms() == &second.getBoneTransforms());
+    REQUIRE(skeleton->getPoseCache().size() == 1);
+
+    // The AnimationStage clears the cache every frame, the palette stays valid until evaluated again
+    const std::vector<float4x4> shared = first.getBoneTransforms();
+    skeleton->getPoseCache().clear();
+    REQUIRE(second.getBoneTransforms() == shared);
+}
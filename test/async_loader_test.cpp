@@ -0,0 +1,84 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include <atomic>
+#include <thread>
+#include "catch.hpp"
+#include "Misc/AsyncLoader.h"
+
+TEST_CASE("AsyncLoaderUploadsOnTheCallingThread", "[Resources]") {
+    AsyncLoader loader(2);
+    std::thread::id callingThread = std::this_thread::get_id();
+
+    const int numberOfTasks = 16;
+    std::vector<int> loaded(numberOfTasks, 0);
+    std::vector<int> uploaded(numberOfTasks, 0);
+    std::atomic<int> uploadsOnOtherThreads(0);
+
+    for (int i = 0; i < numberOfTasks; i++) {
+        loader.submit([&loaded, i]() { loaded[i] = i; },
+                      [&, i]() {
+                          if (std::this_thread::get_id() != callingThread) {
+                              uploadsOnOtherThreads++;
+                          }
+                          uploaded[i] = loaded[i] + 1;
+                          return true;
+                      });
+    }
+
+    while (loader.getNumberOfPendingTasks() > 0) {
+        loader.processUploads(-1.0);
+        std::this_thread::yield();
+    }
+
+    REQUIRE(uploadsOnOtherThreads == 0);
+    for (int i = 0; i < numberOfTasks; i++) {
+        REQUIRE(uploaded[i] == i + 1);
+    }
+}
+
+TEST_CASE("AsyncLoaderFinishWaitsForDependencies", "[Resources]") {
+    AsyncLoader loader(1);
+
+    bool dependencyUploaded = false;
+    bool dependentUploaded = false;
+    std::shared_ptr<AsyncLoader::Task> dependency = loader.submit(
+        []() { std::this_thread::sleep_for(std::chrono::milliseconds(10)); },
+        [&dependencyUploaded]() { dependencyUploaded = true; return true; });
+
+    // Retried until the dependency has been uploaded
+    std::shared_ptr<AsyncLoader::Task> dependent = loader.submit(
+        []() { },
+        [&]() {
+            if (!dependencyUploaded) {
+                return false;
+            }
+            dependentUploaded = true;
+            return true;
+        });
+
+    loader.finish(dependent);
+    REQUIRE(dependencyUploaded);
+    REQUIRE(dependentUploaded);
+    REQUIRE(loader.getNumberOfPendingTasks() == 0);
+
+    // Already uploaded tasks are skipped
+    loader.processUploads(-1.0);
+    REQUIRE(loader.getNumberOfPendingTasks() == 0);
+}
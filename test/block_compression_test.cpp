@@ -0,0 +1,99 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "catch.hpp"
+#include "common/BlockCompression.h"
+
+namespace {
+
+std::vector<unsigned char> roundTrip(BlockFormat format, const std::vector<unsigned char> &image, int width, int height) {
+    std::vector<unsigned char> blocks(BlockCompression::getCompressedSize(format, width, height));
+    BlockCompression::compressImage(format, image.data(), width, height, blocks.data());
+    std::vector<unsigned char> decompressed(image.size());
+    BlockCompression::decompressImage(format, blocks.data(), width, height, decompressed.data());
+    return decompressed;
+}
+
+int getMaximumError(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b, int channels) {
+    int error = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if ((int)(i % 4) < channels) {
+            error = std::max(error, std::abs(a[i] - b[i]));
+        }
+    }
+    return error;
+}
+
+}
+
+TEST_CASE("BlockCompressionSizes", "[Textures]") {
+    REQUIRE(BlockCompression::getCompressedSize(BlockFormat::BC1, 4, 4) == 8);
+    REQUIRE(BlockCompression::getCompressedSize(BlockFormat::BC1, 5, 5) == 4 * 8);
+    REQUIRE(BlockCompression::getCompressedSize(BlockFormat::BC3, 1, 1) == 16);
+    REQUIRE(BlockCompression::getCompressedSize(BlockFormat::BC5, 16, 8) == 8 * 16);
+}
+
+TEST_CASE("BlockCompressionKeepsExactColors", "[Textures]") {
+    // Two colors representable in 5:6:5 in a checker pattern, on an image that is not a multiple of four
+    int width = 6, height = 7;
+    std::vector<unsigned char> image(width * height * 4);
+    for (int i = 0; i < width * height; i++) {
+        bool odd = (i % width + i / width) % 2 == 1;
+        image[i * 4 + 0] = odd ? 255 : 0;
+        image[i * 4 + 1] = odd ? 0 : 255;
+        image[i * 4 + 2] = odd ? 0 : 255;
+        image[i * 4 + 3] = odd ? 255 : 0;
+    }
+
+    REQUIRE(getMaximumError(image, roundTrip(BlockFormat::BC1, image, width, height), 3) == 0);
+    REQUIRE(getMaximumError(image, roundTrip(BlockFormat::BC3, image, width, height), 4) == 0);
+    REQUIRE(getMaximumError(image, roundTrip(BlockFormat::BC5, image, width, height), 2) == 0);
+}
+
+TEST_CASE("BlockCompressionApproximatesGradients", "[Textures]") {
+    int width = 64, height = 64;
+    std::vector<unsigned char> image(width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char *texel = &image[(y * width + x) * 4];
+            texel[0] = (unsigned char)(x * 4);
+            texel[1] = (unsigned char)(y * 4);
+            texel[2] = (unsigned char)(255 - x * 2 - y * 2);
+            texel[3] = (unsigned char)((x + y) * 2);
+        }
+    }
+
+    // Each block spans a small part of the gradients, so only the quantization shows
+    REQUIRE(getMaximumError(image, roundTrip(BlockFormat::BC1, image, width, height), 3) <= 12);
+    std::vector<unsigned char> bc3 = roundTrip(BlockFormat::BC3, image, width, height);
+    REQUIRE(getMaximumError(image, bc3, 3) <= 12);
+    int alphaError = 0;
+    for (size_t i = 3; i < image.size(); i += 4) {
+        alphaError = std::max(alphaError, std::abs(image[i] - bc3[i]));
+    }
+    REQUIRE(alphaError <= 2);
+
+    std::vector<unsigned char> bc5 = roundTrip(BlockFormat::BC5, image, width, height);
+    REQUIRE(getMaximumError(image, bc5, 2) <= 2);
+    REQUIRE(bc5[2] == 0);
+    REQUIRE(bc5[3] == 255);
+}
@@ -147,11 +147,11 @@ TEST_CASE("TriangleTriangleShouldNotIntersect", "[Collision]") {
 
 
 TEST_CASE("OctreeOctreeShouldIntersect", "[Collision]") {
-    Octree tree1 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
+    Octree tree1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 0.0f), make_vector(2.0f, 0.0f, 0.0f));
     tree1.insertTriangle(&t1);
 
-    Octree tree2 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
+    Octree tree2(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t2(make_vector(0.1f, 0.0f, 0.0f), make_vector(1.1f, 1.0f, 0.0f), make_vector(2.1f, 0.0f, 0.0f));
     tree2.insertTriangle(&t2);
 
@@ -163,11 +163,11 @@ TEST_CASE("OctreeOctreeShouldIntersect", "[Collision]") {
 }
 
 TEST_CASE("OctreeOctreeShouldNotIntersect", "[Collision]") {
-    Octree tree1 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
+    Octree tree1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 0.0f), make_vector(2.0f, 0.0f, 0.0f));
     tree1.insertTriangle(&t1);
 
-    Octree tree2 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
+    Octree tree2(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t2(make_vector(0.0f, 0.0f, 1.0f), make_vector(1.0f, 1.0f, 1.0f), make_vector(2.0f, 0.0f, 1.0f));
     tree2.insertTriangle(&t2);
 
@@ -178,11 +178,11 @@ TEST_CASE("OctreeOctreeShouldNotIntersect", "[Collision]") {
 }
 
 TEST_CASE("OctreeOctreeShouldIntersectRotated", "[Collision]") {
-    Octree tree1 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f) );
+    Octree tree1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t1(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 0.0f), make_vector(2.0f, 0.0f, 0.0f));
     tree1.insertTriangle(&t1);
 
-    Octree tree2 = Octree(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
+    Octree tree2(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 1.0f));
     Triangle t2(make_vector(0.0f, 0.0f, 0.0f), make_vector(1.0f, 1.0f, 0.0f), make_vector(2.0f, 0.0f, 0.0f));
     tree2.insertTriangle(&t2);
 
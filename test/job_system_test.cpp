@@ -0,0 +1,79 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include "catch.hpp"
+#include "JobSystem.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ParallelForCallsEveryIndexOnce", "[JobSystem]") {
+    JobSystem::setNumberOfThreads(4);
+    std::vector<std::atomic<int>> calls(1000);
+    for (std::atomic<int> &count : calls) {
+        count = 0;
+    }
+    JobSystem::parallelFor(calls.size(), [&](size_t i) { calls[i]++; }, 7);
+
+    int wrongCounts = 0;
+    for (std::atomic<int> &count : calls) {
+        wrongCounts += count != 1;
+    }
+    REQUIRE(wrongCounts == 0);
+}
+
+TEST_CASE("NestedParallelForRunsSerially", "[JobSystem]") {
+    // Every outer index, including the ones run on the calling thread, calls parallelFor again
+    JobSystem::setNumberOfThreads(2);
+    std::atomic<int> innerCalls(0);
+    JobSystem::parallelFor(16, [&](size_t) {
+        JobSystem::parallelFor(8, [&](size_t) { innerCalls++; });
+    });
+    REQUIRE(innerCalls == 16 * 8);
+
+    // The calling thread dispatches again once the outer call is done
+    std::atomic<int> calls(0);
+    JobSystem::parallelFor(8, [&](size_t) { calls++; });
+    REQUIRE(calls == 8);
+}
+
+TEST_CASE("ParallelForFromSeveralThreads", "[JobSystem]") {
+    JobSystem::setNumberOfThreads(2);
+    std::atomic<int> calls(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; i++) {
+        threads.push_back(std::thread([&calls]() {
+            JobSystem::parallelFor(100, [&calls](size_t) { calls++; });
+        }));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(calls == 300);
+}
+
+TEST_CASE("SerialThreadsDoNotUseTheWorkers", "[JobSystem]") {
+    JobSystem::setNumberOfThreads(4);
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<int> otherThreads(0);
+
+    JobSystem::setRunSerially(true);
+    JobSystem::parallelFor(64, [&](size_t) { otherThreads += std::this_thread::get_id() != caller; });
+    JobSystem::setRunSerially(false);
+    REQUIRE(otherThreads == 0);
+}
@@ -24,11 +24,12 @@
 #include <Utils.h>
 #include "catch.hpp"
 #include "Octree.h"
+#include "collision/SkinnedCollisionMesh.h"
 
 using namespace chag;
 
 TEST_CASE("OctreeTriangleLargerThanOctantCount", "[Collision]") {
-    Octree octree = Octree();
+    Octree octree;
     Triangle triangle = Triangle(make_vector(-0.1f, 0.0f, 0.0f),make_vector(0.5f, 1.0f, 0.0f),make_vector(1.0f, 0.0f, 0.0f));
     octree.insertTriangle(&triangle);
 
@@ -47,7 +48,7 @@ TEST_CASE("OctreeTriangleLargerThanOctantCount", "[Collision]") {
 
 
 TEST_CASE("OctreeTriangleFitInOneSubOctree", "[Collision]") {
-    Octree octree = Octree();
+    Octree octree;
     Triangle triangle = Triangle(make_vector(0.0f, 0.0f, 0.0f),make_vector(0.5f, 1.0f, 0.0f),make_vector(1.0f, 0.0f, 0.0f));
     octree.insertTriangle(&triangle);
 
@@ -66,7 +67,7 @@ TEST_CASE("OctreeTriangleFitInOneSubOctree", "[Collision]") {
 }
 
 TEST_CASE("OctreeManyTriangles", "[Collision]") {
-    Octree octree = Octree();
+    Octree octree;
 
     for(unsigned int i = 0; i < 100; i++) {
         Triangle triangle = Triangle(createRandomVector(-1.0f, 1.0f), createRandomVector(-1.0f, 1.0f), createRandomVector(-1.0f, 1.0f) );
@@ -75,5 +76,75 @@ TEST_CASE("OctreeManyTriangles", "[Collision]") {
     }
 }
 
+TEST_CASE("OctreeRefitFollowsMovedTriangles", "[Collision]") {
+    Octree octree;
+    Triangle triangle = Triangle(make_vector(0.1f, 0.1f, 0.1f), make_vector(0.5f, 0.9f, 0.1f), make_vector(0.9f, 0.1f, 0.1f));
+    octree.insertTriangle(&triangle);
+    REQUIRE(octree.getNumberOfSubTrees() == 1 + 8);
+
+    // Moved out of its octant, refitting keeps the triangle where it was inserted
+    triangle.setPoints(make_vector(-2.0f, 0.0f, 0.0f), make_vector(-1.5f, 0.5f, 0.0f), make_vector(-1.0f, 0.0f, 0.5f));
+    octree.refit();
+
+    REQUIRE(octree.getNumberOfSubTrees() == 1 + 8);
+    REQUIRE(octree.getAABB()->minV.x == Approx(-2.0f));
+    REQUIRE(octree.getAABB()->maxV.x == Approx(-1.0f));
+    REQUIRE(octree.getAABB()->maxV.y == Approx(0.5f));
+    REQUIRE(octree.getAABB()->maxV.z == Approx(0.5f));
+
+    std::vector<Triangle*> hits;
+    octree.getTrianglesInsersectedByRayCast(make_vector(-1.5f, 0.1f, -5.0f), make_vector(0.0f, 0.0f, 1.0f), &hits);
+    REQUIRE(hits.size() == 1);
+}
+
+TEST_CASE("SkinningWeighsTheBoneTransforms", "[Collision]") {
+    // Built with SSE2 on x86, so this covers the SSE path
+    std::vector<float3> positions;
+    std::vector<BoneInfluenceOnVertex> influences(4);
+    positions.push_back(make_vector(1.0f, 2.0f, 3.0f));
+    positions.push_back(make_vector(1.0f, 0.0f, 0.0f));
+    influences[1].addBoneData(0, 1.0f);
+    positions.push_back(make_vector(1.0f, 1.0f, 0.0f));
+    influences[2].addBoneData(0, 0.5f);
+    influences[2].addBoneData(1, 0.5f);
+    positions.push_back(make_vector(0.0f, 1.0f, 1.0f));
+    influences[3].addBoneData(0, 0.25f);
+    influences[3].addBoneData(1, 0.25f);
+    influences[3].addBoneData(2, 0.25f);
+    influences[3].addBoneData(3, 0.25f);
+
+    std::vector<float4x4> boneTransforms;
+    boneTransforms.push_back(make_translation(make_vector(0.0f, 0.0f, 2.0f)));
+    boneTransforms.push_back(make_scale<float4x4>(make_vector(2.0f, 2.0f, 2.0f)));
+    // A quarter turn around z, taking x to y
+    boneTransforms.push_back(make_matrix(0.0f, -1.0f, 0.0f, 0.0f,
+                                         1.0f,  0.0f, 0.0f, 0.0f,
+                                         0.0f,  0.0f, 1.0f, 0.0f,
+                                         0.0f,  0.0f, 0.0f, 1.0f));
+    boneTransforms.push_back(make_translation(make_vector(4.0f, 0.0f, 0.0f)));
+
+    std::vector<float3> skinned;
+    SkinnedCollisionMesh::skinPositions(positions, influences, boneTransforms, skinned);
+    REQUIRE(skinned.size() == 4);
+
+    // No bones, kept as is
+    REQUIRE(skinned[0].x == positions[0].x);
+    REQUIRE(skinned[0].y == positions[0].y);
+    REQUIRE(skinned[0].z == positions[0].z);
+
+    REQUIRE(skinned[1].x == Approx(1.0f));
+    REQUIRE(skinned[1].y == Approx(0.0f));
+    REQUIRE(skinned[1].z == Approx(2.0f));
+
+    // Halfway between (1, 1, 2) and (2, 2, 0)
+    REQUIRE(skinned[2].x == Approx(1.5f));
+    REQUIRE(skinned[2].y == Approx(1.5f));
+    REQUIRE(skinned[2].z == Approx(1.0f));
+
+    // The average of (0, 1, 3), (0, 2, 2), (-1, 0, 1) and (4, 1, 1)
+    REQUIRE(skinned[3].x == Approx(0.75f));
+    REQUIRE(skinned[3].y == Approx(1.0f));
+    REQUIRE(skinned[3].z == Approx(1.75f));
+}
 
 #endif
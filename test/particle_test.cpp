@@ -0,0 +1,243 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include "catch.hpp"
+#include "Random.h"
+#include "particle/ParticlePool.h"
+#include "particle/ParticleInstanceBuffer.h"
+#include "ParticleStage.h"
+#include "ParticleGenerator.h"
+#include "ParticleConf.h"
+#include "Camera.h"
+#include "GameObject.h"
+#include "Utils.h"
+#include <memory>
+
+using namespace chag;
+
+TEST_CASE("ParticlePoolRespectsCapacity", "[Particle]") {
+    ParticlePool pool(3);
+
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(pool.spawn(make_vector(0.0f, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 1.0f));
+    }
+    REQUIRE(!pool.spawn(make_vector(0.0f, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 1.0f));
+    REQUIRE(pool.getNumberOfParticles() == 3);
+    REQUIRE(pool.getCapacity() == 3);
+}
+
+TEST_CASE("ParticlePoolIntegratesAllParticles", "[Particle]") {
+    // More particles than one SIMD batch, and not a multiple of its width
+    ParticlePool pool(11);
+    for (int i = 0; i < 11; i++) {
+        pool.spawn(make_vector((float)i, 0.0f, 0.0f), make_vector(1.0f, 2.0f, (float)i), 100.0f, 1.0f);
+    }
+
+    pool.integrate(500.0f, 10.0f);
+
+    for (size_t i = 0; i < 11; i++) {
+        float3 position = pool.getPosition(i);
+        REQUIRE(position.x == Approx(i + 0.5f));
+        REQUIRE(position.y == Approx(1.0f));
+        REQUIRE(position.z == Approx(i * 0.5f));
+        REQUIRE(pool.getLives()[i] == Approx(90.0f));
+    }
+}
+
+TEST_CASE("ParticlePoolSwapRemovesDeadParticles", "[Particle]") {
+    ParticlePool pool(5);
+    float lives[] = { 10.0f, 50.0f, 10.0f, 50.0f, 10.0f };
+    for (int i = 0; i < 5; i++) {
+        pool.spawn(make_vector((float)i, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), lives[i], (float)i);
+    }
+
+    pool.integrate(0.0f, 20.0f);
+    REQUIRE(pool.removeDead() == 3);
+    REQUIRE(pool.getNumberOfParticles() == 2);
+
+    // Only the long lived particles remain, with their attributes kept together
+    for (size_t i = 0; i < 2; i++) {
+        REQUIRE(pool.getLives()[i] == Approx(30.0f));
+        REQUIRE((pool.getPosition(i).x == 1.0f || pool.getPosition(i).x == 3.0f));
+        REQUIRE(pool.getSizes()[i] == pool.getPosition(i).x);
+    }
+
+    REQUIRE(pool.spawn(make_vector(0.0f, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 1.0f));
+    REQUIRE(pool.getNumberOfParticles() == 3);
+}
+
+TEST_CASE("RandomIsReproduciblePerSeed", "[Particle]") {
+    Random first(42);
+    Random second(42);
+    Random other(43);
+
+    float values[64];
+    first.fill(values, 64, -2.0f, 3.0f);
+
+    bool differs = false;
+    for (int i = 0; i < 64; i++) {
+        REQUIRE(values[i] >= -2.0f);
+        REQUIRE(values[i] < 3.0f);
+        REQUIRE(second.nextFloat(-2.0f, 3.0f) == values[i]);
+        differs |= other.nextFloat(-2.0f, 3.0f) != values[i];
+    }
+    REQUIRE(differs);
+
+    first.seed(42);
+    REQUIRE(first.nextFloat(-2.0f, 3.0f) == values[0]);
+}
+
+TEST_CASE("ParticleInstancesAreSortedBackToFront", "[Particle]") {
+    Random random(7);
+    std::vector<float> keys(1000);
+    random.fill(keys.data(), keys.size(), 0.0f, 1000.0f);
+    keys[10] = keys[20]; // Equal keys keep their order
+    keys[30] = 0.0f;
+
+    std::vector<uint32_t> order, scratch;
+    ParticleInstanceBuffer::sortDescending(keys.data(), keys.size(), order, scratch);
+
+    REQUIRE(order.size() == keys.size());
+    for (size_t i = 1; i < order.size(); i++) {
+        REQUIRE(keys[order[i - 1]] >= keys[order[i]]);
+        if (keys[order[i - 1]] == keys[order[i]]) {
+            REQUIRE(order[i - 1] < order[i]);
+        }
+    }
+
+    ParticlePool pool(4);
+    pool.spawn(make_vector(1.0f, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 1.0f);
+    pool.spawn(make_vector(4.0f, 0.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 4.0f);
+    pool.spawn(make_vector(0.0f, -3.0f, 0.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 3.0f);
+    pool.spawn(make_vector(0.0f, 0.0f, 2.0f), make_vector(0.0f, 0.0f, 0.0f), 100.0f, 2.0f);
+
+    // The particle furthest away is left out
+    ParticleInstanceBuffer instanceBuffer;
+    instanceBuffer.build(pool, make_vector(0.0f, 0.0f, 0.0f), 3);
+
+    const std::vector<float4> &instances = instanceBuffer.getInstances();
+    REQUIRE(instances.size() == 3);
+    REQUIRE(instances[0].w == 3.0f);
+    REQUIRE(instances[0].y == -3.0f);
+    REQUIRE(instances[1].w == 2.0f);
+    REQUIRE(instances[2].w == 1.0f);
+}
+
+TEST_CASE("ParticleStageCullsEmittersOutsideTheFrustum", "[Particle]") {
+    // Looking down negative z from the origin
+    float4x4 projection = make_perspective(90.0f, 1.0f, 0.1f, 100.0f);
+
+    REQUIRE(ParticleStage::isSphereInFrustum(projection, make_vector(0.0f, 0.0f, -10.0f), 1.0f));
+    REQUIRE(!ParticleStage::isSphereInFrustum(projection, make_vector(0.0f, 0.0f, 10.0f), 1.0f));
+    REQUIRE(!ParticleStage::isSphereInFrustum(projection, make_vector(0.0f, 0.0f, -200.0f), 1.0f));
+    REQUIRE(!ParticleStage::isSphereInFrustum(projection, make_vector(20.0f, 0.0f, -10.0f), 1.0f));
+
+    // Partly inside is enough
+    REQUIRE(ParticleStage::isSphereInFrustum(projection, make_vector(11.0f, 0.0f, -10.0f), 2.0f));
+    REQUIRE(ParticleStage::isSphereInFrustum(projection, make_vector(0.0f, 0.0f, 1.0f), 2.0f));
+}
+
+namespace {
+
+class FallingParticleConf : public ParticleConf {
+public:
+    chag::float3 initialPosition(Random &random) override { return make_vector(0.0f, 0.0f, 0.0f); }
+    chag::float3 initialVelocity(Random &random) override { return random.nextVector(-1.0f, 1.0f); }
+    chag::float3 accelerate(chag::float3 velocity) override { return velocity + make_vector(0.0f, -0.5f, 0.0f); }
+    float calcLifetime(Random &random) override { return 100000.0f; }
+    chag::float3 calcParticleScale() override { return make_vector(1.0f, 1.0f, 1.0f); }
+    bool loop(float dt) override { return true; }
+};
+
+class RandlessParticleConf : public LegacyParticleConf {
+public:
+    chag::float3 initialPosition() override { return make_vector(0.0f, 0.0f, 0.0f); }
+    chag::float3 initialVelocity() override { return createRandomVector(-1.0f, 1.0f); }
+    chag::float3 accelerate(chag::float3 velocity) override { return velocity; }
+    float calcLifetime() override { return getRand(1000.0f, 2000.0f); }
+    chag::float3 calcParticleScale() override { return make_vector(1.0f, 1.0f, 1.0f); }
+    bool loop(float dt) override { return true; }
+};
+
+class StillCamera : public Camera {
+public:
+    StillCamera(float3 position) : Camera(position, make_vector(0.0f, 0.0f, 0.0f), make_vector(0.0f, 1.0f, 0.0f),
+                                          45.0f, 1.0f, 0.1f, 100.0f) {}
+    void update(float dt) override {}
+    float4x4 getViewMatrix() override { return make_identity<float4x4>(); }
+    float4x4 getProjectionMatrix() override { return make_identity<float4x4>(); }
+};
+
+}
+
+TEST_CASE("ThrottledParticleGeneratorsMatchUnthrottledOnes", "[Particle]") {
+    std::shared_ptr<Camera> camera = std::make_shared<StillCamera>(make_vector(0.0f, 0.0f, 50.0f));
+    GameObject owner;
+    ParticleGenerator unthrottled(20, nullptr, std::make_shared<FallingParticleConf>(), camera);
+    ParticleGenerator throttled(20, nullptr, std::make_shared<FallingParticleConf>(), camera);
+    unthrottled.bind(&owner);
+    throttled.bind(&owner);
+    unthrottled.setSeed(7);
+    throttled.setSeed(7);
+
+    for (int frame = 0; frame < PARTICLE_THROTTLED_UPDATE_FRAMES * 2; frame++) {
+        unthrottled.update(16.0f);
+        unthrottled.simulate(false);
+        throttled.update(16.0f);
+        throttled.simulate(true);
+    }
+
+    // Only the positions differ, a throttled step moves the particles by their final velocity
+    const ParticlePool &expected = unthrottled.getParticles();
+    const ParticlePool &actual = throttled.getParticles();
+    REQUIRE(actual.getNumberOfParticles() == expected.getNumberOfParticles());
+    for (size_t i = 0; i < expected.getNumberOfParticles(); i++) {
+        REQUIRE(actual.getLives()[i] == Approx(expected.getLives()[i]));
+        REQUIRE(actual.getVelocitiesX()[i] == Approx(expected.getVelocitiesX()[i]));
+        REQUIRE(actual.getVelocitiesY()[i] == Approx(expected.getVelocitiesY()[i]));
+        REQUIRE(actual.getVelocitiesZ()[i] == Approx(expected.getVelocitiesZ()[i]));
+    }
+}
+
+TEST_CASE("ParticleConfsWithoutRandomUseTheGeneratorsRandom", "[Particle]") {
+    std::shared_ptr<Camera> camera = std::make_shared<StillCamera>(make_vector(0.0f, 0.0f, 50.0f));
+    GameObject owner;
+    ParticleGenerator first(20, nullptr, std::make_shared<RandlessParticleConf>(), camera);
+    ParticleGenerator second(20, nullptr, std::make_shared<RandlessParticleConf>(), camera);
+    first.bind(&owner);
+    second.bind(&owner);
+    first.setSeed(3);
+    second.setSeed(3);
+
+    first.update(16.0f);
+    first.simulate(false);
+    rand();
+    second.update(16.0f);
+    second.simulate(false);
+
+    const ParticlePool &expected = first.getParticles();
+    const ParticlePool &actual = second.getParticles();
+    REQUIRE(Random::getCurrent() == nullptr);
+    REQUIRE(actual.getNumberOfParticles() == expected.getNumberOfParticles());
+    for (size_t i = 0; i < expected.getNumberOfParticles(); i++) {
+        REQUIRE(actual.getVelocitiesX()[i] == expected.getVelocitiesX()[i]);
+        REQUIRE(actual.getVelocitiesY()[i] == expected.getVelocitiesY()[i]);
+        REQUIRE(actual.getVelocitiesZ()[i] == expected.getVelocitiesZ()[i]);
+    }
+}
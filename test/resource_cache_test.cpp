@@ -0,0 +1,99 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include "catch.hpp"
+#include "ResourceCache.h"
+
+TEST_CASE("ResourceCacheAccountsMemory", "[Resources]") {
+    ResourceCache<int> cache;
+    cache.insert("a", std::make_shared<int>(1), 100, 1);
+    cache.insert("b", std::make_shared<int>(2), 50, 2);
+    REQUIRE(cache.getMemoryUsage() == 150);
+
+    // Inserting again replaces the item
+    cache.insert("a", std::make_shared<int>(3), 10, 3);
+    REQUIRE(cache.getMemoryUsage() == 60);
+    REQUIRE(*cache.fetch("a", 4) == 3);
+
+    cache.erase("b");
+    REQUIRE(cache.getMemoryUsage() == 10);
+    REQUIRE(cache.fetch("b", 5) == nullptr);
+    REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("ResourceCacheUpdatesMemorySize", "[Resources]") {
+    ResourceCache<int> cache;
+    cache.insert("a", std::make_shared<int>(1), 100, 1);
+    cache.insert("b", std::make_shared<int>(2), 50, 2);
+
+    cache.setMemorySize("a", 400);
+    REQUIRE(cache.getMemoryUsage() == 450);
+    cache.setMemorySize("missing", 1000);
+    REQUIRE(cache.getMemoryUsage() == 450);
+
+    // The new size is the one released on erase
+    cache.erase("a");
+    REQUIRE(cache.getMemoryUsage() == 50);
+}
+
+TEST_CASE("ResourceCacheEvictsLeastRecentlyUsedUnreferenced", "[Resources]") {
+    ResourceCache<int> cache;
+    cache.insert("a", std::make_shared<int>(1), 1, 1);
+    cache.insert("b", std::make_shared<int>(2), 1, 2);
+    cache.insert("c", std::make_shared<int>(3), 1, 3);
+
+    std::string id;
+    uint64_t lastUsed;
+    REQUIRE(cache.findLeastRecentlyUsedUnreferenced(id, lastUsed));
+    REQUIRE(id == "a");
+    REQUIRE(lastUsed == 1);
+
+    // Fetching makes it the most recently used, holding on to it keeps it from being evicted
+    std::shared_ptr<int> b = cache.fetch("b", 4);
+    cache.fetch("a", 5);
+    REQUIRE(cache.findLeastRecentlyUsedUnreferenced(id, lastUsed));
+    REQUIRE(id == "c");
+
+    std::shared_ptr<int> a = cache.fetch("a", 6);
+    std::shared_ptr<int> c = cache.fetch("c", 7);
+    REQUIRE(!cache.findLeastRecentlyUsedUnreferenced(id, lastUsed));
+
+    b.reset();
+    REQUIRE(cache.findLeastRecentlyUsedUnreferenced(id, lastUsed));
+    REQUIRE(id == "b");
+}
+
+TEST_CASE("ResourceCacheFindsItemsByAssetId", "[Resources]") {
+    constexpr AssetId compileTimeId("meshes/cube.obj");
+    REQUIRE(compileTimeId == AssetId(std::string("meshes/cube.obj")));
+    REQUIRE(compileTimeId != AssetId("meshes/sphere.obj"));
+
+    // Enough items to make the table grow a few times
+    ResourceCache<int> cache;
+    for (int i = 0; i < 100; i++) {
+        cache.insert("item" + std::to_string(i), std::make_shared<int>(i), 1, i);
+    }
+    REQUIRE(cache.size() == 100);
+    for (int i = 0; i < 100; i++) {
+        AssetId id("item" + std::to_string(i));
+        REQUIRE(cache.contains(id));
+        REQUIRE(*cache.fetch(id, 100 + i) == i);
+    }
+    REQUIRE(!cache.contains("item100"));
+}
@@ -0,0 +1,166 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include "catch.hpp"
+#include "TextureResidency.h"
+
+TEST_CASE("TextureResidencySelectsLevels", "[Resources]") {
+    REQUIRE(TextureResidency::getNumberOfLevels(1024, 512) == 11);
+    REQUIRE(TextureResidency::getNumberOfLevels(1, 1) == 1);
+
+    REQUIRE(TextureResidency::getTailLevel(1024, 1024) == 4);
+    REQUIRE(TextureResidency::getTailLevel(1024, 64) == 4);
+    REQUIRE(TextureResidency::getTailLevel(32, 32) == 0);
+
+    // The smallest level still covering the requested size
+    REQUIRE(TextureResidency::selectLevel(1024, 1024, 2000.0f) == 0);
+    REQUIRE(TextureResidency::selectLevel(1024, 1024, 1024.0f) == 0);
+    REQUIRE(TextureResidency::selectLevel(1024, 1024, 300.0f) == 1);
+    REQUIRE(TextureResidency::selectLevel(1024, 1024, 256.0f) == 2);
+    REQUIRE(TextureResidency::selectLevel(1024, 1024, 0.5f) == 10);
+
+    REQUIRE(TextureResidency::getMemorySize(4, 4, 0) == (16 + 4 + 1) * 4);
+    REQUIRE(TextureResidency::getMemorySize(4, 2, 1) == (2 + 1) * 4);
+    REQUIRE(TextureResidency::getMemorySize(4, 4, 2) == 4);
+    // Block compressed levels, at half a byte per texel, rounded up to whole bytes
+    REQUIRE(TextureResidency::getMemorySize(8, 8, 1, 4) == 8 + 2 + 1);
+}
+
+TEST_CASE("TextureResidencyFollowsRequests", "[Resources]") {
+    TextureResidency residency;
+    residency.setHoldFrames(0);
+    residency.add("a.png", 1024, 1024, TextureResidency::getTailLevel(1024, 1024));
+    residency.add("b.png", 512, 512, TextureResidency::getTailLevel(512, 512));
+    REQUIRE(residency.size() == 2);
+    REQUIRE(residency.getResidentLevel("a.png") == 4);
+    REQUIRE(residency.getTargetLevel("missing.png") == -1);
+
+    // The largest request of the frame counts, requests for unknown textures are ignored
+    residency.requestScreenSize("a.png", 100.0f);
+    residency.requestScreenSize("a.png", 500.0f);
+    residency.requestScreenSize("missing.png", 500.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("a.png") == 1);
+    REQUIRE(residency.getTargetLevel("b.png") == 3);
+
+    // A texture that is requested less than its tail keeps the tail
+    residency.requestScreenSize("a.png", 4.0f);
+    residency.requestScreenSize("b.png", 600.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("a.png") == 4);
+    REQUIRE(residency.getTargetLevel("b.png") == 0);
+
+    // Without requests everything falls back to the tail
+    residency.update();
+    REQUIRE(residency.getTargetLevel("a.png") == 4);
+    REQUIRE(residency.getTargetLevel("b.png") == 3);
+
+    residency.remove("a.png");
+    REQUIRE(!residency.contains("a.png"));
+    REQUIRE(residency.contains("b.png"));
+}
+
+TEST_CASE("TextureResidencyKeepsWithinBudget", "[Resources]") {
+    TextureResidency residency;
+    residency.add("near.png", 1024, 1024, 4);
+    residency.add("far.png", 1024, 1024, 4);
+    residency.setMemoryBudget(TextureResidency::getMemorySize(1024, 1024, 1) +
+                              TextureResidency::getMemorySize(1024, 1024, 2));
+
+    // Unlimited, these would be levels 0 and 2. The far texture has the
+    // most texels per pixel, so it loses a level first, then the near one.
+    residency.requestScreenSize("near.png", 1024.0f);
+    residency.requestScreenSize("far.png", 200.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("near.png") == 1);
+    REQUIRE(residency.getTargetLevel("far.png") == 3);
+    REQUIRE(residency.getTargetMemoryUsage() <= residency.getMemoryBudget());
+
+    // The tails are never dropped, even if they alone exceed the budget
+    residency.setMemoryBudget(1);
+    residency.requestScreenSize("near.png", 1024.0f);
+    residency.requestScreenSize("far.png", 200.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("near.png") == 4);
+    REQUIRE(residency.getTargetLevel("far.png") == 4);
+}
+
+TEST_CASE("TextureResidencyOrdersChanges", "[Resources]") {
+    TextureResidency residency;
+    residency.add("dropping.png", 1024, 1024, 0);
+    residency.add("close.png", 1024, 1024, 4);
+    residency.add("distant.png", 1024, 1024, 4);
+    residency.add("done.png", 1024, 1024, 4);
+
+    residency.requestScreenSize("dropping.png", 4.0f);
+    residency.requestScreenSize("close.png", 1024.0f);
+    residency.requestScreenSize("distant.png", 256.0f);
+    residency.requestScreenSize("done.png", 4.0f);
+    residency.update();
+    REQUIRE(residency.getResidentMemoryUsage() != residency.getTargetMemoryUsage());
+
+    // Drops first, then the texture lacking the most detail
+    std::vector<TextureResidency::Change> changes = residency.getChanges();
+    REQUIRE(changes.size() == 3);
+    REQUIRE(changes[0].name == "dropping.png");
+    REQUIRE(changes[0].residentLevel == 0);
+    REQUIRE(changes[0].targetLevel == 4);
+    REQUIRE(changes[1].name == "close.png");
+    REQUIRE(changes[1].targetLevel == 0);
+    REQUIRE(changes[2].name == "distant.png");
+    REQUIRE(changes[2].targetLevel == 2);
+
+    for (const TextureResidency::Change &change : changes) {
+        residency.setResidentLevel(change.name, change.targetLevel);
+    }
+    REQUIRE(residency.getChanges().empty());
+    REQUIRE(residency.getResidentMemoryUsage() == residency.getTargetMemoryUsage());
+}
+
+TEST_CASE("TextureResidencyHoldsLevels", "[Resources]") {
+    TextureResidency residency;
+    residency.setHoldFrames(2);
+    residency.add("moving.png", 1024, 1024, 4);
+    residency.add("unrequested.png", 1024, 1024, 0);
+
+    residency.requestScreenSize("moving.png", 500.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 1);
+
+    // The level is kept for two updates without a request that large, then dropped
+    residency.requestScreenSize("moving.png", 4.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 1);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 1);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 4);
+
+    // Larger requests are followed at once
+    residency.requestScreenSize("moving.png", 1024.0f);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 0);
+
+    // Textures never requested keep their levels, even over budget
+    REQUIRE(residency.getTargetLevel("unrequested.png") == 0);
+    residency.setMemoryBudget(1);
+    residency.update();
+    REQUIRE(residency.getTargetLevel("moving.png") == 4);
+    REQUIRE(residency.getTargetLevel("unrequested.png") == 0);
+}
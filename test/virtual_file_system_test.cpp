@@ -0,0 +1,94 @@
+/*
+ * This file is part of Bubba-3D.
+ *
+ * Bubba-3D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bubba-3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bubba-3D. If not, see http://www.gnu.org/licenses/.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include "catch.hpp"
+#include "VirtualFileSystem.h"
+#include <cstdio>
+#include <fstream>
+
+void writeTestFile(const std::string &fileName, const std::string &contents) {
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+TEST_CASE("VirtualFileSystemNormalizesPaths", "[VirtualFileSystem]") {
+    REQUIRE(VirtualFileSystem::normalizePath("meshes/./cube.obj") == "meshes/cube.obj");
+    REQUIRE(VirtualFileSystem::normalizePath("meshes\\textures\\..\\cube.obj") == "meshes/cube.obj");
+    REQUIRE(VirtualFileSystem::normalizePath("../meshes//cube.obj") == "../meshes/cube.obj");
+    REQUIRE(VirtualFileSystem::normalizePath("/meshes/../../cube.obj") == "/cube.obj");
+}
+
+TEST_CASE("VirtualFileSystemReadsFilesFromPacks", "[VirtualFileSystem]") {
+    std::vector<std::string> fileNames;
+    for (int i = 0; i < 20; i++) {
+        fileNames.push_back("virtual_file_system_test_" + std::to_string(i) + ".txt");
+        writeTestFile(fileNames.back(), "contents of file " + std::to_string(i));
+    }
+    writeTestFile("virtual_file_system_test_empty.txt", "");
+    fileNames.push_back("virtual_file_system_test_empty.txt");
+    REQUIRE(VirtualFileSystem::writePack("virtual_file_system_test.pack", fileNames));
+
+    // The pack is used even when the files are gone from disk
+    for (const std::string &fileName : fileNames) {
+        std::remove(fileName.c_str());
+    }
+    REQUIRE(!VirtualFileSystem::openFile(fileNames[0]).isOpen());
+    REQUIRE(VirtualFileSystem::mountPack("virtual_file_system_test.pack"));
+
+    for (int i = 0; i < 20; i++) {
+        VirtualFile file = VirtualFileSystem::openFile("./" + fileNames[i]);
+        REQUIRE(file.isOpen());
+        REQUIRE(file.getText() == "contents of file " + std::to_string(i));
+    }
+    VirtualFile emptyFile = VirtualFileSystem::openFile("virtual_file_system_test_empty.txt");
+    REQUIRE(emptyFile.isOpen());
+    REQUIRE(emptyFile.getSize() == 0);
+    REQUIRE(VirtualFileSystem::exists(fileNames[3]));
+    REQUIRE(!VirtualFileSystem::exists("virtual_file_system_test_20.txt"));
+    REQUIRE(!VirtualFileSystem::openFile("virtual_file_system_test_20.txt").isOpen());
+
+    // Opened files outlive the pack
+    VirtualFile file = VirtualFileSystem::openFile(fileNames[5]);
+    VirtualFileSystem::unmountPacks();
+    REQUIRE(file.getText() == "contents of file 5");
+    REQUIRE(!VirtualFileSystem::exists(fileNames[5]));
+
+    std::remove("virtual_file_system_test.pack");
+}
+
+TEST_CASE("VirtualFileSystemPrefersLaterPacks", "[VirtualFileSystem]") {
+    writeTestFile("virtual_file_system_test.txt", "first");
+    REQUIRE(VirtualFileSystem::writePack("virtual_file_system_test_first.pack", { "virtual_file_system_test.txt" }));
+    writeTestFile("virtual_file_system_test.txt", "second");
+    REQUIRE(VirtualFileSystem::writePack("virtual_file_system_test_second.pack", { "virtual_file_system_test.txt" }));
+
+    // Files on disk are only read when no pack has them
+    writeTestFile("virtual_file_system_test.txt", "disk");
+    REQUIRE(VirtualFileSystem::openFile("virtual_file_system_test.txt").getText() == "disk");
+
+    REQUIRE(VirtualFileSystem::mountPack("virtual_file_system_test_first.pack"));
+    REQUIRE(VirtualFileSystem::mountPack("virtual_file_system_test_second.pack"));
+    REQUIRE(VirtualFileSystem::openFile("virtual_file_system_test.txt").getText() == "second");
+    REQUIRE(!VirtualFileSystem::mountPack("virtual_file_system_test.txt"));
+    VirtualFileSystem::unmountPacks();
+
+    std::remove("virtual_file_system_test.txt");
+    std::remove("virtual_file_system_test_first.pack");
+    std::remove("virtual_file_system_test_second.pack");
+}